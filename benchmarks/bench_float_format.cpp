@@ -0,0 +1,246 @@
+// Microbenchmark of the 16 and 20 character E format field formatters.
+//
+// Reads the coordinates of the *NODE cards of each deck, then formats every
+// coordinate with the previous formatter (kept here as a reference), which
+// calls snprintf and shifts the exponent, and with FormatExpField. Both must
+// write the same fields.
+//
+// Before timing, FormatExpField is checked against snprintf and fast_strtod
+// over random values of every decimal exponent, random bit patterns, and
+// values next to rounding ties. Each field must match snprintf's "%E" when
+// its exponent has two digits, and must parse back to within half a unit of
+// its last digit.
+//
+// Usage: bench_float_format [deck ...]
+// Defaults to the bundled wheel.k and bird.k examples.
+
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fast_float.h"
+#include "float_format.h"
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "src/lsdyna_mesh_reader/examples"
+#endif
+
+// Number of times to format every coordinate
+#define N_REPEAT 20
+
+// Random values checked for each decimal exponent and field width
+#define N_CHECK_PER_EXPONENT 2000
+
+// Width of each standard and long coordinate field
+#define E16_WIDTH 16
+#define E20_WIDTH 20
+
+// Formatter used by the writer before FormatExpField. Exponents of three
+// digits overflow the field.
+static void FormatWithExp(char *buffer, size_t buffer_size, double value,
+                          int width, int precision, int num_exp) {
+  snprintf(buffer, buffer_size, "% *.*E", width, precision, value);
+
+  char *exponent_pos = strchr(buffer, 'E');
+  int exp_length = strlen(exponent_pos + 2);
+  if (exp_length < num_exp) {
+    for (int i = exp_length + 1; i > 0; i--) {
+      exponent_pos[2 + i] = exponent_pos[1 + i];
+    }
+    exponent_pos[2] = '0';
+    memmove(buffer, buffer + 1, strlen(buffer));
+  }
+}
+
+// Check one value, returning false and reporting it on failure
+static bool CheckValue(double value, int width) {
+  char field[E20_WIDTH + 1] = {0};
+  FormatExpField(field, value, width);
+
+  char expected[64];
+  snprintf(expected, sizeof(expected), "% .*E", width - 7, value);
+  bool two_digit_exponent = strlen(expected) == static_cast<size_t>(width);
+  if (two_digit_exponent && memcmp(field, expected, width) != 0) {
+    std::printf("  %.17g formatted as \"%s\", expected \"%s\"\n", value, field,
+                expected);
+    return false;
+  }
+
+  // half a unit of the last significant digit, and a few ulps for the
+  // subtraction
+  int digits = two_digit_exponent ? width - 6 : width - 7;
+  double magnitude = std::fabs(value);
+  double tolerance = 0;
+  if (magnitude != 0) {
+    int exp10 = static_cast<int>(std::floor(std::log10(magnitude)));
+    tolerance = 0.5 * std::pow(10.0, exp10 - (digits - 1)) * (1 + 1e-9) +
+                4 * magnitude * DBL_EPSILON;
+  }
+  double parsed = fast_strtod(field, width);
+  if (std::fabs(parsed - value) > tolerance) {
+    std::printf("  %.17g formatted as \"%s\", which parses to %.17g\n", value,
+                field, parsed);
+    return false;
+  }
+  return true;
+}
+
+// Check FormatExpField over every decimal exponent of a double, random bit
+// patterns, and values beside rounding ties
+static int CheckFormatter() {
+  std::mt19937_64 rng(0);
+  std::uniform_real_distribution<double> unit(1.0, 10.0);
+  size_t n_checked = 0, n_failed = 0;
+
+  for (int width : {E16_WIDTH, E20_WIDTH}) {
+    int digits = width - 6;
+    std::vector<double> values = {0.0, -0.0, DBL_MIN, DBL_MAX, DBL_TRUE_MIN};
+    for (int exp10 = -323; exp10 <= 308; exp10++) {
+      double scale = std::pow(10.0, exp10);
+      for (int i = 0; i < N_CHECK_PER_EXPONENT; i++) {
+        values.push_back(unit(rng) * scale);
+      }
+      values.push_back(scale);
+      values.push_back(std::nextafter(scale, 0.0));
+    }
+    for (int i = 0; i < N_CHECK_PER_EXPONENT * 100; i++) {
+      uint64_t bits = rng();
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      values.push_back(value);
+    }
+    for (int i = 0; i < N_CHECK_PER_EXPONENT * 100; i++) {
+      // halfway between two fields, and the doubles either side
+      uint64_t significand = rng() % UINT_POWER_OF_TEN[digits];
+      int exp10 = static_cast<int>(rng() % 60) - 30;
+      double tie =
+          (significand + 0.5) * std::pow(10.0, exp10 - (digits - 1));
+      values.push_back(tie);
+      values.push_back(std::nextafter(tie, 0.0));
+      values.push_back(std::nextafter(tie, HUGE_VAL));
+    }
+
+    for (double value : values) {
+      // the largest exponents overflow for some significands
+      if (!std::isfinite(value)) {
+        continue;
+      }
+      for (double signed_value : {value, -value}) {
+        n_checked++;
+        n_failed += !CheckValue(signed_value, width);
+      }
+    }
+  }
+
+  std::printf("checked %zu values: %s\n", n_checked,
+              n_failed ? "FAILED" : "ok");
+  return n_failed != 0;
+}
+
+// Collect the x, y, and z coordinates of every *NODE card
+static std::vector<double> ReadCoordinates(const char *filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error(std::string("Unable to open ") + filename);
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string text = buffer.str();
+
+  std::vector<double> coordinates;
+  bool in_node = false;
+  for (size_t pos = 0; pos < text.size();) {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos) {
+      eol = text.size();
+    }
+
+    if (text[pos] == '*') {
+      in_node = text.compare(pos, 5, "*NODE") == 0 &&
+                (pos + 5 == eol || std::isspace(text[pos + 5]));
+    } else if (in_node && text[pos] != '$' && eol - pos >= 56) {
+      for (int i = 0; i < 3; i++) {
+        coordinates.push_back(
+            fast_strtod(text.data() + pos + 8 + E16_WIDTH * i, E16_WIDTH));
+      }
+    }
+    pos = eol + 1;
+  }
+
+  return coordinates;
+}
+
+template <typename F> static double Time(F fn) {
+  auto tstart = std::chrono::steady_clock::now();
+  for (int i = 0; i < N_REPEAT; i++) {
+    fn();
+  }
+  auto tend = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(tend - tstart).count();
+}
+
+static int Benchmark(const char *filename) {
+  std::vector<double> coordinates = ReadCoordinates(filename);
+  size_t n_values = coordinates.size();
+  std::printf("%s: %zu coordinates\n", filename, n_values);
+  if (!n_values) {
+    return 0;
+  }
+
+  int status = 0;
+  for (int width : {E16_WIDTH, E20_WIDTH}) {
+    std::vector<char> expected(n_values * width);
+    std::vector<char> out(n_values * width);
+
+    double t_legacy = Time([&] {
+      char field[E20_WIDTH + 2];
+      for (size_t i = 0; i < n_values; i++) {
+        FormatWithExp(field, width + 1, coordinates[i], width, width - 7, 2);
+        memcpy(&expected[i * width], field, width);
+      }
+    });
+    std::printf("  E%d %-15s %8.2f ms  %7.1f Mfields/s\n", width,
+                "FormatWithExp", 1e3 * t_legacy / N_REPEAT,
+                n_values * N_REPEAT / t_legacy / 1e6);
+
+    double t_fast = Time([&] {
+      for (size_t i = 0; i < n_values; i++) {
+        FormatExpField(&out[i * width], coordinates[i], width);
+      }
+    });
+    bool match = out == expected;
+    std::printf("  E%d %-15s %8.2f ms  %7.1f Mfields/s  %5.2fx  %s\n", width,
+                "FormatExpField", 1e3 * t_fast / N_REPEAT,
+                n_values * N_REPEAT / t_fast / 1e6, t_legacy / t_fast,
+                match ? "ok" : "MISMATCH");
+    status |= !match;
+  }
+
+  return status;
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> filenames;
+  for (int i = 1; i < argc; i++) {
+    filenames.push_back(argv[i]);
+  }
+  if (filenames.empty()) {
+    filenames.push_back(EXAMPLES_DIR "/wheel.k");
+    filenames.push_back(EXAMPLES_DIR "/bird.k");
+  }
+
+  int status = CheckFormatter();
+  for (const std::string &filename : filenames) {
+    status |= Benchmark(filename.c_str());
+  }
+  return status;
+}
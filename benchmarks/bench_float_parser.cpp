@@ -0,0 +1,227 @@
+// Microbenchmark of the 16 character floating point field parsers.
+//
+// Collects the coordinate fields of the *NODE cards of each deck, then parses
+// every field with the previous parser (kept here as a reference), with
+// fast_strtod, and with the C library's strtod. fast_strtod must match strtod
+// bit for bit; the previous parser is only timed.
+//
+// Usage: bench_float_parser [deck ...]
+// Defaults to the bundled wheel.k and bird.k examples.
+
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fast_float.h"
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "src/lsdyna_mesh_reader/examples"
+#endif
+
+// Number of times to parse every field
+#define N_REPEAT 50
+
+// Width of each coordinate field
+#define E16_WIDTH 16
+
+static const double DIV_OF_TEN[] = {
+    1.0e-0,  1.0e-1,  1.0e-2,  1.0e-3,  1.0e-4,  1.0e-5,  1.0e-6,
+    1.0e-7,  1.0e-8,  1.0e-9,  1.0e-10, 1.0e-11, 1.0e-12, 1.0e-13,
+    1.0e-14, 1.0e-15, 1.0e-16, 1.0e-17, 1.0e-18, 1.0e-19, 1.0e-20,
+    1.0e-21, 1.0e-22, 1.0e-23, 1.0e-24, 1.0e-25, 1.0e-26, 1.0e-27,
+};
+
+static inline double power_of_ten(int exponent) {
+  double result = 1.0;
+  double base = (exponent < 0) ? 0.1 : 10.0;
+  int abs_exponent = abs(exponent);
+  for (int i = 0; i < abs_exponent; ++i) {
+    result *= base;
+  }
+  return result;
+}
+
+// Parser used by the reader before fast_strtod. It accumulates rounding
+// error in its powers of ten and only handles right justified fields.
+static inline double legacy_strtod(const char *raw, int fltsz) {
+  const char *end = raw + fltsz;
+  double sign = 1;
+
+  while (raw < end) {
+    if (*raw != ' ') {
+      break;
+    }
+    raw++;
+  }
+
+  if (*raw == '-') {
+    sign = -1;
+    ++raw;
+  }
+
+  uint64_t val_int = *raw++ - '0';
+
+  int decimal_digits = 0;
+  bool after_decimal = false;
+  while (raw < end) {
+    if (*raw == 'e' || *raw == 'E') {
+      break;
+    } else if (*raw >= '0' && *raw <= '9') {
+      val_int = val_int * 10 + (*raw++ - '0');
+      if (after_decimal) {
+        decimal_digits++;
+      }
+    } else if (*raw == '.') {
+      after_decimal = true;
+      raw++;
+    }
+  }
+
+  double val;
+  if (decimal_digits < 27) {
+    val = (double)val_int * DIV_OF_TEN[decimal_digits];
+  } else {
+    val = (double)val_int * power_of_ten(10);
+  }
+
+  int evalue = 0;
+  int esign = 1;
+  if (*raw == 'e' || *raw == 'E') {
+    raw++;
+    if (*raw == '-') {
+      esign = -1;
+    }
+    raw++;
+
+    while (raw < end) {
+      if (*raw == ' ' || *raw == '\0') {
+        break;
+      }
+      evalue = evalue * 10 + (*raw++ - '0');
+    }
+    if (esign == 1) {
+      val *= power_of_ten(evalue);
+    } else {
+      val /= power_of_ten(evalue);
+    }
+  }
+
+  if (sign == -1) {
+    return -val;
+  }
+  return val;
+}
+
+// Collect the x, y, and z fields of every *NODE card. Each field is stored
+// null terminated so strtod can read it directly.
+static std::vector<std::string> ReadFields(const char *filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error(std::string("Unable to open ") + filename);
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string text = buffer.str();
+
+  std::vector<std::string> fields;
+  bool in_node = false;
+  for (size_t pos = 0; pos < text.size();) {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos) {
+      eol = text.size();
+    }
+
+    if (text[pos] == '*') {
+      in_node = text.compare(pos, 5, "*NODE") == 0 &&
+                (pos + 5 == eol || std::isspace(text[pos + 5]));
+    } else if (in_node && text[pos] != '$' && eol - pos >= 56) {
+      for (int i = 0; i < 3; i++) {
+        fields.push_back(text.substr(pos + 8 + E16_WIDTH * i, E16_WIDTH));
+      }
+    }
+    pos = eol + 1;
+  }
+
+  return fields;
+}
+
+template <typename F> static double Time(F fn) {
+  auto tstart = std::chrono::steady_clock::now();
+  for (int i = 0; i < N_REPEAT; i++) {
+    fn();
+  }
+  auto tend = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(tend - tstart).count();
+}
+
+static int Benchmark(const char *filename) {
+  std::vector<std::string> fields = ReadFields(filename);
+  size_t n_fields = fields.size();
+  std::printf("%s: %zu coordinate fields\n", filename, n_fields);
+  if (!n_fields) {
+    return 0;
+  }
+
+  std::vector<double> expected(n_fields);
+  std::vector<double> out(n_fields);
+
+  double t_strtod = Time([&] {
+    for (size_t i = 0; i < n_fields; i++) {
+      expected[i] = strtod(fields[i].c_str(), nullptr);
+    }
+  });
+  std::printf("  %-13s %8.2f ms  %7.1f Mfields/s\n", "strtod",
+              1e3 * t_strtod / N_REPEAT, n_fields * N_REPEAT / t_strtod / 1e6);
+
+  double t_legacy = Time([&] {
+    for (size_t i = 0; i < n_fields; i++) {
+      out[i] = legacy_strtod(fields[i].data(), E16_WIDTH);
+    }
+  });
+  size_t n_inexact = 0;
+  for (size_t i = 0; i < n_fields; i++) {
+    n_inexact += memcmp(&out[i], &expected[i], sizeof(double)) != 0;
+  }
+  std::printf("  %-13s %8.2f ms  %7.1f Mfields/s  %5.2fx  %zu inexact\n",
+              "legacy_strtod", 1e3 * t_legacy / N_REPEAT,
+              n_fields * N_REPEAT / t_legacy / 1e6, t_strtod / t_legacy,
+              n_inexact);
+
+  double t_fast = Time([&] {
+    for (size_t i = 0; i < n_fields; i++) {
+      out[i] = fast_strtod(fields[i].data(), E16_WIDTH);
+    }
+  });
+  bool match = memcmp(out.data(), expected.data(),
+                      n_fields * sizeof(double)) == 0;
+  std::printf("  %-13s %8.2f ms  %7.1f Mfields/s  %5.2fx  %s\n",
+              "fast_strtod", 1e3 * t_fast / N_REPEAT,
+              n_fields * N_REPEAT / t_fast / 1e6, t_strtod / t_fast,
+              match ? "ok" : "MISMATCH");
+
+  return !match;
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> filenames;
+  for (int i = 1; i < argc; i++) {
+    filenames.push_back(argv[i]);
+  }
+  if (filenames.empty()) {
+    filenames.push_back(EXAMPLES_DIR "/wheel.k");
+    filenames.push_back(EXAMPLES_DIR "/bird.k");
+  }
+
+  int status = 0;
+  for (const std::string &filename : filenames) {
+    status |= Benchmark(filename.c_str());
+  }
+  return status;
+}
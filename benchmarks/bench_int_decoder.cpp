@@ -0,0 +1,154 @@
+// Microbenchmark of the 8 character integer field decoders.
+//
+// Collects the element cards of each deck, then decodes every card with
+// fast_atoi (one field at a time) and with each card decoder kernel the CPU
+// supports, checking that they all agree.
+//
+// Usage: bench_int_decoder [deck ...]
+// Defaults to the bundled wheel.k and bird.k examples.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "int_decoder.h"
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "src/lsdyna_mesh_reader/examples"
+#endif
+
+// Number of times to decode every card
+#define N_REPEAT 50
+
+struct Cards {
+  std::string text;
+  std::vector<size_t> starts;
+  std::vector<int> n_fields;
+  size_t total_fields = 0;
+};
+
+// Collect the cards of *ELEMENT_SOLID, *ELEMENT_TSHELL and *ELEMENT_SHELL
+static Cards ReadCards(const char *filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error(std::string("Unable to open ") + filename);
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+
+  Cards cards;
+  cards.text = buffer.str();
+  const std::string &text = cards.text;
+
+  int n_fields = 0;
+  for (size_t pos = 0; pos < text.size();) {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos) {
+      eol = text.size();
+    }
+
+    if (text[pos] == '*') {
+      if (text.compare(pos, 14, "*ELEMENT_SOLID") == 0 ||
+          text.compare(pos, 15, "*ELEMENT_TSHELL") == 0) {
+        n_fields = 10;
+      } else if (text.compare(pos, 14, "*ELEMENT_SHELL") == 0) {
+        n_fields = 6;
+      } else {
+        n_fields = 0;
+      }
+    } else if (n_fields && text[pos] != '$') {
+      cards.starts.push_back(pos);
+      cards.n_fields.push_back(n_fields);
+      cards.total_fields += n_fields;
+    }
+    pos = eol + 1;
+  }
+
+  return cards;
+}
+
+template <typename F> static double Time(F fn) {
+  auto tstart = std::chrono::steady_clock::now();
+  for (int i = 0; i < N_REPEAT; i++) {
+    fn();
+  }
+  auto tend = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(tend - tstart).count();
+}
+
+static int Benchmark(const char *filename) {
+  Cards cards = ReadCards(filename);
+  const char *text = cards.text.data();
+  const char *end = text + cards.text.size();
+  size_t n_cards = cards.starts.size();
+  std::printf("%s: %zu element cards, %zu fields\n", filename, n_cards,
+              cards.total_fields);
+  if (!n_cards) {
+    return 0;
+  }
+
+  std::vector<int> expected(cards.total_fields);
+  std::vector<int> out(cards.total_fields);
+
+  double t_ref = Time([&] {
+    int *dst = expected.data();
+    for (size_t i = 0; i < n_cards; i++) {
+      const char *p = text + cards.starts[i];
+      for (int j = 0; j < cards.n_fields[i]; j++) {
+        *dst++ = fast_atoi(p + I8_WIDTH * j, I8_WIDTH);
+      }
+    }
+  });
+  std::printf("  %-10s %8.2f ms  %7.1f Mfields/s\n", "fast_atoi",
+              1e3 * t_ref / N_REPEAT,
+              cards.total_fields * N_REPEAT / t_ref / 1e6);
+
+  int status = 0;
+  IntDecoderKernel kernels[] = {IntDecoderKernel::Scalar,
+                                IntDecoderKernel::SSE41,
+                                IntDecoderKernel::AVX2};
+  IntDecoderKernel best = DetectIntDecoderKernel();
+  for (IntDecoderKernel kernel : kernels) {
+    if (static_cast<int>(kernel) > static_cast<int>(best)) {
+      break;
+    }
+    DecodeI8CardFn decode = IntDecoderFunction(kernel);
+
+    double t_kernel = Time([&] {
+      int *dst = out.data();
+      for (size_t i = 0; i < n_cards; i++) {
+        decode(text + cards.starts[i], end, cards.n_fields[i], dst);
+        dst += cards.n_fields[i];
+      }
+    });
+
+    bool match = out == expected;
+    status |= !match;
+    std::printf("  %-10s %8.2f ms  %7.1f Mfields/s  %5.2fx  %s\n",
+                IntDecoderName(kernel), 1e3 * t_kernel / N_REPEAT,
+                cards.total_fields * N_REPEAT / t_kernel / 1e6,
+                t_ref / t_kernel, match ? "ok" : "MISMATCH");
+  }
+
+  return status;
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> filenames;
+  for (int i = 1; i < argc; i++) {
+    filenames.push_back(argv[i]);
+  }
+  if (filenames.empty()) {
+    filenames.push_back(EXAMPLES_DIR "/wheel.k");
+    filenames.push_back(EXAMPLES_DIR "/bird.k");
+  }
+
+  int status = 0;
+  for (const std::string &filename : filenames) {
+    status |= Benchmark(filename.c_str());
+  }
+  return status;
+}
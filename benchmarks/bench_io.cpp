@@ -0,0 +1,187 @@
+// Benchmark of the I/O backends that read a deck.
+//
+// Reads each deck with every backend while scanning it the way the keyword
+// indexer does, line by line as the bytes become available, and checks that
+// the backends agree. Each backend is timed with the deck in the page cache
+// (warm) and evicted from it before every read (cold), which is where the
+// backends differ. To compare them on throttled I/O, run the benchmark on a
+// deck on a network filesystem, or limit the bandwidth of its device:
+//
+//   systemd-run --scope -p "IOReadBandwidthMax=/dev/sda 200M" ./bench_io a.k
+//
+// Usage: bench_io [--block-bytes=N] [deck ...]
+// Defaults to the bundled wheel.k and bird.k examples, in blocks of
+// READ_BLOCK_BYTES.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "byte_range.h"
+
+#ifndef EXAMPLES_DIR
+#define EXAMPLES_DIR "src/lsdyna_mesh_reader/examples"
+#endif
+
+// Number of times to read every deck
+#define N_REPEAT 5
+
+struct Scan {
+  size_t lines = 0;
+  size_t keywords = 0;
+
+  bool operator==(const Scan &other) const {
+    return lines == other.lines && keywords == other.keywords;
+  }
+};
+
+// Count the lines and keywords of the complete lines in [begin, end),
+// returning the start of the first incomplete line
+static const char *ScanLines(const char *begin, const char *end, Scan &scan) {
+  const char *line = begin;
+  while (line < end) {
+    const char *eol =
+        static_cast<const char *>(memchr(line, '\n', end - line));
+    if (!eol) {
+      break;
+    }
+    scan.lines++;
+    scan.keywords += *line == '*';
+    line = eol + 1;
+  }
+  return line;
+}
+
+// Count the lines and keywords of a range that's all available
+static Scan ScanAll(const ByteRange &range) {
+  Scan scan;
+  const char *rest = ScanLines(range.begin(), range.end(), scan);
+  if (rest < range.end()) {
+    scan.lines++;
+    scan.keywords += *rest == '*';
+  }
+  return scan;
+}
+
+// Count the lines and keywords of a range as its bytes arrive
+static Scan ScanStream(StreamedRange &range) {
+  Scan scan;
+  const char *line = range.begin();
+  size_t have = 0;
+  bool done = false;
+  while (!done) {
+    have = range.Wait(have, done);
+    line = ScanLines(line, range.begin() + have, scan);
+  }
+  if (line < range.begin() + have) {
+    scan.lines++;
+    scan.keywords += *line == '*';
+  }
+  return scan;
+}
+
+// Drop the pages of ``filename`` from the page cache, where supported
+static void Evict(const char *filename) {
+#ifdef POSIX_FADV_DONTNEED
+  int fd = open(filename, O_RDONLY);
+  if (fd != -1) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+#else
+  (void)filename;
+#endif
+}
+
+enum class Backend { Map, MapHinted, MapPopulate, Read };
+
+static const char *BackendName(Backend backend) {
+  switch (backend) {
+  case Backend::Map:
+    return "mmap";
+  case Backend::MapHinted:
+    return "mmap+hints";
+  case Backend::MapPopulate:
+    return "populate";
+  default:
+    return "pread";
+  }
+}
+
+static Scan Read(const char *filename, Backend backend, size_t block_bytes) {
+  if (backend == Backend::Read) {
+    PrefetchedFile file(filename, block_bytes);
+    return ScanStream(file);
+  }
+  MemoryMappedFile file(filename, MapMode::Read,
+                        backend == Backend::MapPopulate);
+  if (backend != Backend::Map) {
+    file.AdviseSequential(true);
+  }
+  return ScanAll(file);
+}
+
+static int Benchmark(const char *filename, size_t block_bytes) {
+  size_t n_bytes;
+  {
+    MemoryMappedFile file(filename);
+    n_bytes = file.end() - file.begin();
+  }
+  std::printf("%s: %zu bytes, blocks of %zu bytes\n", filename, n_bytes,
+              block_bytes);
+
+  Scan expected = Read(filename, Backend::Map, block_bytes);
+  int status = 0;
+  Backend backends[] = {Backend::Map, Backend::MapHinted,
+                        Backend::MapPopulate, Backend::Read};
+  for (Backend backend : backends) {
+    bool match = true;
+    double seconds[2] = {0, 0};
+    for (int cold = 0; cold < 2; cold++) {
+      for (int i = 0; i < N_REPEAT; i++) {
+        if (cold) {
+          Evict(filename);
+        }
+        auto tstart = std::chrono::steady_clock::now();
+        match &= Read(filename, backend, block_bytes) == expected;
+        auto tend = std::chrono::steady_clock::now();
+        seconds[cold] += std::chrono::duration<double>(tend - tstart).count();
+      }
+    }
+    status |= !match;
+    std::printf("  %-10s warm %8.2f ms %8.1f MB/s  cold %8.2f ms %8.1f "
+                "MB/s  %s\n",
+                BackendName(backend), 1e3 * seconds[0] / N_REPEAT,
+                n_bytes * N_REPEAT / seconds[0] / 1e6,
+                1e3 * seconds[1] / N_REPEAT,
+                n_bytes * N_REPEAT / seconds[1] / 1e6,
+                match ? "ok" : "MISMATCH");
+  }
+
+  return status;
+}
+
+int main(int argc, char **argv) {
+  size_t block_bytes = READ_BLOCK_BYTES;
+  std::vector<std::string> filenames;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 14, "--block-bytes=") == 0) {
+      block_bytes = std::strtoull(arg.c_str() + 14, nullptr, 10);
+    } else {
+      filenames.push_back(arg);
+    }
+  }
+  if (filenames.empty()) {
+    filenames.push_back(EXAMPLES_DIR "/wheel.k");
+    filenames.push_back(EXAMPLES_DIR "/bird.k");
+  }
+
+  int status = 0;
+  for (const std::string &filename : filenames) {
+    status |= Benchmark(filename.c_str(), block_bytes);
+  }
+  return status;
+}
@@ -1,42 +1,167 @@
 #ifndef ARRAY_SUPPORT_HEADER_H
 #define ARRAY_SUPPORT_HEADER_H
 
+#include <algorithm>
 #include <array>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <vector>
 
 #include <nanobind/nanobind.h>
 #include <nanobind/ndarray.h>
 
-#if defined(__linux__) || defined(__APPLE__)
-#include <sys/mman.h> // for madvise on Linux
+#if defined(_WIN32) || defined(_WIN64)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h> // for mmap, and madvise on Linux
 #endif
 
 namespace nb = nanobind;
 
+// Smallest chunk mapped by an Arena, one huge page
+#define ARENA_MIN_CHUNK (1u << 21u)
+
+// Alignment of each array in an Arena, a cache line
+#define ARENA_ALIGNMENT 64u
+
 template <typename T, size_t N>
 using NDArray = nb::ndarray<nb::numpy, T, nb::ndim<N>, nb::c_contig>;
 
-template <typename T>
-T *AllocateArray(size_t total, bool zero_initialize = false) {
-  T *data = zero_initialize ? new T[total]() : new T[total];
-
+// Back a large block with transparent huge pages where available
+inline void AdviseHugePages(void *data, size_t bytes) {
 #ifdef __linux__
   const size_t hugepage_threshold = 1u << 22u; // 4MB threshold
   const size_t page_size = 4096u;
 
-  if (total * sizeof(T) >= hugepage_threshold) {
+  if (bytes >= hugepage_threshold) {
     uintptr_t data_addr = reinterpret_cast<uintptr_t>(data);
-    size_t offset = page_size - (data_addr % page_size);
-    size_t length = total * sizeof(T) - offset;
+    size_t offset = (page_size - data_addr % page_size) % page_size;
+    size_t length = bytes - offset;
 
     madvise(reinterpret_cast<void *>(data_addr + offset), length,
             MADV_HUGEPAGE);
   }
+#else
+  (void)data;
+  (void)bytes;
 #endif
+}
 
+template <typename T>
+T *AllocateArray(size_t total, bool zero_initialize = false) {
+  T *data = zero_initialize ? new T[total]() : new T[total];
+  AdviseHugePages(data, total * sizeof(T));
   return data;
 }
 
+// Memory for the arrays of a deck.
+//
+// Arrays are carved out of a few large, page aligned chunks mapped from the
+// OS, rather than allocated from the heap one by one, so the arrays of a
+// section lie side by side and large decks are backed by huge pages. Nothing
+// is freed until the arena is destroyed, which unmaps each chunk, so arrays
+// wrapped for Python share ownership of the arena (see WrapSharedNDArray).
+// Allocation is thread safe.
+class Arena {
+private:
+  struct Chunk {
+    char *base;
+    size_t size;
+    size_t used;
+  };
+
+  std::mutex mutex;
+  std::vector<Chunk> chunks;
+  size_t capacity = 0;
+
+  static char *Map(size_t bytes) {
+#ifdef _WIN32
+    void *base =
+        VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!base) {
+      throw std::bad_alloc();
+    }
+#else
+    void *base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+#endif
+    return static_cast<char *>(base);
+  }
+
+  static void Unmap(char *base, size_t bytes) {
+#ifdef _WIN32
+    (void)bytes;
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    munmap(base, bytes);
+#endif
+  }
+
+  // Start a chunk with room for at least ``bytes``. Chunks at least double
+  // the arena, so a deck read piece by piece needs few of them. Must hold
+  // the mutex.
+  void AddChunk(size_t bytes) {
+    size_t size = std::max({bytes, capacity, size_t(ARENA_MIN_CHUNK)});
+    size = (size + ARENA_MIN_CHUNK - 1) / ARENA_MIN_CHUNK * ARENA_MIN_CHUNK;
+    char *base = Map(size);
+    AdviseHugePages(base, size);
+    chunks.push_back({base, size, 0});
+    capacity += size;
+  }
+
+  bool Fits(size_t bytes) const {
+    return !chunks.empty() && chunks.back().size - chunks.back().used >= bytes;
+  }
+
+public:
+  Arena() {}
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  ~Arena() {
+    for (Chunk &chunk : chunks) {
+      Unmap(chunk.base, chunk.size);
+    }
+  }
+
+  // Uninitialized room for ``n`` values of ``T``
+  template <typename T> T *Allocate(size_t n) {
+    size_t bytes = n * sizeof(T);
+    bytes = (bytes + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!Fits(bytes)) {
+      AddChunk(bytes);
+    }
+    Chunk &chunk = chunks.back();
+    T *data = reinterpret_cast<T *>(chunk.base + chunk.used);
+    chunk.used += bytes;
+    return data;
+  }
+
+  // Make the next ``bytes`` of allocations fit in the current chunk, such as
+  // the expected size of the arrays of a whole deck
+  void Reserve(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!Fits(bytes)) {
+      AddChunk(bytes);
+    }
+  }
+
+  // Bytes mapped by the arena
+  size_t Capacity() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return capacity;
+  }
+};
+
 // wrap an existing array as a numpy ndarray
 template <typename T, size_t N>
 NDArray<T, N> WrapNDarray(T *data, const std::array<int, N> shape,
@@ -51,6 +176,24 @@ NDArray<T, N> WrapNDarray(T *data, const std::array<int, N> shape,
   return NDArray<T, N>(data, N, shape_, owner);
 }
 
+// Wrap memory kept alive by ``owner``, such as a memory mapped file, as a
+// numpy ndarray without copying it
+template <typename T, size_t N>
+NDArray<T, N> WrapSharedNDArray(T *data, const std::array<int, N> shape,
+                                std::shared_ptr<void> owner) {
+  size_t shape_[N];
+  for (size_t i = 0; i < N; ++i) {
+    shape_[i] = shape[i];
+  }
+
+  std::shared_ptr<void> *holder = new std::shared_ptr<void>(std::move(owner));
+  nb::capsule capsule(holder, [](void *p) noexcept {
+    delete static_cast<std::shared_ptr<void> *>(p);
+  });
+
+  return NDArray<T, N>(data, N, shape_, capsule);
+}
+
 template <typename T, size_t N>
 NDArray<T, N> MakeNDArray(const std::array<int, N> shape,
                           bool zero_initialize = false, bool use_owner = true) {
@@ -75,6 +218,60 @@ NDArray<T, N> MakeNDArray(const std::array<int, N> shape,
   }
 }
 
+// A new read only ndarray of ``shape``, whose elements are set by
+// ``fill(data)`` before it's wrapped
+template <typename T, size_t N, typename F>
+NDArray<const T, N> MakeReadOnlyNDArray(const std::array<int, N> shape,
+                                        F fill) {
+  size_t total = 1;
+  size_t shape_[N];
+  for (size_t i = 0; i < N; i++) {
+    total *= shape[i];
+    shape_[i] = shape[i];
+  }
+
+  T *data = AllocateArray<T>(total);
+  fill(data);
+  nb::capsule owner(data, [](void *p) noexcept { delete[] (T *)p; });
+  return NDArray<const T, N>(data, N, shape_, owner);
+}
+
+// ``array`` as a read only ndarray for Python, sharing its data and
+// keeping it alive
+template <typename T, size_t N>
+nb::object CastReadOnly(const NDArray<T, N> &array) {
+  if (!array.is_valid()) {
+    return nb::none();
+  }
+  size_t shape_[N];
+  for (size_t i = 0; i < N; ++i) {
+    shape_[i] = array.shape(i);
+  }
+
+  NDArray<T, N> *holder = new NDArray<T, N>(array);
+  nb::capsule capsule(holder, [](void *p) noexcept {
+    delete static_cast<NDArray<T, N> *>(p);
+  });
+  return nb::cast(NDArray<const T, N>(array.data(), N, shape_, capsule));
+}
+
+// Store ``array``, which may be read only, in the ndarray type sections
+// keep, sharing its data and keeping it alive. Only for arrays C++ never
+// writes and Python only gets back through CastReadOnly.
+template <typename T, size_t N>
+NDArray<T, N> ShareConstNDArray(const NDArray<const T, N> &array) {
+  size_t shape_[N];
+  for (size_t i = 0; i < N; ++i) {
+    shape_[i] = array.shape(i);
+  }
+
+  NDArray<const T, N> *holder = new NDArray<const T, N>(array);
+  nb::capsule capsule(holder, [](void *p) noexcept {
+    delete static_cast<NDArray<const T, N> *>(p);
+  });
+  return NDArray<T, N>(const_cast<T *>(array.data()), N, shape_, capsule);
+}
+
 // Wrap an existing vector as a numpy ndarray
 template <typename T, size_t N>
 NDArray<T, N> WrapVectorAsNDArray(std::vector<T> &&vec,
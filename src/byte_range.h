@@ -0,0 +1,775 @@
+#ifndef BYTE_RANGE_HEADER_H
+#define BYTE_RANGE_HEADER_H
+
+// The bytes of the files read by the parsers, and the I/O backends that read
+// them: a memory mapped file, or a file read in blocks on a background
+// thread while the blocks already read are parsed.
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+// Most address space reserved for a deck decompressed as it's read, and the
+// step in which that space is committed as the deck arrives
+#define STREAM_MAX_BYTES (size_t(1) << (sizeof(size_t) > 4 ? 40 : 30))
+#define STREAM_COMMIT_BYTES (1 << 26)
+
+// Default size of the blocks read at a time by the pread backend
+#define READ_BLOCK_BYTES (1 << 24)
+
+// How a file is mapped. A copy on write mapping may be modified in memory
+// without changing the file, while changes to a shared writable mapping are
+// written to the file.
+enum class MapMode { Read, CopyOnWrite, Write };
+
+// How the files of a deck are read. ``Map`` maps them with hints to read
+// ahead of the parser, ``MapPopulate`` also reads every page when mapping,
+// and ``Read`` reads them in blocks on a background thread while the blocks
+// already read are parsed.
+enum class IoBackend { Map, MapPopulate, Read };
+
+inline IoBackend ParseIoBackend(const std::string &name) {
+  if (name == "mmap") {
+    return IoBackend::Map;
+  }
+  if (name == "mmap_populate") {
+    return IoBackend::MapPopulate;
+  }
+  if (name == "pread") {
+    return IoBackend::Read;
+  }
+  throw std::invalid_argument("Unknown I/O backend '" + name +
+                              "', expected 'mmap', 'mmap_populate', or "
+                              "'pread'");
+}
+
+// A range of bytes read by the parsers, whether a mapped file or a buffer
+// held in memory
+class ByteRange {
+protected:
+  size_t size;
+  char *start;
+
+public:
+  std::string line;
+  char *current;
+
+  ByteRange(char *data = nullptr, size_t n = 0)
+      : size(n), start(data), current(data) {}
+
+  virtual ~ByteRange() = default;
+
+  // Wait until every byte of the range is available
+  virtual void WaitComplete() {}
+
+  // Bytes of the whole range, including those yet to arrive when that's
+  // known up front
+  virtual size_t FullSize() const { return size; }
+
+  ByteRange(const ByteRange &) = delete;
+  ByteRange &operator=(const ByteRange &) = delete;
+
+  char &operator[](size_t index) {
+    // implement bounds checking?
+    // if (index >= size) {
+    //     throw std::out_of_range("Index out of bounds");
+    // }
+    return current[index];
+  }
+
+  void operator+=(size_t offset) { current += offset; }
+
+  // Seek to the end of the line
+  void seek_eol() {
+    // check if at end of file
+    if (current >= start + size) {
+      // std::cout << "end" << std::endl;
+      return;
+    }
+
+    while (current < start + size && *current != '\n') {
+      current++;
+    }
+
+    if (current < start + size && *current == '\n') {
+      current++;
+    }
+  }
+
+  // True when at end of file
+  bool eof() { return current >= start + size; }
+
+  // First character of the file
+  char *begin() const { return start; }
+
+  // One past the last character of the file
+  char *end() const { return start + size; }
+
+  // True when at end of line (DOS and UNIX EOF)
+  bool eol() { return *current == '\n' || *current == '\r'; }
+
+  bool read_line() {
+    line.clear();
+    if (current >= start + size) {
+      return false;
+    }
+
+    char *line_start = current;
+    while (current < start + size && *current != '\n') {
+      line += *current++;
+    }
+
+    if (current < start + size && *current == '\n') {
+      current++;
+    }
+
+    return line_start != current;
+  }
+
+  size_t current_line_length() const {
+    char *temp = current;
+    size_t length = 0;
+    while (temp < start + size && *temp != '\n') {
+      length++;
+      temp++;
+    }
+    return length;
+  }
+
+  off_t tellg() const { return current - start; }
+};
+
+// A file mapped into memory
+class MemoryMappedFile : public ByteRange {
+private:
+#ifdef _WIN32
+  HANDLE fileHandle;
+  HANDLE mapHandle;
+#else
+  int fd;
+#endif
+
+public:
+  // ``populate`` reads every page of the file while mapping it, where
+  // supported, rather than when each is first touched
+  MemoryMappedFile(const char *filename, MapMode mode = MapMode::Read,
+                   bool populate = false)
+#ifdef _WIN32
+      : fileHandle(INVALID_HANDLE_VALUE), mapHandle(nullptr)
+#else
+      : fd(-1)
+#endif
+  {
+#ifdef _WIN32
+    DWORD desired = GENERIC_READ;
+    if (mode == MapMode::Write) {
+      desired |= GENERIC_WRITE;
+    }
+    fileHandle = CreateFile(filename, desired, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error("Error opening file");
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+      CloseHandle(fileHandle);
+      throw std::runtime_error("Error getting file size");
+    }
+
+    size = static_cast<size_t>(fileSize.QuadPart);
+    (void)populate;
+
+    // an empty file can't be mapped and has nothing to read
+    if (size) {
+      DWORD protect = PAGE_READONLY;
+      DWORD access = FILE_MAP_READ;
+      if (mode == MapMode::CopyOnWrite) {
+        protect = PAGE_WRITECOPY;
+        access = FILE_MAP_COPY;
+      } else if (mode == MapMode::Write) {
+        protect = PAGE_READWRITE;
+        access = FILE_MAP_WRITE;
+      }
+      mapHandle =
+          CreateFileMapping(fileHandle, nullptr, protect, 0, 0, nullptr);
+      if (mapHandle == nullptr) {
+        CloseHandle(fileHandle);
+        throw std::runtime_error("Error creating file mapping");
+      }
+
+      start =
+          static_cast<char *>(MapViewOfFile(mapHandle, access, 0, 0, size));
+      if (start == nullptr) {
+        CloseHandle(mapHandle);
+        CloseHandle(fileHandle);
+        throw std::runtime_error("Error mapping file");
+      }
+    }
+#else
+    fd = open(filename, mode == MapMode::Write ? O_RDWR : O_RDONLY);
+    if (fd == -1) {
+      throw std::runtime_error("Error opening file");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+      close(fd);
+      throw std::runtime_error("Error getting file size");
+    }
+
+    size = st.st_size;
+
+    // an empty file can't be mapped and has nothing to read
+    if (size) {
+      int prot = mode == MapMode::Read ? PROT_READ : PROT_READ | PROT_WRITE;
+      int flags = mode == MapMode::Write ? MAP_SHARED : MAP_PRIVATE;
+#ifdef MAP_POPULATE
+      if (populate) {
+        flags |= MAP_POPULATE;
+      }
+#else
+      (void)populate;
+#endif
+      start = static_cast<char *>(mmap(nullptr, size, prot, flags, fd, 0));
+      if (start == MAP_FAILED) {
+        start = nullptr;
+        close(fd);
+        throw std::runtime_error("Error mapping file");
+      }
+    }
+#endif
+    current = start;
+  }
+
+  ~MemoryMappedFile() {
+    close_file();
+#ifdef _WIN32
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+      CloseHandle(fileHandle);
+    }
+    if (mapHandle != nullptr) {
+      CloseHandle(mapHandle);
+    }
+#else
+    if (fd != -1) {
+      close(fd);
+    }
+#endif
+  }
+
+  // Drop the pages wholly within [begin, end) from memory. The mapping
+  // stays valid, and pages used again are read from the file.
+  void Release(const char *begin, const char *end) {
+#ifdef _WIN32
+    // pages of a view are trimmed from the working set as needed
+    (void)begin;
+    (void)end;
+#else
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t first = (begin - start + page - 1) / page * page;
+    size_t last = (end - start) / page * page;
+    if (first < last) {
+      madvise(start + first, last - first, MADV_DONTNEED);
+    }
+#endif
+  }
+
+  // Hint that the file is read from start to end, so that the pages ahead
+  // of the parser are read in large requests rather than faulted in one at
+  // a time. ``soon`` also starts reading the whole file in the background.
+  void AdviseSequential(bool soon) {
+#ifdef _WIN32
+    // Windows reads ahead of sequential page faults without a hint
+    (void)soon;
+#else
+    if (size) {
+      madvise(start, size, MADV_SEQUENTIAL);
+      if (soon) {
+        madvise(start, size, MADV_WILLNEED);
+      }
+    }
+#endif
+  }
+
+  void close_file() {
+    if (start) {
+#ifdef _WIN32
+      UnmapViewOfFile(start);
+#else
+      munmap(start, size);
+#endif
+      start = nullptr;
+      current = nullptr;
+    }
+  }
+};
+
+// The bytes of a deck written by another thread as it's decompressed, read
+// while they arrive. They're appended to a reservation of address space
+// that's committed as it fills, so the parsers can read the part that has
+// arrived. When they outgrow the reservation the writer moves them to a
+// larger one, and the reader, which may still be reading the old one,
+// follows the next time it waits, so pointers into the range are only
+// valid until the reader's next Wait. The range ends once the stream is
+// closed.
+class StreamedRange : public ByteRange {
+private:
+  // The reservation the writer appends to, which ``start`` follows in Wait
+  char *base = nullptr;
+  size_t capacity = 0;
+  size_t committed = 0;
+  std::once_flag started;
+  // guarded by ``mutex``
+  size_t filled = 0;
+  size_t consumed = 0;   // bytes the reader has waited for
+  size_t read_ahead = 0; // bytes the writer may run ahead of them, or 0
+  bool closed = false;
+  bool aborted = false;
+  std::string error;
+  // reservations the bytes moved out of, freed once the reader follows
+  std::vector<std::pair<char *, size_t>> retired;
+  std::mutex mutex;
+  std::condition_variable changed;
+
+  static size_t RoundUpToCommit(size_t bytes) {
+    return (bytes + STREAM_COMMIT_BYTES - 1) / STREAM_COMMIT_BYTES *
+           STREAM_COMMIT_BYTES;
+  }
+
+  // Reserve ``bytes`` of address space, which costs no memory, returning
+  // nullptr when there isn't room
+  static char *MapReservation(size_t bytes) {
+#ifdef _WIN32
+    return static_cast<char *>(
+        VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS));
+#else
+    void *reserved = mmap(nullptr, bytes, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return reserved == MAP_FAILED ? nullptr : static_cast<char *>(reserved);
+#endif
+  }
+
+  static void UnmapReservation(char *reserved, size_t bytes) {
+#ifdef _WIN32
+    (void)bytes;
+    VirtualFree(reserved, 0, MEM_RELEASE);
+#else
+    munmap(reserved, bytes);
+#endif
+  }
+
+  // Make ``bytes`` at ``begin``, within a reservation, writable
+  static void CommitPages(char *begin, size_t bytes) {
+#ifdef _WIN32
+    if (!VirtualAlloc(begin, bytes, MEM_COMMIT, PAGE_READWRITE)) {
+      throw std::bad_alloc();
+    }
+#else
+    if (mprotect(begin, bytes, PROT_READ | PROT_WRITE) == -1) {
+      throw std::bad_alloc();
+    }
+#endif
+  }
+
+  // Make the first ``bytes`` of the reservation writable, moving to a larger
+  // one when they don't fit. Only called by the writing thread.
+  void Commit(size_t bytes) {
+    if (bytes <= committed) {
+      return;
+    }
+    if (bytes > capacity) {
+      Move(bytes);
+    }
+    size_t end = std::min(capacity, RoundUpToCommit(bytes));
+    CommitPages(base + committed, end - committed);
+    committed = end;
+  }
+
+  // Move the bytes written so far to a reservation of at least ``bytes``,
+  // twice as large as the current one where there's room. The current one
+  // is kept until the reader follows, as it may be reading it.
+  void Move(size_t bytes) {
+    if (bytes > STREAM_MAX_BYTES) {
+      throw std::runtime_error("Deck too large to hold in memory");
+    }
+    size_t needed = RoundUpToCommit(bytes);
+    size_t target = std::min<size_t>(std::max(needed, 2 * capacity),
+                                     RoundUpToCommit(STREAM_MAX_BYTES));
+    char *moved = MapReservation(target);
+    if (!moved && target > needed) {
+      target = needed;
+      moved = MapReservation(target);
+    }
+    if (!moved) {
+      throw std::runtime_error("Deck too large to hold in memory");
+    }
+    size_t written;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      written = filled;
+    }
+    try {
+      if (committed) {
+        CommitPages(moved, committed);
+      }
+    } catch (...) {
+      UnmapReservation(moved, target);
+      throw;
+    }
+    memcpy(moved, base, written);
+    std::lock_guard<std::mutex> lock(mutex);
+    retired.emplace_back(base, capacity);
+    base = moved;
+    capacity = target;
+  }
+
+protected:
+  // For subclasses, which Reserve once they know how many bytes they need
+  struct Unreserved {};
+  explicit StreamedRange(Unreserved) {}
+
+  // Reserve room for ``max_bytes``, or the largest reservation available
+  // below that
+  void Reserve(size_t max_bytes) {
+    max_bytes = std::max<size_t>(max_bytes, 1);
+    size_t reserve = RoundUpToCommit(max_bytes);
+    for (capacity = reserve; capacity >= STREAM_COMMIT_BYTES; capacity /= 2) {
+      base = MapReservation(capacity);
+      if (base) {
+        break;
+      }
+    }
+    if (!base) {
+      throw std::bad_alloc();
+    }
+    start = base;
+    current = start;
+  }
+
+  // Start writing the range, for subclasses that write it themselves. Called
+  // once, by the first Wait.
+  virtual void Start() {}
+
+public:
+  StreamedRange() { Reserve(STREAM_MAX_BYTES); }
+
+  // A stream expected to hold about ``size_hint`` bytes, for which twice
+  // that is reserved, moving to a larger reservation if it's exceeded.
+  // Without a hint, as much as a deck may hold is reserved.
+  explicit StreamedRange(size_t size_hint) {
+    size_hint = std::min<size_t>(size_hint, STREAM_MAX_BYTES / 2);
+    Reserve(size_hint ? 2 * size_hint : STREAM_MAX_BYTES);
+  }
+
+  ~StreamedRange() {
+    if (base) {
+      UnmapReservation(base, capacity);
+    }
+    for (const std::pair<char *, size_t> &old : retired) {
+      UnmapReservation(old.first, old.second);
+    }
+  }
+
+  // Make room for ``n`` more bytes and return where they go, or nullptr
+  // once the reader has stopped. The writer fills the room, then appends
+  // what it wrote with Advance.
+  char *Claim(size_t n) {
+    size_t offset;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      // with a read ahead limit, wait for the reader unless it has caught up
+      changed.wait(lock, [&] {
+        return aborted || closed || !read_ahead || filled == consumed ||
+               filled + n <= consumed + read_ahead;
+      });
+      if (aborted || closed) {
+        return nullptr;
+      }
+      offset = filled;
+    }
+    // readers only read below ``filled``, so filling the room needs no lock
+    Commit(offset + n);
+    return base + offset;
+  }
+
+  // Append ``n`` bytes written to the room from Claim. Returns false once
+  // the reader has stopped.
+  bool Advance(size_t n) {
+    std::lock_guard<std::mutex> lock(mutex);
+    filled += n;
+    changed.notify_all();
+    return !aborted;
+  }
+
+  // Append ``n`` bytes. Returns false, dropping them, once the reader has
+  // stopped.
+  bool Write(const char *data, size_t n) {
+    char *room = Claim(n);
+    if (!room) {
+      return false;
+    }
+    memcpy(room, data, n);
+    return Advance(n);
+  }
+
+  // End the stream, which failed when ``message`` isn't empty
+  void Close(const std::string &message = std::string()) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!closed) {
+      closed = true;
+      error = message;
+      size = filled;
+      changed.notify_all();
+    }
+  }
+
+  // Stop a stream that's still being written, as its reader gave up
+  void Abort() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!closed) {
+      aborted = true;
+      changed.notify_all();
+    }
+  }
+
+  // Wait until more than ``have`` bytes have arrived or the stream is
+  // closed, and return the bytes that have arrived, setting ``done`` when
+  // that's all of them. Throws if the stream failed or was aborted.
+  size_t Wait(size_t have, bool &done) {
+    std::call_once(started, [this] { Start(); });
+    std::unique_lock<std::mutex> lock(mutex);
+    if (have > consumed) {
+      consumed = have;
+      changed.notify_all();
+    }
+    changed.wait(lock, [&] { return filled > have || closed || aborted; });
+    // follow the bytes to the reservation they moved to, freeing the old
+    // ones, which only the reader reads and it doesn't while it waits
+    if (start != base) {
+      current = base + (current - start);
+      start = base;
+      for (const std::pair<char *, size_t> &old : retired) {
+        UnmapReservation(old.first, old.second);
+      }
+      retired.clear();
+    }
+    if (aborted) {
+      throw std::runtime_error("Reading the deck was cancelled");
+    }
+    if (!error.empty()) {
+      throw std::runtime_error(error);
+    }
+    done = closed;
+    return filled;
+  }
+
+  // Hold the writer to ``bytes`` past those the reader has waited for, so
+  // that with Release only about that much of the range is in memory
+  void LimitReadAhead(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    read_ahead = bytes;
+    changed.notify_all();
+  }
+
+  // Free the memory of the pages wholly within [begin, end) of the bytes
+  // that have arrived, which mustn't be read again
+  void Release(size_t begin, size_t end) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size_t page = info.dwPageSize;
+#else
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    size_t first = (begin + page - 1) / page * page;
+    size_t last = end / page * page;
+    if (first >= last) {
+      return;
+    }
+#ifdef _WIN32
+    VirtualFree(start + first, last - first, MEM_DECOMMIT);
+#else
+    madvise(start + first, last - first, MADV_DONTNEED);
+#endif
+  }
+
+  void WaitComplete() override {
+    bool done = false;
+    size_t have = 0;
+    while (!done) {
+      have = Wait(have, done);
+    }
+  }
+};
+
+// A file read into memory in large blocks by a background thread, which
+// reads each block while the ones before it are parsed. On network
+// filesystems a few large reads are much faster than faulting in the pages
+// of a mapped file one at a time, each a round trip to the server.
+//
+// The thread starts when the file is first waited on, so files opened ahead
+// of their parse, like those of DeckLoader, are read no sooner than they're
+// parsed. Every block is kept unless the reader limits the read ahead and
+// releases the blocks it has parsed, as a deck does when it's read in full
+// (see StreamedRange::LimitReadAhead).
+class PrefetchedFile : public StreamedRange {
+private:
+#ifdef _WIN32
+  HANDLE fileHandle;
+#else
+  int fd;
+#endif
+  size_t file_size;
+  size_t block_bytes;
+  std::thread reader;
+
+  // Read up to ``n`` bytes at ``offset`` into ``dest``, returning the bytes
+  // read, which are fewer only at the end of the file
+  size_t ReadAt(char *dest, size_t n, size_t offset) {
+    size_t done = 0;
+    while (done < n) {
+#ifdef _WIN32
+      OVERLAPPED at = {};
+      uint64_t pos = offset + done;
+      at.Offset = static_cast<DWORD>(pos);
+      at.OffsetHigh = static_cast<DWORD>(pos >> 32);
+      DWORD request = static_cast<DWORD>(std::min<size_t>(n - done, 1 << 30));
+      DWORD got = 0;
+      if (!ReadFile(fileHandle, dest + done, request, &got, &at)) {
+        if (GetLastError() == ERROR_HANDLE_EOF) {
+          break;
+        }
+        throw std::runtime_error("Error reading file");
+      }
+#else
+      ssize_t got = pread(fd, dest + done, n - done, offset + done);
+      if (got == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::runtime_error("Error reading file");
+      }
+#endif
+      if (got == 0) {
+        break;
+      }
+      done += got;
+    }
+    return done;
+  }
+
+  // Read the file a block at a time until it's all read or the reader
+  // stops, closing the range with any error
+  void ReadBlocks() {
+    try {
+      size_t offset = 0;
+      while (offset < file_size) {
+        size_t n = std::min(block_bytes, file_size - offset);
+        char *room = Claim(n);
+        if (!room) {
+          return;
+        }
+        size_t got = ReadAt(room, n, offset);
+        if (!Advance(got)) {
+          return;
+        }
+        // the file was truncated while it was read
+        if (got < n) {
+          break;
+        }
+        offset += got;
+      }
+      Close();
+    } catch (const std::exception &err) {
+      Close(err.what());
+    }
+  }
+
+protected:
+  void Start() override {
+    reader = std::thread(&PrefetchedFile::ReadBlocks, this);
+  }
+
+public:
+  PrefetchedFile(const char *filename, size_t block_size)
+      : StreamedRange(Unreserved()), block_bytes(block_size) {
+    if (!block_bytes) {
+      throw std::invalid_argument("The block size must be positive");
+    }
+#ifdef _WIN32
+    fileHandle = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error("Error opening file");
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+      CloseHandle(fileHandle);
+      throw std::runtime_error("Error getting file size");
+    }
+    file_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+      throw std::runtime_error("Error opening file");
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+      close(fd);
+      throw std::runtime_error("Error getting file size");
+    }
+    file_size = st.st_size;
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#endif
+    try {
+      Reserve(file_size);
+    } catch (...) {
+#ifdef _WIN32
+      CloseHandle(fileHandle);
+#else
+      close(fd);
+#endif
+      throw;
+    }
+  }
+
+  ~PrefetchedFile() {
+    Abort();
+    if (reader.joinable()) {
+      reader.join();
+    }
+#ifdef _WIN32
+    CloseHandle(fileHandle);
+#else
+    close(fd);
+#endif
+  }
+
+  size_t FullSize() const override { return file_size; }
+};
+
+#endif
@@ -1,20 +1,38 @@
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <ctype.h>
+#include <deque>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <limits.h>
 #include <math.h>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <sstream>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unordered_map>
 #include <vector>
 
 #include <nanobind/nanobind.h>
 #include <nanobind/ndarray.h>
+#include <nanobind/stl/optional.h>
 #include <nanobind/stl/string.h>
 #include <nanobind/stl/vector.h>
 
 #include "array_support.h"
+#include "byte_range.h"
+#include "deck_cache.h"
+#include "fast_float.h"
+#include "float_format.h"
+#include "id_index.h"
+#include "int_decoder.h"
+#include "thread_pool.h"
 
 using namespace nb::literals;
 
@@ -24,16 +42,50 @@ using namespace nb::literals;
 #define strtok_r strtok_s
 #include <windows.h>
 #else
+#include <errno.h>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <copyfile.h>
+#endif
 #endif
 
 // #define DEBUG
 
-#define NNUM_RESERVE 16384
-#define ENUM_RESERVE 16384
+// Sections smaller than this are always read on a single thread
+#define PARALLEL_MIN_BYTES (1 << 20)
+
+// Number of chunks per thread when splitting a section, for load balancing
+#define CHUNKS_PER_THREAD 4
+
+// Sections read on a single thread are parsed in chunks of about this many
+// bytes, so that progress is reported and cancellation checked as they go
+#define SERIAL_CHUNK_BYTES (1 << 22)
+
+// Cards per block when writing a deck
+#define WRITE_ROWS_PER_BLOCK (1 << 15)
+
+// Bytes buffered before writing each file of WriteNodeVariants
+#define VARIANT_BUFFER_BYTES (1 << 22)
+
+// Most nodes on a single element card
+#define MAX_ELEMENT_NODES 8
+
+// Elements per task when assembling the cells of a grid
+#define CELLS_PER_BLOCK (1 << 16)
+
+// IDs per task when looking up node and element IDs
+#define IDS_PER_BLOCK (1 << 16)
+
+// Bytes of a deck read by a SectionReader between releasing the pages it has
+// read
+#define RELEASE_BYTES (1 << 24)
 
 // VTK cell types
 uint8_t VTK_EMPTY_CELL = 0;
@@ -53,364 +105,795 @@ uint8_t VTK_QUADRATIC_PYRAMID = 27;
 uint8_t VTK_QUADRATIC_WEDGE = 26;
 uint8_t VTK_QUADRATIC_HEXAHEDRON = 25;
 
-static const double DIV_OF_TEN[] = {
-    1.0e-0,  1.0e-1,  1.0e-2,  1.0e-3,  1.0e-4,  1.0e-5,  1.0e-6,
-    1.0e-7,  1.0e-8,  1.0e-9,  1.0e-10, 1.0e-11, 1.0e-12, 1.0e-13,
-    1.0e-14, 1.0e-15, 1.0e-16, 1.0e-17, 1.0e-18, 1.0e-19, 1.0e-20,
-    1.0e-21, 1.0e-22, 1.0e-23, 1.0e-24, 1.0e-25, 1.0e-26, 1.0e-27,
-};
-
-static inline double power_of_ten(int exponent) {
-  double result = 1.0;
-  double base = (exponent < 0) ? 0.1 : 10.0;
-  int abs_exponent = abs(exponent);
-  for (int i = 0; i < abs_exponent; ++i) {
-    result *= base;
-  }
-  return result;
-}
-
-class MemoryMappedFile {
+// The bytes of a buffer, which are kept alive by holding the array viewing
+// them. The parsers only read the bytes.
+class BufferRange : public ByteRange {
 private:
-  size_t size;
-  char *start;
-#ifdef _WIN32
-  HANDLE fileHandle;
-  HANDLE mapHandle;
-#else
-  int fd;
-#endif
+  NDArray<const uint8_t, 1> array;
 
 public:
-  std::string line;
-  char *current;
+  explicit BufferRange(const NDArray<const uint8_t, 1> &arr)
+      : ByteRange(const_cast<char *>(
+                      reinterpret_cast<const char *>(arr.data())),
+                  arr.shape(0)),
+        array(arr) {}
+};
 
-  MemoryMappedFile(const char *filename)
-      : start(nullptr), current(nullptr), size(0)
+// Whether the paths ``a`` and ``b`` name the same existing file, such as
+// through a link or a different relative path
+bool SameFile(const char *a, const char *b) {
 #ifdef _WIN32
-        ,
-        fileHandle(INVALID_HANDLE_VALUE), mapHandle(nullptr)
+  auto identify = [](const char *path, BY_HANDLE_FILE_INFORMATION &info) {
+    HANDLE handle = CreateFile(path, 0,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE |
+                                   FILE_SHARE_DELETE,
+                               nullptr, OPEN_EXISTING, 0, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+    bool found = GetFileInformationByHandle(handle, &info) != 0;
+    CloseHandle(handle);
+    return found;
+  };
+  BY_HANDLE_FILE_INFORMATION info_a, info_b;
+  return identify(a, info_a) && identify(b, info_b) &&
+         info_a.dwVolumeSerialNumber == info_b.dwVolumeSerialNumber &&
+         info_a.nFileIndexHigh == info_b.nFileIndexHigh &&
+         info_a.nFileIndexLow == info_b.nFileIndexLow;
 #else
-        ,
-        fd(-1)
+  struct stat st_a, st_b;
+  return stat(a, &st_a) == 0 && stat(b, &st_b) == 0 &&
+         st_a.st_dev == st_b.st_dev && st_a.st_ino == st_b.st_ino;
 #endif
-  {
+}
+
+// Copy the file ``src`` to ``dst``, replacing ``dst``. Filesystems that
+// support it share the blocks of the two files (a reflink) until either is
+// modified, and otherwise the kernel copies the data without passing it
+// through user space.
+void CloneFile(const char *src, const char *dst) {
 #ifdef _WIN32
-    fileHandle = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
-                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (fileHandle == INVALID_HANDLE_VALUE) {
-      throw std::runtime_error("Error opening file");
-    }
+  // block cloning is used by CopyFile on filesystems supporting it
+  if (!CopyFileA(src, dst, FALSE)) {
+    throw std::runtime_error("Error copying file");
+  }
+#elif defined(__APPLE__)
+  if (copyfile(src, dst, nullptr, COPYFILE_CLONE) != 0) {
+    throw std::runtime_error("Error copying file");
+  }
+#else
+  int in = open(src, O_RDONLY);
+  if (in == -1) {
+    throw std::runtime_error("Error opening file");
+  }
+  struct stat st;
+  if (fstat(in, &st) == -1) {
+    close(in);
+    throw std::runtime_error("Error getting file size");
+  }
+  if (SameFile(src, dst)) {
+    close(in);
+    throw std::invalid_argument("Cannot copy a file onto itself");
+  }
+  int out = open(dst, O_WRONLY | O_CREAT | O_TRUNC, st.st_mode & 0777);
+  if (out == -1) {
+    close(in);
+    throw std::runtime_error("Error creating file");
+  }
 
-    LARGE_INTEGER fileSize;
-    if (!GetFileSizeEx(fileHandle, &fileSize)) {
-      CloseHandle(fileHandle);
-      throw std::runtime_error("Error getting file size");
-    }
+  bool copied = false;
+#ifdef FICLONE
+  copied = ioctl(out, FICLONE, in) == 0;
+#endif
 
-    size = static_cast<size_t>(fileSize.QuadPart);
-    mapHandle =
-        CreateFileMapping(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
-    if (mapHandle == nullptr) {
-      CloseHandle(fileHandle);
-      throw std::runtime_error("Error creating file mapping");
+  off_t remaining = copied ? 0 : st.st_size;
+#ifdef SYS_copy_file_range
+  // called through syscall as the glibc wrapper is recent; unsupported
+  // across filesystems on older kernels, where the copy falls back to read
+  // and write
+  while (remaining > 0) {
+    ssize_t n = syscall(SYS_copy_file_range, in, nullptr, out, nullptr,
+                        static_cast<size_t>(remaining), 0u);
+    if (n <= 0) {
+      break;
     }
+    remaining -= n;
+  }
+#endif
 
-    start = static_cast<char *>(
-        MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, size));
-    if (start == nullptr) {
-      CloseHandle(mapHandle);
-      CloseHandle(fileHandle);
-      throw std::runtime_error("Error mapping file");
+  std::vector<char> buffer;
+  while (remaining > 0) {
+    if (buffer.empty()) {
+      buffer.resize(1 << 20);
     }
-#else
-    fd = open(filename, O_RDONLY);
-    if (fd == -1) {
-      throw std::runtime_error("Error opening file");
+    ssize_t n = read(in, buffer.data(), buffer.size());
+    if (n <= 0) {
+      break;
     }
-
-    struct stat st;
-    if (fstat(fd, &st) == -1) {
-      close(fd);
-      throw std::runtime_error("Error getting file size");
+    for (ssize_t written = 0; written < n;) {
+      ssize_t w = write(out, buffer.data() + written, n - written);
+      if (w == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        close(in);
+        close(out);
+        throw std::runtime_error("Error writing file");
+      }
+      written += w;
     }
+    remaining -= n;
+  }
 
-    size = st.st_size;
-    start =
-        static_cast<char *>(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
-    if (start == MAP_FAILED) {
-      close(fd);
-      throw std::runtime_error("Error mapping file");
-    }
+  close(in);
+  if (close(out) == -1 || remaining > 0) {
+    throw std::runtime_error("Error copying file");
+  }
 #endif
-    current = start;
+}
+
+// Write the ``size`` bytes at ``data`` to ``filename``, replacing it
+void WriteFile(const char *filename, const char *data, size_t size) {
+  std::unique_ptr<FILE, int (*)(FILE *)> fp(fopen(filename, "wb"), fclose);
+  if (!fp) {
+    throw std::runtime_error("Error creating file");
   }
+  if (fwrite(data, 1, size, fp.get()) != size) {
+    throw std::runtime_error("Error writing file");
+  }
+}
 
-  ~MemoryMappedFile() {
-    close_file();
-#ifdef _WIN32
-    if (fileHandle != INVALID_HANDLE_VALUE) {
-      CloseHandle(fileHandle);
+// Start of the line following the one containing ``p``, or ``end`` when
+// there is none
+static inline const char *NextLine(const char *p, const char *end) {
+  const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+  return eol ? eol + 1 : end;
+}
+
+// End of a section's cards beginning at ``begin``. This is the start of the
+// next keyword line or ``end`` when the section runs to the end of the file.
+static const char *FindSectionEnd(const char *begin, const char *end) {
+  const char *p = begin;
+  while (p < end && *p != '*') {
+    p = NextLine(p, end);
+  }
+  return p;
+}
+
+// Split [begin, end) into at most ``n_chunks`` ranges of roughly equal size,
+// each beginning at the start of a line. Returns the chunk boundaries.
+static std::vector<const char *> SplitLines(const char *begin, const char *end,
+                                            size_t n_chunks) {
+  std::vector<const char *> bounds = {begin};
+  size_t chunk_size = (end - begin) / n_chunks + 1;
+
+  for (size_t i = 1; i < n_chunks; i++) {
+    const char *target = begin + i * chunk_size;
+    if (target >= end) {
+      break;
     }
-    if (mapHandle != nullptr) {
-      CloseHandle(mapHandle);
+
+    // a target already at the start of a line stays put
+    const char *line_start = NextLine(target - 1, end);
+    if (line_start >= end) {
+      break;
     }
-#else
-    if (fd != -1) {
-      close(fd);
+    if (line_start > bounds.back()) {
+      bounds.push_back(line_start);
     }
-#endif
   }
 
-  void close_file() {
-    if (start) {
-#ifdef _WIN32
-      UnmapViewOfFile(start);
-#else
-      munmap(start, size);
-#endif
-      start = nullptr;
-      current = nullptr;
+  bounds.push_back(end);
+  return bounds;
+}
+
+// Count the card lines in [begin, end), skipping $ comments
+static size_t CountCardLines(const char *begin, const char *end) {
+  size_t count = 0;
+  for (const char *p = begin; p < end; p = NextLine(p, end)) {
+    if (*p != '$') {
+      count++;
     }
   }
+  return count;
+}
 
-  char &operator[](size_t index) {
-    // implement bounds checking?
-    // if (index >= size) {
-    //     throw std::out_of_range("Index out of bounds");
-    // }
-    return current[index];
-  }
+// A keyword line and the cards that follow it, up to the next keyword
+struct Keyword {
+  std::string name; // keyword without its options, e.g. "*NODE"
+  size_t offset;    // byte offset of the keyword line
+  size_t length;    // bytes from the keyword line to the next keyword
+  size_t line;      // line number of the keyword line, starting at 1
+  size_t source = 0;    // index of the file containing the keyword
+  std::string filename; // path of the file containing the keyword
 
-  void operator+=(size_t offset) { current += offset; }
+  std::string ToString() const {
+    std::ostringstream oss;
+    oss << "Keyword(" << name << ", line=" << line << ", offset=" << offset
+        << ", length=" << length << ")";
+    return oss.str();
+  }
+};
 
-  // Seek to the end of the line
-  void seek_eol() {
-    // check if at end of file
-    if (current >= start + size) {
-      // std::cout << "end" << std::endl;
-      return;
+// Collect the keyword lines in [begin, end), which must start at the
+// beginning of a line. Offsets are relative to ``file_start`` and line
+// numbers are relative to ``begin``, starting at 0. Lengths are left for
+// the caller. Returns the number of lines in the range.
+static size_t ScanKeywords(const char *begin, const char *end,
+                           const char *file_start,
+                           std::vector<Keyword> &keywords) {
+  size_t n_lines = 0;
+  const char *counted = begin;
+  const char *p = begin;
+  while (p < end) {
+    p = static_cast<const char *>(memchr(p, '*', end - p));
+    if (!p) {
+      break;
     }
 
-    while (current < start + size && *current != '\n') {
-      current++;
+    // only a '*' at the start of a line begins a keyword
+    if (p != file_start && p[-1] != '\n') {
+      p++;
+      continue;
     }
 
-    if (current < start + size && *current == '\n') {
-      current++;
+    n_lines += std::count(counted, p, '\n');
+    counted = p;
+
+    const char *name_end = p;
+    while (name_end < end && !isspace(static_cast<unsigned char>(*name_end))) {
+      name_end++;
     }
+    keywords.push_back({std::string(p, name_end),
+                        static_cast<size_t>(p - file_start), 0, n_lines, 0,
+                        std::string()});
+    p = NextLine(p, end);
   }
 
-  // True when at end of file
-  bool eof() { return current >= start + size; }
+  return n_lines + std::count(counted, end, '\n');
+}
+
+// Set the lengths of the keywords collected by ScanKeywords from a file of
+// ``file_size`` bytes, and number their lines from 1
+static void CompleteKeywords(std::vector<Keyword> &keywords,
+                             size_t file_size) {
+  for (size_t i = 0; i < keywords.size(); i++) {
+    Keyword &keyword = keywords[i];
+    size_t next_offset =
+        i + 1 < keywords.size() ? keywords[i + 1].offset : file_size;
+    keyword.length = next_offset - keyword.offset;
+    keyword.line++;
+  }
+}
 
-  // True when at end of line (DOS and UNIX EOF)
-  bool eol() { return *current == '\n' || *current == '\r'; }
+// Sections the reader parses
+enum class SectionType { None, Node, ElementSolid, ElementShell };
+
+// *ELEMENT_TSHELL sections have eight nodes per element and are read as solid
+// sections
+static SectionType KeywordSectionType(const std::string &name) {
+  if (name.compare(0, 5, "*NODE") == 0) {
+    return SectionType::Node;
+  } else if (name.compare(0, 14, "*ELEMENT_SOLID") == 0) {
+    return SectionType::ElementSolid;
+  } else if (name.compare(0, 14, "*ELEMENT_SHELL") == 0) {
+    return SectionType::ElementShell;
+  } else if (name.compare(0, 15, "*ELEMENT_TSHELL") == 0) {
+    return SectionType::ElementSolid;
+  }
+  return SectionType::None;
+}
 
-  bool read_line() {
-    line.clear();
-    if (current >= start + size) {
-      return false;
+// The cards of a keyword, from ``begin`` up to the next keyword, with their
+// surrounding whitespace trimmed. Comments and blank cards are skipped.
+static std::vector<std::string> ReadCards(const char *begin, const char *end) {
+  std::vector<std::string> cards;
+  for (const char *p = begin; p < end && *p != '*';) {
+    const char *next = NextLine(p, end);
+    const char *card_end = next;
+    while (p < card_end && isspace(static_cast<unsigned char>(*p))) {
+      p++;
     }
-
-    char *line_start = current;
-    while (current < start + size && *current != '\n') {
-      line += *current++;
+    while (card_end > p && isspace(static_cast<unsigned char>(card_end[-1]))) {
+      card_end--;
     }
-
-    if (current < start + size && *current == '\n') {
-      current++;
+    if (p < card_end && *p != '$') {
+      cards.emplace_back(p, card_end);
     }
-
-    return line_start != current;
+    p = next;
   }
+  return cards;
+}
 
-  size_t current_line_length() const {
-    char *temp = current;
-    size_t length = 0;
-    while (temp < start + size && *temp != '\n') {
-      length++;
-      temp++;
+// Filename on the cards of an *INCLUDE. A name too long for one card is
+// continued on the next by ending the card with " +".
+static std::string IncludeFilename(const std::vector<std::string> &cards) {
+  std::string name;
+  for (const std::string &card : cards) {
+    size_t n = card.size();
+    if (n < 2 || card.compare(n - 2, 2, " +") != 0) {
+      return name + card;
     }
-    return length;
+    name += card.substr(0, n - 2);
   }
+  return name;
+}
 
-  off_t tellg() const { return current - start; }
-};
+static bool IsAbsolutePath(const std::string &path) {
+  if (!path.empty() && (path[0] == '/' || path[0] == '\\')) {
+    return true;
+  }
+#ifdef _WIN32
+  // a path starting with a drive letter, such as C:\Users
+  return path.size() > 1 && path[1] == ':';
+#else
+  return false;
+#endif
+}
 
-// Fast ASCI string to integer
-static inline int fast_atoi(const char *raw, const int intsz) {
-  int val = 0;
-  int c;
-  char current_char;
+// Directory containing ``path``, or "" for a bare filename
+static std::string DirName(const std::string &path) {
+  size_t sep = path.find_last_of("/\\");
+  return sep == std::string::npos ? std::string() : path.substr(0, sep + 1);
+}
 
-  for (c = 0; c < intsz; ++c) {
-    current_char = *raw++;
+static std::string JoinPath(const std::string &dir, const std::string &name) {
+  if (dir.empty() || IsAbsolutePath(name)) {
+    return name;
+  }
+  char last = dir.back();
+  return last == '/' || last == '\\' ? dir + name : dir + "/" + name;
+}
 
-    // Multiply by 10 only if current_char is a digit
-    if (current_char >= '0' && current_char <= '9') {
-      val = val * 10 + (current_char - '0');
-    }
+// Absolute path of the file at ``path`` with any symbolic links resolved, or
+// "" when there's no such file
+static std::string CanonicalPath(const std::string &path) {
+#ifdef _WIN32
+  DWORD attrs = GetFileAttributesA(path.c_str());
+  char resolved[_MAX_PATH];
+  if (attrs == INVALID_FILE_ATTRIBUTES || (attrs & FILE_ATTRIBUTE_DIRECTORY) ||
+      !_fullpath(resolved, path.c_str(), _MAX_PATH)) {
+    return "";
+  }
+  return resolved;
+#else
+  char *resolved = realpath(path.c_str(), nullptr);
+  if (!resolved) {
+    return "";
   }
+  std::string result(resolved);
+  free(resolved);
 
-  return val;
+  struct stat st;
+  if (stat(result.c_str(), &st) == -1 || S_ISDIR(st.st_mode)) {
+    return "";
+  }
+  return result;
+#endif
 }
 
-// Reads various ansys float formats in the form of
-// "3.7826539829200E+00"
-// "1.0000000000000E-001"
-// "        -6.01203 "
-//
-// fltsz : Number of characters to read in a floating point number
-static inline void ans_strtod(char *raw, int fltsz,
-                              std::vector<double> &node_vec) {
-  char *end = raw + fltsz;
-  double sign = 1;
+// Locate an included file. A relative name is looked up next to the file
+// including it, next to the deck, then in each *INCLUDE_PATH directory.
+// Returns the canonical path of the file, or "" when it can't be found.
+static std::string FindInclude(const std::string &name,
+                               const std::string &parent_dir,
+                               const std::string &deck_dir,
+                               const std::vector<std::string> &include_paths) {
+  if (IsAbsolutePath(name)) {
+    return CanonicalPath(name);
+  }
 
-#ifdef DEBUG
-  std::cout << "ans_strtod called, " << std::endl;
-#endif
+  std::string path = CanonicalPath(JoinPath(parent_dir, name));
+  if (path.empty()) {
+    path = CanonicalPath(JoinPath(deck_dir, name));
+  }
+  for (size_t i = 0; path.empty() && i < include_paths.size(); i++) {
+    path = CanonicalPath(JoinPath(include_paths[i], name));
+  }
+  return path;
+}
 
-  // skip whitespace
-  while (raw < end) {
-    if (*raw != ' ') {
-      break;
+// Field widths of a keyword's cards. Standard cards have 8 character integer
+// and 16 character real fields. I10 cards, of a keyword ending in "%", widen
+// the integers to 10 characters. Long cards, of a keyword ending in "+" or of
+// a deck with *KEYWORD LONG=Y, widen every field to 20 characters. A keyword
+// ending in "-" has standard cards in a long deck.
+enum class CardFormat { Standard, I10, Long };
+
+template <int IntWidth, int FloatWidth> struct CardLayout {
+  static constexpr int int_width = IntWidth;
+  static constexpr int float_width = FloatWidth;
+};
+
+typedef CardLayout<8, 16> StandardCards;
+typedef CardLayout<10, 16> I10Cards;
+typedef CardLayout<20, 20> LongCards;
+
+// Format of the cards following the keyword line at ``line``, where
+// ``deck_format`` is the format set by *KEYWORD. The format suffix may be
+// attached to the keyword or follow it, e.g. "*NODE+" or "*NODE +".
+static CardFormat KeywordCardFormat(const char *line, const char *end,
+                                    CardFormat deck_format) {
+  const char *line_end = NextLine(line, end);
+
+  const char *p = line;
+  while (p < line_end && !isspace(static_cast<unsigned char>(*p))) {
+    p++;
+  }
+  char suffix = p > line ? p[-1] : 0;
+  if (suffix != '+' && suffix != '%' && suffix != '-') {
+    // a suffix on its own after the keyword
+    while (p < line_end && isspace(static_cast<unsigned char>(*p))) {
+      p++;
     }
-    raw++;
+    const char *q = p + 1;
+    bool alone = q >= line_end || isspace(static_cast<unsigned char>(*q));
+    suffix = p < line_end && alone ? *p : 0;
   }
 
-  // either a number or a sign
-  if (*raw == '-') {
-    sign = -1;
-    ++raw;
+  switch (suffix) {
+  case '+':
+    return CardFormat::Long;
+  case '%':
+    return CardFormat::I10;
+  case '-':
+    return CardFormat::Standard;
+  default:
+    return deck_format;
   }
+}
 
-  // next value is always a number
-  // Use integer arithmetric and store as int. We'll convert later
-  uint64_t val_int = *raw++ - '0';
+// Format set by the options of a *KEYWORD line, e.g. "*KEYWORD LONG=Y" or
+// "*KEYWORD I10=Y". Options are case insensitive.
+static CardFormat DeckCardFormat(const char *line, const char *end) {
+  std::string options(line, NextLine(line, end));
+  for (char &c : options) {
+    c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+  }
 
-  // Read through the rest of the number
-  int decimal_digits = 0;
-  bool after_decimal = false;
-  while (raw < end) {
-    if (*raw == 'e' || *raw == 'E') { // can be lowercase
-      break;
-    } else if (*raw >= '0' && *raw <= '9') {
-      val_int = val_int * 10 + (*raw++ - '0');
-      if (after_decimal) {
-        decimal_digits++;
-      }
-    } else if (*raw == '.') {
-      after_decimal = true;
-      raw++;
+  size_t pos = options.find("LONG=");
+  if (pos != std::string::npos && pos + 5 < options.size()) {
+    char value = options[pos + 5];
+    if (value == 'Y' || value == 'S') {
+      return CardFormat::Long;
     }
   }
+  pos = options.find("I10=");
+  if (pos != std::string::npos && pos + 4 < options.size() &&
+      options[pos + 4] == 'Y') {
+    return CardFormat::I10;
+  }
+  return CardFormat::Standard;
+}
 
-  // Compute the floating-point value
-  double val;
-  if (decimal_digits < 27) {
-    val = (double)val_int * DIV_OF_TEN[decimal_digits];
-  } else {
-    val = (double)val_int * power_of_ten(10);
+// Parse one *NODE card [line, line_end): NID (I), X Y Z (E), and the optional
+// TC and RC (I). Fields cut short by the end of the line are read up to it,
+// and missing fields are blank.
+template <typename Layout>
+static inline void ParseNodeLine(const char *line, const char *line_end,
+                                 int *nid, double *coord, int *tc, int *rc) {
+  constexpr int iw = Layout::int_width;
+  constexpr int fw = Layout::float_width;
+  ptrdiff_t length = line_end - line;
+  // characters of the field at ``offset`` of width ``w`` within the line
+  auto width = [length](int offset, int w) {
+    return static_cast<int>(
+        std::max<ptrdiff_t>(0, std::min<ptrdiff_t>(w, length - offset)));
+  };
+
+  *nid = fast_atoi(line, width(0, iw));
+  for (int j = 0; j < 3; j++) {
+    int offset = iw + j * fw;
+    coord[j] = fast_strtod(line + offset, width(offset, fw));
   }
 
-  // Might have scientific notation remaining, for example:
-  // 1.0000000000000E-001
-  int evalue = 0;
-  int esign = 1;
-  if (*raw == 'e' || *raw == 'E') {
-    raw++; // skip "E"
-    // always a sign of some sort
-    if (*raw == '-') {
-      esign = -1;
+  // constraints may be missing, in which case they're zero
+  *tc = fast_atoi(line + iw + 3 * fw, width(iw + 3 * fw, iw));
+  *rc = fast_atoi(line + 2 * iw + 3 * fw, width(2 * iw + 3 * fw, iw));
+}
+
+// Parse one element card: EID, PID, and ``num_nodes`` node IDs
+template <typename Layout>
+static inline void ParseElementLine(const char *line, const char *end,
+                                    int num_nodes, int *eid, int *pid,
+                                    int *node_ids) {
+  int fields[2 + MAX_ELEMENT_NODES];
+  DecodeIntCard<Layout::int_width>(line, end, 2 + num_nodes, fields);
+
+  *eid = fields[0];
+  *pid = fields[1];
+  memcpy(node_ids, fields + 2, num_nodes * sizeof(int));
+}
+
+// Part ID of an element card, decoding no other field
+template <typename Layout>
+static inline int ParseElementPid(const char *line, const char *end) {
+  int fields[2];
+  DecodeIntCard<Layout::int_width>(line, end, 2, fields);
+  return fields[1];
+}
+
+// Split the free format card [line, line_end) at its commas into
+// ``n_fields`` fields, storing the start and length of each with the
+// surrounding blanks trimmed. Missing fields are empty.
+static void SplitFreeCard(const char *line, const char *line_end,
+                          int n_fields, const char **starts, int *lengths) {
+  const char *p = line;
+  for (int i = 0; i < n_fields; i++) {
+    const char *field_end = p;
+    while (field_end < line_end && *field_end != ',') {
+      field_end++;
     }
-    raw++;
 
-    // seek to end
-    while (raw < end) {
-      // read to whitespace or end of the line
-      if (*raw == ' ' || *raw == '\0') {
-        break;
-      }
-      evalue = evalue * 10 + (*raw++ - '0');
+    const char *start = p;
+    while (start < field_end && isspace(static_cast<unsigned char>(*start))) {
+      start++;
     }
-    if (esign == 1) {
-      val *= power_of_ten(evalue);
-    } else {
-      val /= power_of_ten(evalue);
+    const char *stop = field_end;
+    while (stop > start && isspace(static_cast<unsigned char>(stop[-1]))) {
+      stop--;
     }
+    starts[i] = start;
+    lengths[i] = static_cast<int>(stop - start);
+
+    p = field_end < line_end ? field_end + 1 : line_end;
   }
+}
+
+// Parse one comma separated *NODE card
+static void ParseNodeFreeLine(const char *line, const char *line_end,
+                              int *nid, double *coord, int *tc, int *rc) {
+  const char *starts[6];
+  int lengths[6];
+  SplitFreeCard(line, line_end, 6, starts, lengths);
 
-  // store signed value
-  if (sign == -1) {
-    node_vec.push_back(-val);
-  } else {
-    node_vec.push_back(val);
+  *nid = fast_atoi(starts[0], lengths[0]);
+  for (int i = 0; i < 3; i++) {
+    coord[i] = fast_strtod(starts[i + 1], lengths[i + 1]);
   }
+  *tc = fast_atoi(starts[4], lengths[4]);
+  *rc = fast_atoi(starts[5], lengths[5]);
+}
 
-#ifdef DEBUG
-  std::cout << "value: " << val * sign << std::endl;
-#endif
+// Part ID of a comma separated element card
+static int ParseElementFreePid(const char *line, const char *line_end) {
+  const char *starts[2];
+  int lengths[2];
+  SplitFreeCard(line, line_end, 2, starts, lengths);
+  return fast_atoi(starts[1], lengths[1]);
+}
+
+// Parse one comma separated element card
+static void ParseElementFreeLine(const char *line, const char *line_end,
+                                 int num_nodes, int *eid, int *pid,
+                                 int *node_ids) {
+  const char *starts[2 + MAX_ELEMENT_NODES];
+  int lengths[2 + MAX_ELEMENT_NODES];
+  SplitFreeCard(line, line_end, 2 + num_nodes, starts, lengths);
+
+  *eid = fast_atoi(starts[0], lengths[0]);
+  *pid = fast_atoi(starts[1], lengths[1]);
+  for (int i = 0; i < num_nodes; i++) {
+    node_ids[i] = fast_atoi(starts[i + 2], lengths[i + 2]);
+  }
 }
 
-// FORTRAN-like scientific notation string formatting
-void FormatWithExp(char *buffer, size_t buffer_size, double value, int width,
-                   int precision, int num_exp) {
-  // Format the value using snprintf with given width and precision
-  snprintf(buffer, buffer_size, "% *.*E", width, precision, value);
+// Arrays parsed from a node section into the deck's arena, before they're
+// wrapped for Python. This lets sections be parsed on the thread pool.
+struct NodeArrays {
+  int n_nodes = 0;
+  int *nid = nullptr; // null when numbered consecutively from first_nid
+  int first_nid = 0;
+  double *coord = nullptr;
+  float *coord32 = nullptr; // instead of coord, in single precision
+  int *tc = nullptr;        // null, as is rc, when every constraint is zero
+  int *rc = nullptr;
+};
+
+// Arrays parsed from an element section into the deck's arena, like
+// NodeArrays. Every element has ``stride`` nodes.
+struct ElementArrays {
+  int n_elem = 0;
+  int *eid = nullptr; // null when numbered consecutively from first_eid
+  int first_eid = 0;
+  int *pid = nullptr;
+  int *node_ids = nullptr;
+  int stride = 0;
+};
+
+// Arrays of every section of a deck, in the order of its keywords of each
+// type
+struct ParsedSections {
+  std::vector<NodeArrays> nodes;
+  std::vector<ElementArrays> solids;
+  std::vector<ElementArrays> shells;
+};
 
-  // Find the 'E' in the output, which marks the beginning of the exponent.
-  char *exponent_pos = strchr(buffer, 'E');
+// A section of a deck parsed while the deck streamed in, and the format it
+// was parsed with
+struct StreamedSection {
+  CardFormat format;
+  NodeArrays nodes;
+  ElementArrays elements;
+};
 
-  // Check the current length of the exponent (after 'E+')
-  int exp_length = strlen(exponent_pos + 2);
+// Sections parsed while a deck streamed in, by the offset of their keyword
+using StreamedSections = std::unordered_map<size_t, StreamedSection>;
 
-  // If the exponent is shorter than the desired number of digits
-  if (exp_length < num_exp) {
-    // Shift the exponent one place to the right and prepend a '0'
-    for (int i = exp_length + 1; i > 0; i--) {
-      exponent_pos[2 + i] = exponent_pos[1 + i];
+// Node IDs numbered consecutively from ``first``, or -1 for IDs that aren't
+static int64_t ConsecutiveIdsStart(const int *ids, int n) {
+  if (n == 0) {
+    return -1;
+  }
+  for (int i = 1; i < n; i++) {
+    if (static_cast<int64_t>(ids[i]) != static_cast<int64_t>(ids[0]) + i) {
+      return -1;
     }
-    exponent_pos[2] = '0';
+  }
+  return ids[0];
+}
 
-    // Shift the entire buffer to the left to remove the space added by snprintf
-    memmove(
-        buffer, buffer + 1,
-        strlen(
-            buffer)); // length of buffer not recalculated, using previous value
+// Whether every value of ``values`` is zero
+static bool AllZero(const int *values, int n) {
+  for (int i = 0; i < n; i++) {
+    if (values[i]) {
+      return false;
+    }
   }
+  return true;
 }
 
+// Guards the arrays a section materializes for Python. Copies of a section
+// get a mutex of their own.
+struct MaterializeMutex {
+  nb::ft_mutex mutex;
+
+  MaterializeMutex() {}
+  MaterializeMutex(const MaterializeMutex &) {}
+  MaterializeMutex &operator=(const MaterializeMutex &) { return *this; }
+};
+
+// Node IDs, coordinates, and constraints of a *NODE section.
+//
+// Sections parsed from a deck don't store node IDs numbered consecutively
+// from ``first_nid`` or constraints that are all zero, and store single
+// precision coordinates in ``coord32`` rather than ``coord``. Read them from
+// C++ with the accessors, which work either way. The arrays for Python are
+// materialized the first time they're requested, under ``materialize``, and
+// the flags describing the stored arrays never change after construction,
+// so a section may be read from several threads at once. Node IDs and
+// constraints are read only for Python whether they're stored or not, as
+// changing a materialized array wouldn't change the section.
 struct NodeSection {
   NDArray<int, 1> nid;
   NDArray<double, 2> coord;
+  NDArray<float, 2> coord32;
   NDArray<int, 1> tc;
   NDArray<int, 1> rc;
+  // materialized for Python when the arrays above aren't stored
+  NDArray<const int, 1> nid_view;
+  NDArray<const int, 1> tc_view;
+  NDArray<const int, 1> rc_view;
   int n_nodes = 0;
   int fpos = 0;
+  std::string filename; // file the section was read from
+  bool implicit_nid = false;
+  int first_nid = 0;
+  bool zero_constraints = false;
+  bool single_precision = false;
+  MaterializeMutex materialize;
 
   // Default constructor
   NodeSection() {}
 
-  NodeSection(std::vector<int> nid_vec, std::vector<double> nodes_vec,
-              std::vector<int> tc_vec, std::vector<int> rc_vec,
+  // Wrap arrays parsed into ``arena``, which they keep alive
+  NodeSection(const NodeArrays &arrays, const std::shared_ptr<Arena> &arena,
               int file_position) {
-    n_nodes = nid_vec.size();
-    std::array<int, 1> nid_shape = {static_cast<int>(n_nodes)};
-    std::array<int, 2> coord_shape = {static_cast<int>(n_nodes), 3};
+    n_nodes = arrays.n_nodes;
+    std::array<int, 1> nid_shape = {n_nodes};
+    std::array<int, 2> coord_shape = {n_nodes, 3};
 
     // store file position where node block began
     fpos = file_position;
 
-    // Wrap vectors as NDArrays
-    nid = WrapVectorAsNDArray(std::move(nid_vec), nid_shape);
-    coord = WrapVectorAsNDArray(std::move(nodes_vec), coord_shape);
-    tc = WrapVectorAsNDArray(std::move(tc_vec), nid_shape);
-    rc = WrapVectorAsNDArray(std::move(rc_vec), nid_shape);
+    implicit_nid = !arrays.nid;
+    first_nid = arrays.first_nid;
+    if (!implicit_nid) {
+      nid = WrapSharedNDArray<int, 1>(arrays.nid, nid_shape, arena);
+    }
+    single_precision = arrays.coord32 != nullptr;
+    if (single_precision) {
+      coord32 = WrapSharedNDArray<float, 2>(arrays.coord32, coord_shape, arena);
+    } else {
+      coord = WrapSharedNDArray<double, 2>(arrays.coord, coord_shape, arena);
+    }
+    zero_constraints = !arrays.tc;
+    if (!zero_constraints) {
+      tc = WrapSharedNDArray<int, 1>(arrays.tc, nid_shape, arena);
+      rc = WrapSharedNDArray<int, 1>(arrays.rc, nid_shape, arena);
+    }
   }
 
+  // Use arrays that are already wrapped, such as ones loaded from the cache
+  NodeSection(NDArray<int, 1> nid_arr, NDArray<double, 2> coord_arr,
+              NDArray<int, 1> tc_arr, NDArray<int, 1> rc_arr,
+              int file_position)
+      : nid(nid_arr), coord(coord_arr), tc(tc_arr), rc(rc_arr),
+        n_nodes(static_cast<int>(nid_arr.shape(0))), fpos(file_position) {}
+
   int Length() { return n_nodes; }
 
+  int Nid(int i) const { return implicit_nid ? first_nid + i : nid(i); }
+  double Coord(int i, int j) const {
+    return single_precision ? coord32(i, j) : coord(i, j);
+  }
+  int Tc(int i) const { return zero_constraints ? 0 : tc(i); }
+  int Rc(int i) const { return zero_constraints ? 0 : rc(i); }
+
+  void CopyNid(int *dst) const {
+    if (implicit_nid) {
+      for (int i = 0; i < n_nodes; i++) {
+        dst[i] = first_nid + i;
+      }
+    } else {
+      memcpy(dst, nid.data(), n_nodes * sizeof(int));
+    }
+  }
+
+  void CopyCoordinates(double *dst) const {
+    if (single_precision) {
+      const float *src = coord32.data();
+      for (int i = 0; i < n_nodes * 3; i++) {
+        dst[i] = src[i];
+      }
+    } else {
+      memcpy(dst, coord.data(), n_nodes * 3 * sizeof(double));
+    }
+  }
+
+  // Arrays for Python, materialized on first access
+  nb::object NidArray() {
+    if (!implicit_nid) {
+      return CastReadOnly(nid);
+    }
+    nb::ft_lock_guard lock(materialize.mutex);
+    if (!nid_view.is_valid()) {
+      nid_view = MakeReadOnlyNDArray<int, 1>(
+          {n_nodes}, [this](int *data) { CopyNid(data); });
+    }
+    return nb::cast(nid_view);
+  }
+
+  nb::object Coordinates() {
+    return single_precision ? nb::cast(coord32) : nb::cast(coord);
+  }
+
+  nb::object TcArray() {
+    if (!zero_constraints) {
+      return CastReadOnly(tc);
+    }
+    nb::ft_lock_guard lock(materialize.mutex);
+    MaterializeConstraints();
+    return nb::cast(tc_view);
+  }
+
+  nb::object RcArray() {
+    if (!zero_constraints) {
+      return CastReadOnly(rc);
+    }
+    nb::ft_lock_guard lock(materialize.mutex);
+    MaterializeConstraints();
+    return nb::cast(rc_view);
+  }
+
+  void MaterializeConstraints() {
+    if (!tc_view.is_valid()) {
+      auto zero = [this](int *data) { memset(data, 0, n_nodes * sizeof(int)); };
+      tc_view = MakeReadOnlyNDArray<int, 1>({n_nodes}, zero);
+      rc_view = MakeReadOnlyNDArray<int, 1>({n_nodes}, zero);
+    }
+  }
+
   std::string ToString() const {
     std::ostringstream oss;
     if (n_nodes > 1) {
@@ -427,17 +910,17 @@ struct NodeSection {
 
     // Output first 3 nodes in Fortran-like format
     for (int i = 0; i < std::min(10, n_nodes); ++i) {
-      oss << std::setw(8) << nid(i) << " " // Node ID (nid)
+      oss << std::setw(8) << Nid(i) << " " // Node ID (nid)
           << std::setw(15) << std::scientific << std::setprecision(8)
-          << coord(i, 0) << " " // X
+          << Coord(i, 0) << " " // X
           << std::setw(15) << std::scientific << std::setprecision(8)
-          << coord(i, 1) << " " // Y
+          << Coord(i, 1) << " " // Y
           << std::setw(15) << std::scientific << std::setprecision(8)
-          << coord(i, 2) << " "; // Z
+          << Coord(i, 2) << " "; // Z
 
       // constraints
-      oss << std::setw(8) << tc(i) << " " // tc
-          << std::setw(8) << rc(i);       // rc
+      oss << std::setw(8) << Tc(i) << " " // tc
+          << std::setw(8) << Rc(i);       // rc
 
       oss << "\n";
     }
@@ -450,39 +933,96 @@ struct NodeSection {
   }
 };
 
+// Element IDs, part IDs, and nodes of an element section.
+//
+// Sections parsed from a deck don't store element IDs numbered
+// consecutively from ``first_eid``, or the offsets of their elements, which
+// all have ``stride`` nodes. These are materialized for Python, and like the
+// node IDs of NodeSection are read only whether they're stored or not.
 struct ElementSection {
   NDArray<int, 1> eid;
   NDArray<int, 1> pid;
   NDArray<int, 1> node_ids;
   NDArray<int, 1> node_id_offsets;
+  // materialized for Python when the arrays above aren't stored
+  NDArray<const int, 1> eid_view;
+  NDArray<const int, 1> node_id_offsets_view;
   std::string name = "ElementSection";
   int n_elem = 0;
+  int fpos = 0;         // file position where the element cards begin
+  std::string filename; // file the section was read from
+  bool implicit_eid = false;
+  int first_eid = 0;
+  int stride = 0; // nodes of every element when the offsets aren't stored
+  MaterializeMutex materialize;
 
   ElementSection() {}
 
-  ElementSection(std::vector<int> eid_vec, std::vector<int> pid_vec,
-                 std::vector<int> node_ids_vec,
-                 std::vector<int> node_id_offsets_vec) {
-    n_elem = eid_vec.size();
-    std::array<int, 1> nel_shape = {static_cast<int>(n_elem)};
-    std::array<int, 1> node_ids_shape = {
-        static_cast<int>(node_id_offsets_vec.back())};
-    std::array<int, 1> node_ids_offsets_shape = {
-        static_cast<int>(eid_vec.size() + 1)};
-
-    eid = WrapVectorAsNDArray(std::move(eid_vec), nel_shape);
-    pid = WrapVectorAsNDArray(std::move(pid_vec), nel_shape);
-    node_ids = WrapVectorAsNDArray(std::move(node_ids_vec), node_ids_shape);
-    node_id_offsets = WrapVectorAsNDArray(std::move(node_id_offsets_vec),
-                                          node_ids_offsets_shape);
+  // Wrap arrays parsed into ``arena``, which they keep alive
+  ElementSection(const ElementArrays &arrays,
+                 const std::shared_ptr<Arena> &arena) {
+    n_elem = arrays.n_elem;
+    std::array<int, 1> nel_shape = {n_elem};
+    std::array<int, 1> node_ids_shape = {n_elem * arrays.stride};
+
+    implicit_eid = !arrays.eid;
+    first_eid = arrays.first_eid;
+    if (!implicit_eid) {
+      eid = WrapSharedNDArray<int, 1>(arrays.eid, nel_shape, arena);
+    }
+    pid = WrapSharedNDArray<int, 1>(arrays.pid, nel_shape, arena);
+    node_ids =
+        WrapSharedNDArray<int, 1>(arrays.node_ids, node_ids_shape, arena);
+    stride = arrays.stride;
   }
 
+  // Use arrays that are already wrapped, such as ones loaded from the cache
+  ElementSection(NDArray<int, 1> eid_arr, NDArray<int, 1> pid_arr,
+                 NDArray<int, 1> node_ids_arr,
+                 NDArray<int, 1> node_id_offsets_arr)
+      : eid(eid_arr), pid(pid_arr), node_ids(node_ids_arr),
+        node_id_offsets(node_id_offsets_arr),
+        n_elem(static_cast<int>(eid_arr.shape(0))) {}
+
   int Length() { return n_elem; }
 
+  int Eid(int i) const { return implicit_eid ? first_eid + i : eid(i); }
+  int Offset(int i) const { return stride ? i * stride : node_id_offsets(i); }
+
+  // Arrays for Python, materialized on first access
+  nb::object EidArray() {
+    if (!implicit_eid) {
+      return CastReadOnly(eid);
+    }
+    nb::ft_lock_guard lock(materialize.mutex);
+    if (!eid_view.is_valid()) {
+      eid_view = MakeReadOnlyNDArray<int, 1>({n_elem}, [this](int *data) {
+        for (int i = 0; i < n_elem; i++) {
+          data[i] = first_eid + i;
+        }
+      });
+    }
+    return nb::cast(eid_view);
+  }
+
+  nb::object NodeIdOffsetsArray() {
+    if (!stride) {
+      return CastReadOnly(node_id_offsets);
+    }
+    nb::ft_lock_guard lock(materialize.mutex);
+    if (!node_id_offsets_view.is_valid()) {
+      node_id_offsets_view =
+          MakeReadOnlyNDArray<int, 1>({n_elem + 1}, [this](int *data) {
+            for (int i = 0; i <= n_elem; i++) {
+              data[i] = i * stride;
+            }
+          });
+    }
+    return nb::cast(node_id_offsets_view);
+  }
+
   std::string ToString() const {
     std::ostringstream oss;
-    int n_elem = eid.size();
-
     oss << name << " containing " << n_elem;
     if (n_elem > 1) {
       oss << " elements\n\n";
@@ -499,12 +1039,12 @@ struct ElementSection {
     // Output first 10 elements (or less) in Fortran-like format
     for (int i = 0; i < std::min(10, n_elem); ++i) {
       // Print element ID and part ID
-      oss << std::setw(8) << eid(i) << ""  // EID
+      oss << std::setw(8) << Eid(i) << ""  // EID
           << std::setw(8) << pid(i) << ""; // PID
 
       // Retrieve node IDs associated with this element
-      int start = node_id_offsets(i);
-      int end = node_id_offsets(i + 1);
+      int start = Offset(i);
+      int end = Offset(i + 1);
 
       // Print node IDs for the element
       for (int j = start; j < end; ++j) {
@@ -523,13 +1063,86 @@ struct ElementSection {
   }
 };
 
+// VTK cell type of an 8 node solid element. Repeated nodes collapse it to a
+// tetrahedron or a wedge.
+static inline uint8_t SolidCellType(const int *nodes) {
+  if (nodes[3] == nodes[4]) {
+    return VTK_TETRA;
+  } else if (nodes[5] == nodes[6]) {
+    return VTK_WEDGE;
+  }
+  return VTK_HEXAHEDRON;
+}
+
+// VTK cell type of a 4 node shell element, a triangle when its last node
+// repeats
+static inline uint8_t ShellCellType(const int *nodes) {
+  return nodes[2] == nodes[3] ? VTK_TRIANGLE : VTK_QUAD;
+}
+
+// Number of points of the VTK cells of solid and shell elements
+static inline int CellWidth(uint8_t celltype) {
+  if (celltype == VTK_TRIANGLE) {
+    return 3;
+  } else if (celltype == VTK_QUAD || celltype == VTK_TETRA) {
+    return 4;
+  } else if (celltype == VTK_WEDGE) {
+    return 6;
+  }
+  return 8;
+}
+
+// Write the points of a solid element's VTK cell, each node ID mapped with
+// ``map_id``. Returns the number of points written.
+template <typename T, typename F>
+static inline int WriteSolidCell(const int *nodes, uint8_t celltype, T *cells,
+                                 F map_id) {
+  if (celltype == VTK_TETRA) {
+    for (int j = 0; j < 4; j++) {
+      cells[j] = map_id(nodes[j]);
+    }
+    return 4;
+  } else if (celltype == VTK_WEDGE) {
+    // map to vtk style
+    static const int wedge_order[6] = {0, 1, 4, 3, 2, 5};
+    for (int j = 0; j < 6; j++) {
+      cells[j] = map_id(nodes[wedge_order[j]]);
+    }
+    return 6;
+  }
+  for (int j = 0; j < 8; j++) {
+    cells[j] = map_id(nodes[j]);
+  }
+  return 8;
+}
+
+// Write the points of a shell element's VTK cell, like WriteSolidCell
+template <typename T, typename F>
+static inline int WriteShellCell(const int *nodes, uint8_t celltype, T *cells,
+                                 F map_id) {
+  int width = celltype == VTK_TRIANGLE ? 3 : 4;
+  for (int j = 0; j < width; j++) {
+    cells[j] = map_id(nodes[j]);
+  }
+  return width;
+}
+
+// Leave node IDs as they are, for a section's own cells
+static inline int64_t SameId(int id) { return id; }
+
 struct ElementSolidSection : public ElementSection {
   ElementSolidSection() : ElementSection() {}
 
-  ElementSolidSection(std::vector<int> eid_vec, std::vector<int> pid_vec,
-                      std::vector<int> node_ids_vec,
-                      std::vector<int> node_id_offsets_vec)
-      : ElementSection(eid_vec, pid_vec, node_ids_vec, node_id_offsets_vec) {
+  ElementSolidSection(const ElementArrays &arrays,
+                      const std::shared_ptr<Arena> &arena)
+      : ElementSection(arrays, arena) {
+    name = "ElementSolidSection";
+  }
+
+  ElementSolidSection(NDArray<int, 1> eid_arr, NDArray<int, 1> pid_arr,
+                      NDArray<int, 1> node_ids_arr,
+                      NDArray<int, 1> node_id_offsets_arr)
+      : ElementSection(eid_arr, pid_arr, node_ids_arr, node_id_offsets_arr) {
     name = "ElementSolidSection";
   }
 
@@ -547,45 +1160,19 @@ struct ElementSolidSection : public ElementSection {
     int64_t *offsets = offsets_arr.data();
     int64_t *cells = AllocateArray<int64_t>(node_ids.size());
 
-    const int *node_id_offsets_data = node_id_offsets.data();
     const int *node_ids_data = node_ids.data();
 
     int c = 0;
     offsets[0] = 0;
-    uint8_t celltype = VTK_EMPTY_CELL;
-    for (int i = 0; i < n_elem; i++) {
-
-      int el_sz = 0;
-      int offset = node_id_offsets_data[i];
-      if (node_ids_data[offset + 3] == node_ids_data[offset + 4]) {
-        celltypes[i] = VTK_TETRA;
-        cells[c++] = node_ids_data[offset + 0];
-        cells[c++] = node_ids_data[offset + 1];
-        cells[c++] = node_ids_data[offset + 2];
-        cells[c++] = node_ids_data[offset + 3];
-        el_sz = 4;
-      } else if (node_ids_data[offset + 5] == node_ids_data[offset + 6]) {
-        celltypes[i] = VTK_WEDGE;
-        // map to vtk style
-        cells[c++] = node_ids_data[offset + 0];
-        cells[c++] = node_ids_data[offset + 1];
-        cells[c++] = node_ids_data[offset + 4];
-        cells[c++] = node_ids_data[offset + 3];
-        cells[c++] = node_ids_data[offset + 2];
-        cells[c++] = node_ids_data[offset + 5];
-        el_sz = 6;
-      } else {
-        celltypes[i] = VTK_HEXAHEDRON;
-        // assuming compiler is smart enough to unroll this
-        for (int j = 0; j < 8; j++) {
-          cells[c++] = node_ids_data[offset + j];
-        }
-        el_sz = 8;
-      } // cell type branching
-
-      offsets[i + 1] = offsets[i] + el_sz; // start of next cell
-
-    } // for each cell
+    {
+      nb::gil_scoped_release release;
+      for (int i = 0; i < n_elem; i++) {
+        const int *nodes = node_ids_data + Offset(i);
+        celltypes[i] = SolidCellType(nodes);
+        c += WriteSolidCell(nodes, celltypes[i], cells + c, SameId);
+        offsets[i + 1] = c; // start of next cell
+      } // for each cell
+    }
 
     NDArray<int64_t, 1> cells_arr = WrapNDarray<int64_t, 1>(cells, {c});
     return nb::make_tuple(cells_arr, offsets_arr, celltypes_arr);
@@ -595,10 +1182,16 @@ struct ElementSolidSection : public ElementSection {
 struct ElementShellSection : public ElementSection {
   ElementShellSection() : ElementSection() {}
 
-  ElementShellSection(std::vector<int> eid_vec, std::vector<int> pid_vec,
-                      std::vector<int> node_ids_vec,
-                      std::vector<int> node_id_offsets_vec)
-      : ElementSection(eid_vec, pid_vec, node_ids_vec, node_id_offsets_vec) {
+  ElementShellSection(const ElementArrays &arrays,
+                      const std::shared_ptr<Arena> &arena)
+      : ElementSection(arrays, arena) {
+    name = "ElementShellSection";
+  }
+
+  ElementShellSection(NDArray<int, 1> eid_arr, NDArray<int, 1> pid_arr,
+                      NDArray<int, 1> node_ids_arr,
+                      NDArray<int, 1> node_id_offsets_arr)
+      : ElementSection(eid_arr, pid_arr, node_ids_arr, node_id_offsets_arr) {
     name = "ElementShellSection";
   }
 
@@ -612,30 +1205,20 @@ struct ElementShellSection : public ElementSection {
     int64_t *offsets = offsets_arr.data();
     int64_t *cells = AllocateArray<int64_t>(node_ids.size());
 
-    const int *node_id_offsets_data = node_id_offsets.data();
     const int *node_ids_data = node_ids.data();
 
-    int el_sz = 0;
     int c = 0;
     offsets[0] = 0;
-    uint8_t celltype = VTK_EMPTY_CELL;
-    for (int i = 0; i < n_elem; i++) {
-      // determine if the cell is a quad or triangle
-      int offset = node_id_offsets_data[i];
-      if (node_ids_data[offset + 2] == node_ids_data[offset + 3]) {
-        celltypes[i] = VTK_TRIANGLE;
-        el_sz = 3;
-      } else {
-        celltypes[i] = VTK_QUAD;
-        el_sz = 4;
-      }
-
-      offsets[i + 1] = offsets[i] + el_sz; // start of next cell
-      for (int j = 0; j < el_sz; j++) {
-        cells[c++] = node_ids_data[offset + j];
-      }
-
-    } // for each cell
+    {
+      nb::gil_scoped_release release;
+      for (int i = 0; i < n_elem; i++) {
+        // determine if the cell is a quad or triangle
+        const int *nodes = node_ids_data + Offset(i);
+        celltypes[i] = ShellCellType(nodes);
+        c += WriteShellCell(nodes, celltypes[i], cells + c, SameId);
+        offsets[i + 1] = c; // start of next cell
+      } // for each cell
+    }
 
     // make a new ndarray wrapping the old data with a new size rather than
     // reallocating
@@ -644,377 +1227,3224 @@ struct ElementShellSection : public ElementSection {
   } // to vtk
 };
 
-class Deck {
-
-private:
-  bool debug;
-  std::string filename;
-  MemoryMappedFile memmap;
+// Range of elements of a section whose VTK cells are assembled by one task
+struct CellBlock {
+  const ElementSection *section;
+  const int *node_ids;
+  const int *pid;
+  bool solid;
+  int begin; // first element of the section
+  int end;   // one past the last element
+  size_t cell;   // first cell in the grid
+  size_t conn;   // start of the block's points in the connectivity
+  size_t n_conn; // number of points in the block's cells
+};
 
-public:
-  std::vector<NodeSection> node_sections;
-  std::vector<ElementSolidSection> element_solid_sections;
-  std::vector<ElementShellSection> element_shell_sections;
+// Widths of the integer and real fields of cards in ``format``
+static int IntWidth(CardFormat format) {
+  switch (format) {
+  case CardFormat::I10:
+    return I10Cards::int_width;
+  case CardFormat::Long:
+    return LongCards::int_width;
+  default:
+    return StandardCards::int_width;
+  }
+}
 
-  Deck(const std::string &fname) : filename(fname), memmap(fname.c_str()) {
+static int FloatWidth(CardFormat format) {
+  return format == CardFormat::Long ? LongCards::float_width
+                                    : StandardCards::float_width;
+}
+
+// Call fn(row, field) for the first ``n_rows`` *NODE cards in [begin, end),
+// skipping $ comments, where ``field`` is the offset from ``begin`` of the
+// card's X field. Throws unless every card holds its three coordinates in
+// fixed width fields that can be overwritten in place.
+template <typename F>
+static void ForEachNodeCard(CardFormat format, const char *begin,
+                            const char *end, size_t n_rows, F fn) {
+  int int_width = IntWidth(format);
+  int min_width = int_width + 3 * FloatWidth(format);
+
+  const char *p = begin;
+  for (size_t row = 0; row < n_rows && p < end;) {
+    const char *line_end = NextLine(p, end);
+    if (*p == '$') {
+      p = line_end;
+      continue;
+    }
+
+    // neither the newline nor a DOS carriage return are part of the card
+    const char *card_end = line_end[-1] == '\n' ? line_end - 1 : line_end;
+    if (card_end > p && card_end[-1] == '\r') {
+      card_end--;
+    }
+    if (memchr(p, ',', card_end - p)) {
+      throw std::runtime_error(
+          "Only fixed width node cards can be overwritten");
+    }
+    if (card_end - p < min_width) {
+      throw std::runtime_error(
+          "Node card is too short to overwrite its coordinates in place");
+    }
+
+    fn(row, static_cast<size_t>(p - begin) + int_width);
+    row++;
+    p = line_end;
+  }
+}
+
+// Format the coordinates ``xyz`` into three fields of ``width`` characters
+// at ``dst``
+static void FormatCoordinates(char *dst, const double *xyz, int width) {
+  for (int ii = 0; ii < 3; ii++) {
+    if (!isfinite(xyz[ii])) {
+      throw std::invalid_argument("Node coordinates must be finite");
+    }
+    FormatExpField(dst + ii * width, xyz[ii], width);
+  }
+}
+
+// Check there's one set of coordinates for each node
+static void CheckNodeCount(size_t n_coord, size_t n_nodes) {
+  if (n_coord != n_nodes) {
+    throw std::invalid_argument(
+        "Number of coordinates (" + std::to_string(n_coord) +
+        ") must match the number of nodes in the node sections (" +
+        std::to_string(n_nodes) + ")");
+  }
+}
+
+// Overwrite the coordinates of the first ``n_rows`` *NODE cards in
+// [begin, end) with ``coord``, skipping $ comments. The rest of each card,
+// including its node ID and constraints, is left as is.
+static void WriteNodeCards(CardFormat format, char *begin, char *end,
+                           const double *coord, size_t n_rows) {
+  int width = FloatWidth(format);
+  ForEachNodeCard(format, begin, end, n_rows, [&](size_t row, size_t field) {
+    FormatCoordinates(begin + field, coord + row * 3, width);
+  });
+}
+
+// Write ``value`` right justified in ``width`` characters at ``dst``
+static inline void FormatIntField(char *dst, int value, int width) {
+  char digits[12];
+  int n = 0;
+  unsigned int magnitude = value < 0 ? 0u - static_cast<unsigned int>(value)
+                                     : static_cast<unsigned int>(value);
+  do {
+    digits[n++] = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude);
+  if (value < 0) {
+    digits[n++] = '-';
+  }
+  if (n > width) {
+    throw std::invalid_argument(
+        std::to_string(value) + " doesn't fit in a field of " +
+        std::to_string(width) + " characters; write in long format");
+  }
+
+  memset(dst, ' ', width - n);
+  for (int i = 0; i < n; i++) {
+    dst[width - 1 - i] = digits[i];
+  }
+}
+
+// Format the *NODE cards of nodes [begin, end) of ``section`` into ``out``
+static void FormatNodeCards(const NodeSection &section, int begin, int end,
+                            CardFormat format, std::string &out) {
+  int int_width = IntWidth(format);
+  int float_width = FloatWidth(format);
+  int line_width = 3 * int_width + 3 * float_width + 1;
+  out.resize(static_cast<size_t>(end - begin) * line_width);
+
+  char *p = &out[0];
+  for (int i = begin; i < end; i++) {
+    FormatIntField(p, section.Nid(i), int_width);
+    p += int_width;
+    double xyz[3] = {section.Coord(i, 0), section.Coord(i, 1),
+                     section.Coord(i, 2)};
+    FormatCoordinates(p, xyz, float_width);
+    p += 3 * float_width;
+    FormatIntField(p, section.Tc(i), int_width);
+    FormatIntField(p + int_width, section.Rc(i), int_width);
+    p += 2 * int_width;
+    *p++ = '\n';
+  }
+}
+
+// Format the cards of elements [begin, end) of ``section``, each with
+// ``num_nodes`` nodes, into ``out``. Elements with fewer nodes repeat their
+// last node, as triangles and tetrahedra do in a deck.
+static void FormatElementCards(const ElementSection &section, int num_nodes,
+                               int begin, int end, CardFormat format,
+                               std::string &out) {
+  int width = IntWidth(format);
+  int line_width = (2 + num_nodes) * width + 1;
+  out.resize(static_cast<size_t>(end - begin) * line_width);
+
+  const int *node_ids = section.node_ids.data();
+  char *p = &out[0];
+  for (int i = begin; i < end; i++) {
+    int n = section.Offset(i + 1) - section.Offset(i);
+    if (n < 1 || n > num_nodes) {
+      throw std::invalid_argument(
+          "Element " + std::to_string(section.Eid(i)) + " has " +
+          std::to_string(n) + " nodes, expected at most " +
+          std::to_string(num_nodes));
+    }
+
+    FormatIntField(p, section.Eid(i), width);
+    FormatIntField(p + width, section.pid(i), width);
+    p += 2 * width;
+    const int *nodes = node_ids + section.Offset(i);
+    for (int j = 0; j < num_nodes; j++) {
+      FormatIntField(p, nodes[std::min(j, n - 1)], width);
+      p += width;
+    }
+    *p++ = '\n';
+  }
+}
+
+// Elements of ``section`` whose part is in ``parts``. The position in
+// ``node_index`` of each of their node IDs is written to ``node_positions``.
+template <typename T>
+static T SelectPartElements(const T &section, const IdIndex &parts,
+                            const IdIndex &node_index,
+                            std::vector<int64_t> &node_positions) {
+  const int *pid = section.pid.data();
+  std::vector<int> rows;
+  size_t n_node_ids = 0;
+  {
+    nb::gil_scoped_release release;
+    for (int i = 0; i < section.n_elem; i++) {
+      if (parts.Find(pid[i]) >= 0) {
+        rows.push_back(i);
+        n_node_ids += section.Offset(i + 1) - section.Offset(i);
+      }
+    }
+  }
+
+  int n_elem = static_cast<int>(rows.size());
+  NDArray<int, 1> eid_arr = MakeNDArray<int, 1>({n_elem});
+  NDArray<int, 1> pid_arr = MakeNDArray<int, 1>({n_elem});
+  NDArray<int, 1> node_ids_arr =
+      MakeNDArray<int, 1>({static_cast<int>(n_node_ids)});
+  NDArray<int, 1> offsets_arr = MakeNDArray<int, 1>({n_elem + 1});
+  int *new_node_ids = node_ids_arr.data();
+  int *new_offsets = offsets_arr.data();
+  node_positions.resize(n_node_ids);
+
+  const int *node_ids = section.node_ids.data();
+  int c = 0;
+  new_offsets[0] = 0;
+  {
+    nb::gil_scoped_release release;
+    for (int k = 0; k < n_elem; k++) {
+      int i = rows[k];
+      eid_arr(k) = section.Eid(i);
+      pid_arr(k) = pid[i];
+      for (int j = section.Offset(i); j < section.Offset(i + 1); j++, c++) {
+        int64_t position = node_index.Find(node_ids[j]);
+        if (position < 0) {
+          throw std::runtime_error("Element " +
+                                   std::to_string(section.Eid(i)) +
+                                   " references node " +
+                                   std::to_string(node_ids[j]) +
+                                   ", which isn't in the deck");
+        }
+        new_node_ids[c] = node_ids[j];
+        node_positions[c] = position;
+      }
+      new_offsets[k + 1] = c;
+    }
+  }
+
+  return T(eid_arr, pid_arr, node_ids_arr, offsets_arr);
+}
+
+// The bytes of a deck written by a decompressor running in Python, which
+// ``start`` starts the first time the deck waits for them, so decks opened
+// ahead of their parse, like those of DeckLoader, aren't all decompressed
+// at once. ``start`` is called with the GIL, from whichever thread waits,
+// and is dropped once called.
+class DecompressedRange : public StreamedRange {
+private:
+  nb::object start_decompressor;
+
+protected:
+  void Start() override {
+    nb::gil_scoped_acquire acquire;
+    nb::object start = std::move(start_decompressor);
+    try {
+      start();
+    } catch (nb::python_error &err) {
+      Close(err.what());
+    }
+  }
+
+public:
+  DecompressedRange(size_t size_hint, nb::object start)
+      : StreamedRange(size_hint), start_decompressor(std::move(start)) {}
+};
+
+// A file of the deck: the deck itself or a file it includes
+struct SourceFile {
+  std::string filename;
+  // The mapped or prefetched file, or the bytes of a deck read from a
+  // buffer
+  std::unique_ptr<ByteRange> data;
+  std::vector<Keyword> keywords;
+
+  // index within ``keywords`` of each resolved *INCLUDE and the index of the
+  // source it includes
+  std::vector<std::pair<size_t, size_t>> includes;
+
+  // Whether ``data`` holds bytes of its own, such as a buffer or a
+  // decompressed deck, rather than those of the file ``filename``
+  bool buffered = false;
+
+  explicit SourceFile(const std::string &fname)
+      : filename(fname), data(new MemoryMappedFile(fname.c_str())) {}
+
+  // The file ``fname`` read with ``backend``
+  SourceFile(const std::string &fname, IoBackend backend, size_t block_bytes)
+      : filename(fname) {
+    if (backend == IoBackend::Read) {
+      data.reset(new PrefetchedFile(fname.c_str(), block_bytes));
+    } else {
+      MemoryMappedFile *file = new MemoryMappedFile(
+          fname.c_str(), MapMode::Read, backend == IoBackend::MapPopulate);
+      data.reset(file);
+      file->AdviseSequential(true);
+    }
+  }
+
+  // A file held in memory, taking ownership of ``bytes``
+  SourceFile(const std::string &name, ByteRange *bytes)
+      : filename(name), data(bytes), buffered(true) {}
+
+  // Free the blocks of a file read with the pread backend, mapping the file
+  // in their place for anything that reads it again, which only reads the
+  // pages it needs. The emptied blocks are kept, as the deck may still refer
+  // to them as its stream. Keeps the blocks when the file can no longer be
+  // mapped at the size it was read.
+  void ReleaseBlocks() {
+    PrefetchedFile *file = dynamic_cast<PrefetchedFile *>(data.get());
+    if (!file) {
+      return;
+    }
+    std::unique_ptr<ByteRange> mapped;
+    try {
+      mapped.reset(new MemoryMappedFile(filename.c_str()));
+    } catch (const std::runtime_error &) {
+      return;
+    }
+    size_t n = file->end() - file->begin();
+    if (static_cast<size_t>(mapped->end() - mapped->begin()) != n) {
+      return;
+    }
+    mapped->current = mapped->begin() + (file->current - file->begin());
+    file->Release(0, n);
+    blocks = std::move(data);
+    data = std::move(mapped);
+  }
+
+private:
+  // The blocks replaced by ReleaseBlocks
+  std::unique_ptr<ByteRange> blocks;
+};
+
+class Deck {
+
+private:
+  bool debug;
+  std::string filename;
+  // The deck followed by every file it includes, each mapped once
+  std::vector<std::unique_ptr<SourceFile>> sources;
+  // The bytes of the deck, owned by its source, when they're decompressed
+  // or read on another thread while they're parsed
+  StreamedRange *stream = nullptr;
+  int num_threads;
+  // How the deck and the files it includes are read
+  IoBackend backend = IoBackend::Map;
+  size_t block_bytes = READ_BLOCK_BYTES;
+  // Created on first use, possibly by several threads reading at once, or
+  // shared with other decks by DeckLoader
+  std::shared_ptr<ThreadPool> pool;
+  std::mutex pool_mutex;
+  // Card format set by *KEYWORD
+  CardFormat card_format = CardFormat::Standard;
+  // Indices of the node and element IDs, built on request
+  IdIndex node_id_index;
+  IdIndex element_id_index;
+
+  // Element sections that are read, and the parts of the elements kept
+  // from them: those in ``part_filter`` or, with ``exclude_parts``, those
+  // not in it. Set with SetReadFilter.
+  bool read_shells = true;
+  bool read_solids = true;
+  bool read_tshells = true;
+  std::unique_ptr<IdIndex> part_filter;
+  bool exclude_parts = false;
+  // Store node coordinates in single precision
+  bool single_precision = false;
+  // Free the blocks read by the pread backend once they're parsed, for decks
+  // that don't read their files again, as they aren't lazy or cached
+  bool release_blocks = false;
+  // Memory of the arrays of parsed sections, shared with the arrays
+  std::shared_ptr<Arena> arena = std::make_shared<Arena>();
+  // Progress of Read in bytes of section cards, and whether it's cancelled.
+  // These are read and set from other threads while it runs.
+  std::atomic<uint64_t> bytes_parsed{0};
+  std::atomic<uint64_t> bytes_to_parse{0};
+  std::atomic<bool> cancelled{false};
+
+  // Cards of a node section, as byte offsets within their file, and the
+  // nodes they hold
+  struct NodeChunk {
+    CardFormat format;
+    size_t begin;
+    size_t end;
+    size_t row;    // first node of the chunk across the sections
+    size_t n_rows; // number of nodes in the chunk
+  };
+
+  // Location of the coordinate fields of every node section, built on first
+  // use by WriteNodeVariants
+  struct NodeFields {
+    size_t source = 0;             // index of the file of the sections
+    std::vector<NodeChunk> chunks; // cards of the sections, in file order
+    std::vector<size_t> offsets;   // offset of each node's X field
+  };
+  std::unique_ptr<NodeFields> node_fields;
+  // locked without the GIL, so it's a std::mutex rather than nb::ft_mutex
+  std::mutex node_fields_mutex;
+
+  // Thread pool, created on first use
+  ThreadPool &Pool() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    if (!pool) {
+      pool.reset(new ThreadPool(ResolveNumThreads(num_threads)));
+    }
+    return *pool;
+  }
+
+  // Locate the end of the section beginning at ``begin`` and split its cards
+  // into chunks of whole lines, counting the rows in each chunk. Returns the
+  // chunk boundaries. ``row_start`` is filled with the first row of each
+  // chunk followed by the total number of rows.
+  //
+  // Sections are split into a chunk per SERIAL_CHUNK_BYTES unless
+  // ``parallel`` is set, and then only when they're large enough to be worth
+  // splitting across the pool.
+  std::vector<const char *> ChunkSection(const char *begin,
+                                         const char *file_end, bool parallel,
+                                         std::vector<size_t> &row_start) {
+    if (!parallel) {
+      // find the end and count the rows in a single pass
+      std::vector<const char *> bounds = {begin};
+      row_start = {0};
+      size_t n_rows = 0;
+      const char *p = begin;
+      while (p < file_end && *p != '*') {
+        if (p - bounds.back() >= SERIAL_CHUNK_BYTES) {
+          bounds.push_back(p);
+          row_start.push_back(n_rows);
+        }
+        if (*p != '$') {
+          n_rows++;
+        }
+        p = NextLine(p, file_end);
+      }
+      bounds.push_back(p);
+      row_start.push_back(n_rows);
+      return bounds;
+    }
+
+    const char *end = FindSectionEnd(begin, file_end);
+    if (end - begin < PARALLEL_MIN_BYTES) {
+      row_start = {0, CountCardLines(begin, end)};
+      return {begin, end};
+    }
+
+    ThreadPool &tpool = Pool();
+    std::vector<const char *> bounds =
+        SplitLines(begin, end, tpool.Size() * CHUNKS_PER_THREAD);
+    size_t n_chunks = bounds.size() - 1;
+
+    row_start.assign(n_chunks + 1, 0);
+    ParallelFor(tpool, n_chunks, [&](size_t i) {
+      row_start[i + 1] = CountCardLines(bounds[i], bounds[i + 1]);
+    });
+    for (size_t i = 0; i < n_chunks; i++) {
+      row_start[i + 1] += row_start[i];
+    }
+
+    return bounds;
+  }
+
+  // Call parse_chunk(i) for each chunk, on the pool when ``parallel`` is
+  // set. Cancellation is checked before each chunk, and its bytes count
+  // towards the progress of the read once it's parsed.
+  template <typename F>
+  void ParseChunks(const std::vector<const char *> &bounds, bool parallel,
+                   F parse_chunk) {
+    size_t n_chunks = bounds.size() - 1;
+    auto parse = [&](size_t i) {
+      CheckCancelled();
+      parse_chunk(i);
+      bytes_parsed += bounds[i + 1] - bounds[i];
+    };
+    if (parallel && n_chunks > 1) {
+      ParallelFor(Pool(), n_chunks, parse);
+    } else {
+      for (size_t i = 0; i < n_chunks; i++) {
+        parse(i);
+      }
+    }
+  }
+
+  // Type of the sections of keyword ``name`` if the read filter keeps them,
+  // and otherwise SectionType::None
+  SectionType ReadSectionType(const std::string &name) const {
+    SectionType type = KeywordSectionType(name);
+    if (type == SectionType::ElementSolid &&
+        !(name.compare(0, 15, "*ELEMENT_TSHELL") == 0 ? read_tshells
+                                                       : read_solids)) {
+      return SectionType::None;
+    }
+    if (type == SectionType::ElementShell && !read_shells) {
+      return SectionType::None;
+    }
+    return type;
+  }
+
+  void CheckCancelled() const {
+    if (cancelled) {
+      throw std::runtime_error("Reading the deck was cancelled");
+    }
+  }
+
+  // First card of ``keyword``
+  const char *KeywordCards(const Keyword &keyword) const {
+    const ByteRange &bytes = *sources[keyword.source]->data;
+    return NextLine(bytes.begin() + keyword.offset, bytes.end());
+  }
+
+  const Keyword &GetKeyword(size_t index) const {
+    if (index >= keywords.size()) {
+      throw std::out_of_range("Keyword index out of range");
+    }
+    return keywords[index];
+  }
+
+  // Wrap the arrays of a section whose cards begin at ``begin`` in ``source``
+  NodeSection MakeNodeSection(const NodeArrays &arrays,
+                              const SourceFile &source, const char *begin) {
+    NodeSection section(arrays, arena, begin - source.data->begin());
+    section.filename = source.filename;
+    return section;
+  }
+
+  template <typename T>
+  T MakeElementSection(const ElementArrays &arrays, const SourceFile &source,
+                       const char *begin) {
+    T section(arrays, arena);
+    section.fpos = begin - source.data->begin();
+    section.filename = source.filename;
+    return section;
+  }
+
+  // Record the keywords of a single file. Large files are scanned in
+  // parallel when ``parallel`` is set.
+  void IndexSource(SourceFile &source, bool parallel) {
+    source.data->WaitComplete();
+    const char *begin = source.data->begin();
+    const char *end = source.data->end();
+    std::vector<Keyword> &file_keywords = source.keywords;
+
+    file_keywords.clear();
+    source.includes.clear();
+    if (!parallel || end - begin < PARALLEL_MIN_BYTES) {
+      ScanKeywords(begin, end, begin, file_keywords);
+    } else {
+      ThreadPool &tpool = Pool();
+      std::vector<const char *> bounds =
+          SplitLines(begin, end, tpool.Size() * CHUNKS_PER_THREAD);
+      size_t n_chunks = bounds.size() - 1;
+
+      std::vector<std::vector<Keyword>> chunk_keywords(n_chunks);
+      std::vector<size_t> chunk_lines(n_chunks);
+      ParallelFor(tpool, n_chunks, [&](size_t i) {
+        chunk_lines[i] =
+            ScanKeywords(bounds[i], bounds[i + 1], begin, chunk_keywords[i]);
+      });
+
+      // shift each chunk's line numbers by the lines before it
+      size_t line_offset = 0;
+      for (size_t i = 0; i < n_chunks; i++) {
+        for (Keyword &keyword : chunk_keywords[i]) {
+          keyword.line += line_offset;
+          file_keywords.push_back(std::move(keyword));
+        }
+        line_offset += chunk_lines[i];
+      }
+    }
+
+    CompleteKeywords(file_keywords, end - begin);
+  }
+
+  // Map and index the files included by the deck, one level of includes at
+  // a time. The files of each level are mapped and indexed concurrently.
+  //
+  // Files are identified by their canonical path, so each is read once no
+  // matter how many files include it, and include cycles end.
+  void ResolveIncludes() {
+    std::string deck_dir = DirName(filename);
+    std::vector<std::string> include_paths;
+    std::unordered_map<std::string, size_t> source_index = {
+        {CanonicalPath(filename), 0}};
+
+    size_t level_begin = 0;
+    while (level_begin < sources.size()) {
+      size_t level_end = sources.size();
+
+      // an *INCLUDE_PATH applies to every include, so gather them first
+      for (size_t i = level_begin; i < level_end; i++) {
+        const SourceFile &source = *sources[i];
+        for (const Keyword &keyword : source.keywords) {
+          bool relative = keyword.name == "*INCLUDE_PATH_RELATIVE";
+          if (!relative && keyword.name != "*INCLUDE_PATH") {
+            continue;
+          }
+          const char *begin = NextLine(
+              source.data->begin() + keyword.offset, source.data->end());
+          for (const std::string &dir :
+               ReadCards(begin, source.data->end())) {
+            include_paths.push_back(relative ? JoinPath(deck_dir, dir) : dir);
+          }
+        }
+      }
+
+      std::vector<std::string> new_files;
+      for (size_t i = level_begin; i < level_end; i++) {
+        SourceFile &source = *sources[i];
+        std::string source_dir = DirName(source.filename);
+        for (size_t k = 0; k < source.keywords.size(); k++) {
+          const Keyword &keyword = source.keywords[k];
+          if (keyword.name != "*INCLUDE") {
+            continue;
+          }
+
+          const char *begin = NextLine(source.data->begin() + keyword.offset,
+                                       source.data->end());
+          std::string name =
+              IncludeFilename(ReadCards(begin, source.data->end()));
+          std::string path =
+              FindInclude(name, source_dir, deck_dir, include_paths);
+          if (path.empty()) {
+            if (std::find(missing_includes.begin(), missing_includes.end(),
+                          name) == missing_includes.end()) {
+              missing_includes.push_back(name);
+            }
+            continue;
+          }
+
+          auto found = source_index.find(path);
+          if (found == source_index.end()) {
+            found = source_index.emplace(path, level_end + new_files.size())
+                        .first;
+            new_files.push_back(path);
+          }
+          source.includes.push_back({k, found->second});
+        }
+      }
+
+      sources.resize(level_end + new_files.size());
+      auto open_file = [&](size_t j) {
+        std::unique_ptr<SourceFile> source;
+        try {
+          source.reset(new SourceFile(new_files[j], backend, block_bytes));
+        } catch (const std::runtime_error &err) {
+          throw std::runtime_error(std::string(err.what()) + " " +
+                                   new_files[j]);
+        }
+        IndexSource(*source, false);
+        sources[level_end + j] = std::move(source);
+      };
+      if (num_threads == 1 || new_files.size() < 2) {
+        for (size_t j = 0; j < new_files.size(); j++) {
+          open_file(j);
+        }
+      } else {
+        ParallelFor(Pool(), new_files.size(), open_file);
+      }
+
+      level_begin = level_end;
+    }
+  }
+
+  // Append the keywords of source ``index``, each included file's keywords
+  // following the first *INCLUDE of it as if the file were pasted there
+  void MergeKeywords(size_t index, std::vector<bool> &merged) {
+    merged[index] = true;
+    const SourceFile &source = *sources[index];
+
+    size_t next_include = 0;
+    for (size_t k = 0; k < source.keywords.size(); k++) {
+      Keyword keyword = source.keywords[k];
+      keyword.source = index;
+      keyword.filename = source.filename;
+      keywords.push_back(std::move(keyword));
+
+      if (next_include < source.includes.size() &&
+          source.includes[next_include].first == k) {
+        size_t included = source.includes[next_include++].second;
+        if (!merged[included]) {
+          MergeKeywords(included, merged);
+        }
+      }
+    }
+  }
+
+  // Copy ``n`` parsed values into the arena
+  int *ArenaCopy(const int *values, int n) {
+    int *copy = arena->Allocate<int>(n);
+    memcpy(copy, values, n * sizeof(int));
+    return copy;
+  }
+
+  // Copy ``n`` parsed IDs into the arena, or return null and set ``first``
+  // when they're numbered consecutively from it
+  int *ArenaIds(const int *ids, int n, int &first) {
+    int64_t start = ConsecutiveIdsStart(ids, n);
+    if (start < 0) {
+      return ArenaCopy(ids, n);
+    }
+    first = static_cast<int>(start);
+    return nullptr;
+  }
+
+  // Parse the node cards beginning at ``begin``, whose fixed width fields
+  // follow ``Layout``. ``section_end`` is set to the end of the cards. Only
+  // uses the pool when ``parallel`` is set, so it may be called from a pool
+  // task otherwise.
+  //
+  // A card containing a comma is free format. This is checked once per card
+  // so the fixed width parsers stay free of per field checks.
+  template <typename Layout>
+  NodeArrays ParseNodeCards(const char *begin, const char *file_end,
+                            bool parallel, const char **section_end) {
+#ifdef DEBUG
+    std::cout << "Reading node section" << std::endl;
+#endif
+
+    // The number of nodes isn't stored in the deck, so count the cards first
+    // and allocate each array once at its final size.
+    std::vector<size_t> row_start;
+    std::vector<const char *> bounds =
+        ChunkSection(begin, file_end, parallel, row_start);
+    const char *end = bounds.back();
+
+    // coordinates go straight to the arena; IDs and constraints go there
+    // once they're known not to follow a pattern
+    NodeArrays arrays;
+    int n_nodes = arrays.n_nodes = row_start.back();
+    std::unique_ptr<int[]> nid(AllocateArray<int>(n_nodes));
+    std::unique_ptr<int[]> tc(AllocateArray<int>(n_nodes));
+    std::unique_ptr<int[]> rc(AllocateArray<int>(n_nodes));
+    double *coord = nullptr;
+    float *coord32 = nullptr;
+    if (single_precision) {
+      coord32 = arrays.coord32 = arena->Allocate<float>(n_nodes * 3);
+    } else {
+      coord = arrays.coord = arena->Allocate<double>(n_nodes * 3);
+    }
+
+    ParseChunks(bounds, parallel, [&](size_t i) {
+      size_t row = row_start[i];
+      double xyz32[3];
+      for (const char *p = bounds[i], *next; p < bounds[i + 1]; p = next) {
+        next = NextLine(p, end);
+        // skip comments
+        if (*p == '$') {
+          continue;
+        }
+        double *xyz = coord32 ? xyz32 : &coord[row * 3];
+        if (memchr(p, ',', next - p)) {
+          ParseNodeFreeLine(p, next, &nid[row], xyz, &tc[row], &rc[row]);
+        } else {
+          ParseNodeLine<Layout>(p, next, &nid[row], xyz, &tc[row], &rc[row]);
+        }
+        if (coord32) {
+          for (int j = 0; j < 3; j++) {
+            coord32[row * 3 + j] = static_cast<float>(xyz32[j]);
+          }
+        }
+        row++;
+      }
+    });
+
+    arrays.nid = ArenaIds(nid.get(), n_nodes, arrays.first_nid);
+    if (!AllZero(tc.get(), n_nodes) || !AllZero(rc.get(), n_nodes)) {
+      arrays.tc = ArenaCopy(tc.get(), n_nodes);
+      arrays.rc = ArenaCopy(rc.get(), n_nodes);
+    }
+
+    *section_end = end;
+    return arrays;
+  }
+
+  // Parse the element cards beginning at ``begin``, like ParseNodeCards
+  template <typename Layout>
+  ElementArrays ParseElementCards(const char *begin, const char *file_end,
+                                  int num_nodes, bool parallel,
+                                  const char **section_end) {
+#ifdef DEBUG
+    std::cout << "Reading element section" << std::endl;
+#endif
+
+    std::vector<size_t> row_start;
+    std::vector<const char *> bounds =
+        ChunkSection(begin, file_end, parallel, row_start);
+    const char *end = bounds.back();
+
+    ElementArrays arrays;
+    int n_elem = arrays.n_elem = row_start.back();
+    std::unique_ptr<int[]> eid(AllocateArray<int>(n_elem));
+    int *pid = arrays.pid = arena->Allocate<int>(n_elem);
+    int *node_ids = arrays.node_ids = arena->Allocate<int>(n_elem * num_nodes);
+    arrays.stride = num_nodes;
+
+    ParseChunks(bounds, parallel, [&](size_t i) {
+      size_t row = row_start[i];
+      for (const char *p = bounds[i], *next; p < bounds[i + 1]; p = next) {
+        next = NextLine(p, end);
+        if (*p == '$') {
+          continue;
+        }
+        if (memchr(p, ',', next - p)) {
+          ParseElementFreeLine(p, next, num_nodes, &eid[row], &pid[row],
+                               &node_ids[row * num_nodes]);
+        } else {
+          ParseElementLine<Layout>(p, end, num_nodes, &eid[row], &pid[row],
+                                   &node_ids[row * num_nodes]);
+        }
+        row++;
+      }
+    });
+    arrays.eid = ArenaIds(eid.get(), n_elem, arrays.first_eid);
+
+    *section_end = end;
+    return arrays;
+  }
+
+  bool KeepPart(int pid) const {
+    return (part_filter->Find(pid) >= 0) != exclude_parts;
+  }
+
+  // Parse the element cards beginning at ``begin`` whose part passes the
+  // part filter, like ParseElementCards. Only the part ID of each card is
+  // decoded until it's known to be kept, and each chunk collects its kept
+  // elements before they're copied into place, so memory follows the
+  // number of kept elements rather than the size of the section.
+  template <typename Layout>
+  ElementArrays ParseFilteredElementCards(const char *begin,
+                                          const char *file_end,
+                                          int num_nodes, bool parallel,
+                                          const char **section_end) {
+    std::vector<size_t> row_start;
+    std::vector<const char *> bounds =
+        ChunkSection(begin, file_end, parallel, row_start);
+    const char *end = bounds.back();
+    size_t n_chunks = bounds.size() - 1;
+
+    // EID, PID, and node IDs of each kept element of each chunk
+    int card_width = 2 + num_nodes;
+    std::vector<std::vector<int>> chunk_cards(n_chunks);
+    ParseChunks(bounds, parallel, [&](size_t i) {
+      std::vector<int> &cards = chunk_cards[i];
+      for (const char *p = bounds[i], *next; p < bounds[i + 1]; p = next) {
+        next = NextLine(p, end);
+        if (*p == '$') {
+          continue;
+        }
+        bool free_format = memchr(p, ',', next - p) != nullptr;
+        int card_pid = free_format ? ParseElementFreePid(p, next)
+                                   : ParseElementPid<Layout>(p, end);
+        if (!KeepPart(card_pid)) {
+          continue;
+        }
+
+        cards.resize(cards.size() + card_width);
+        int *card = &cards[cards.size() - card_width];
+        if (free_format) {
+          ParseElementFreeLine(p, next, num_nodes, &card[0], &card[1],
+                               &card[2]);
+        } else {
+          ParseElementLine<Layout>(p, end, num_nodes, &card[0], &card[1],
+                                   &card[2]);
+        }
+      }
+    });
+
+    ElementArrays arrays;
+    int n_elem = 0;
+    for (const std::vector<int> &cards : chunk_cards) {
+      n_elem += static_cast<int>(cards.size() / card_width);
+    }
+    arrays.n_elem = n_elem;
+    std::unique_ptr<int[]> eid(AllocateArray<int>(n_elem));
+    int *pid = arrays.pid = arena->Allocate<int>(n_elem);
+    int *node_ids = arrays.node_ids = arena->Allocate<int>(n_elem * num_nodes);
+    arrays.stride = num_nodes;
+
+    int row = 0;
+    for (const std::vector<int> &cards : chunk_cards) {
+      for (size_t c = 0; c < cards.size(); c += card_width, row++) {
+        eid[row] = cards[c];
+        pid[row] = cards[c + 1];
+        memcpy(&node_ids[row * num_nodes], &cards[c + 2],
+               num_nodes * sizeof(int));
+      }
+    }
+    arrays.eid = ArenaIds(eid.get(), n_elem, arrays.first_eid);
+
+    *section_end = end;
+    return arrays;
+  }
+
+  // Parse a section with the parser specialized for its card format
+  NodeArrays ParseNodeSection(CardFormat format, const char *begin,
+                              const char *file_end, bool parallel,
+                              const char **section_end) {
+    switch (format) {
+    case CardFormat::I10:
+      return ParseNodeCards<I10Cards>(begin, file_end, parallel, section_end);
+    case CardFormat::Long:
+      return ParseNodeCards<LongCards>(begin, file_end, parallel, section_end);
+    default:
+      return ParseNodeCards<StandardCards>(begin, file_end, parallel,
+                                           section_end);
+    }
+  }
+
+  ElementArrays ParseElementSection(CardFormat format, const char *begin,
+                                    const char *file_end, int num_nodes,
+                                    bool parallel, const char **section_end) {
+    if (part_filter) {
+      switch (format) {
+      case CardFormat::I10:
+        return ParseFilteredElementCards<I10Cards>(begin, file_end, num_nodes,
+                                                   parallel, section_end);
+      case CardFormat::Long:
+        return ParseFilteredElementCards<LongCards>(
+            begin, file_end, num_nodes, parallel, section_end);
+      default:
+        return ParseFilteredElementCards<StandardCards>(
+            begin, file_end, num_nodes, parallel, section_end);
+      }
+    }
+
+    switch (format) {
+    case CardFormat::I10:
+      return ParseElementCards<I10Cards>(begin, file_end, num_nodes, parallel,
+                                         section_end);
+    case CardFormat::Long:
+      return ParseElementCards<LongCards>(begin, file_end, num_nodes,
+                                          parallel, section_end);
+    default:
+      return ParseElementCards<StandardCards>(begin, file_end, num_nodes,
+                                              parallel, section_end);
+    }
+  }
+
+  // Card format of the section of ``keyword``
+  CardFormat KeywordFormat(const Keyword &keyword) const {
+    const ByteRange &bytes = *sources[keyword.source]->data;
+    return KeywordCardFormat(bytes.begin() + keyword.offset, bytes.end(),
+                             card_format);
+  }
+
+  // Card format of the section at the current position of the deck, from
+  // the keyword line last read with ReadLine
+  CardFormat CurrentFormat() const {
+    const std::string &line = sources[0]->data->line;
+    return KeywordCardFormat(line.data(), line.data() + line.size(),
+                             card_format);
+  }
+
+  // Set the deck's default card format from its *KEYWORD line
+  void DetectCardFormat() {
+    card_format = CardFormat::Standard;
+    for (const Keyword &keyword : keywords) {
+      if (keyword.source == 0 && keyword.name == "*KEYWORD") {
+        const ByteRange &bytes = *sources[0]->data;
+        card_format =
+            DeckCardFormat(bytes.begin() + keyword.offset, bytes.end());
+        break;
+      }
+    }
+  }
+
+  // Wait for every byte of the deck's own file, which the reads from its
+  // current position expect, as a streamed deck is empty until its stream
+  // is closed
+  void WaitForDeck() {
+    nb::gil_scoped_release release;
+    sources[0]->data->WaitComplete();
+  }
+
+  // Read the element section at the current position of the deck
+  template <typename T>
+  void ReadElementSection(int num_nodes, std::vector<T> &sections) {
+    WaitForDeck();
+    SourceFile &deck = *sources[0];
+    const char *begin = deck.data->current;
+    const char *end;
+    ElementArrays arrays;
+    {
+      nb::gil_scoped_release release;
+      arrays = ParseElementSection(CurrentFormat(), begin, deck.data->end(),
+                                   num_nodes, num_threads != 1, &end);
+    }
+    deck.data->current = const_cast<char *>(end);
+    sections.push_back(MakeElementSection<T>(arrays, deck, begin));
+  }
+
+  template <typename T> T LoadElementSection(size_t index, int num_nodes) {
+    const Keyword &keyword = GetKeyword(index);
+    const SourceFile &source = *sources[keyword.source];
+    const char *begin = KeywordCards(keyword);
+    const char *end;
+    ElementArrays arrays;
+    {
+      nb::gil_scoped_release release;
+      arena->Reserve(keyword.length);
+      arrays = ParseElementSection(KeywordFormat(keyword), begin,
+                                   source.data->end(), num_nodes,
+                                   num_threads != 1, &end);
+    }
+    return MakeElementSection<T>(arrays, source, begin);
+  }
+
+  // Hash of the contents of a file. Large files are hashed in parallel.
+  uint64_t ContentHash(const ByteRange &bytes) {
+    const char *begin = bytes.begin();
+    size_t size = bytes.end() - begin;
+    size_t n_blocks = (size + CACHE_HASH_BLOCK - 1) / CACHE_HASH_BLOCK;
+
+    std::vector<uint64_t> block_hashes(n_blocks);
+    auto hash_block = [&](size_t i) {
+      size_t offset = i * CACHE_HASH_BLOCK;
+      size_t length = std::min<size_t>(CACHE_HASH_BLOCK, size - offset);
+      block_hashes[i] = HashBytes(begin + offset, length, i);
+    };
+
+    if (num_threads == 1 || n_blocks < 2) {
+      for (size_t i = 0; i < n_blocks; i++) {
+        hash_block(i);
+      }
+    } else {
+      ParallelFor(Pool(), n_blocks, hash_block);
+    }
+
+    return HashBytes(reinterpret_cast<const char *>(block_hashes.data()),
+                     n_blocks * sizeof(uint64_t), size);
+  }
+
+  // Node ID array of each node section, for IdIndex
+  static std::vector<IdBlock>
+  NodeIdBlocks(const std::vector<NodeSection> &node_secs) {
+    std::vector<IdBlock> blocks;
+    for (const NodeSection &section : node_secs) {
+      if (section.implicit_nid) {
+        blocks.push_back({nullptr, size_t(section.n_nodes), section.first_nid});
+      } else {
+        blocks.push_back({section.nid.data(), size_t(section.n_nodes)});
+      }
+    }
+    return blocks;
+  }
+
+  // Element ID array of each section, for IdIndex
+  static IdBlock ElementIdBlock(const ElementSection &section) {
+    if (section.implicit_eid) {
+      return {nullptr, size_t(section.n_elem), section.first_eid};
+    }
+    return {section.eid.data(), size_t(section.n_elem)};
+  }
+
+  // Look up ``n`` IDs in ``index``, in parallel for many IDs
+  void FindIds(const IdIndex &index, const int *ids, size_t n, int64_t *out) {
+    size_t n_blocks = (n + IDS_PER_BLOCK - 1) / IDS_PER_BLOCK;
+    ForEachBlock(n_blocks, [&](size_t i) {
+      size_t begin = i * IDS_PER_BLOCK;
+      size_t count = std::min(n - begin, static_cast<size_t>(IDS_PER_BLOCK));
+      index.FindMany(ids + begin, count, out + begin);
+    });
+  }
+
+  // Call fn(i) for each block, in parallel when there's more than one
+  template <typename F> void ForEachBlock(size_t n_blocks, F fn) {
+    if (num_threads != 1 && n_blocks > 1) {
+      ParallelFor(Pool(), n_blocks, fn);
+    } else {
+      for (size_t i = 0; i < n_blocks; i++) {
+        fn(i);
+      }
+    }
+  }
+
+  // Split the cards of the node sections ``sections``, given as indices into
+  // the node sections, into chunks of whole cards, each handled by a single
+  // task. The sections must all be in one file, whose index is stored in
+  // ``source``. ``n_rows`` is set to the number of nodes in the sections.
+  std::vector<NodeChunk> ChunkNodeSections(const std::vector<size_t> &sections,
+                                           size_t &source, size_t &n_rows) {
+    if (sections.empty()) {
+      throw std::invalid_argument("No node sections to overwrite");
+    }
+    for (size_t index : sections) {
+      if (index >= node_keywords.size()) {
+        throw std::out_of_range("Node section index out of range");
+      }
+    }
+
+    source = keywords[node_keywords[sections[0]]].source;
+    const char *file_begin = sources[source]->data->begin();
+    const char *file_end = sources[source]->data->end();
+    std::vector<NodeChunk> chunks;
+    n_rows = 0;
+    for (size_t index : sections) {
+      const Keyword &keyword = keywords[node_keywords[index]];
+      if (keyword.source != source) {
+        throw std::invalid_argument(
+            "Node sections to overwrite must be in the same file");
+      }
+
+      CardFormat format = KeywordFormat(keyword);
+      std::vector<size_t> row_start;
+      std::vector<const char *> bounds = ChunkSection(
+          KeywordCards(keyword), file_end, num_threads != 1, row_start);
+      for (size_t i = 0; i + 1 < bounds.size(); i++) {
+        chunks.push_back({format, size_t(bounds[i] - file_begin),
+                          size_t(bounds[i + 1] - file_begin),
+                          n_rows + row_start[i],
+                          row_start[i + 1] - row_start[i]});
+      }
+      n_rows += row_start.back();
+    }
+    return chunks;
+  }
+
+  // Locate the coordinate fields of every node section for
+  // WriteNodeVariants
+  void LocateNodeFields() {
+    std::vector<size_t> sections(node_keywords.size());
+    for (size_t i = 0; i < sections.size(); i++) {
+      sections[i] = i;
+    }
+
+    std::unique_ptr<NodeFields> fields(new NodeFields);
+    size_t n_rows;
+    fields->chunks = ChunkNodeSections(sections, fields->source, n_rows);
+    fields->offsets.resize(n_rows);
+
+    const char *file_begin = sources[fields->source]->data->begin();
+    ForEachBlock(fields->chunks.size(), [&](size_t i) {
+      const NodeChunk &chunk = fields->chunks[i];
+      size_t *offsets = fields->offsets.data() + chunk.row;
+      ForEachNodeCard(chunk.format, file_begin + chunk.begin,
+                      file_begin + chunk.end, chunk.n_rows,
+                      [&](size_t row, size_t field) {
+                        offsets[row] = chunk.begin + field;
+                      });
+    });
+    node_fields = std::move(fields);
+  }
+
+  // Split a section into blocks of cells, numbering its cells from
+  // ``n_cells``
+  static void AddCellBlocks(const ElementSection &section, bool solid,
+                            size_t &n_cells, std::vector<CellBlock> &blocks) {
+    for (int begin = 0; begin < section.n_elem; begin += CELLS_PER_BLOCK) {
+      CellBlock block;
+      block.section = &section;
+      block.node_ids = section.node_ids.data();
+      block.pid = section.pid.data();
+      block.solid = solid;
+      block.begin = begin;
+      block.end = std::min(section.n_elem, begin + CELLS_PER_BLOCK);
+      block.cell = n_cells;
+      n_cells += block.end - begin;
+      blocks.push_back(block);
+    }
+  }
+
+  // Build the arrays of ToVTK with connectivity and offsets of type ``T``.
+  // Cell types are found first, which sizes the connectivity exactly, and
+  // then every cell is written straight to its place in the merged arrays.
+  template <typename T>
+  nb::tuple AssembleVTK(const std::vector<NodeSection> &node_secs,
+                        const std::vector<ElementShellSection> &shell_secs,
+                        const std::vector<ElementSolidSection> &solid_secs) {
+    if (node_secs.empty()) {
+      throw std::runtime_error(
+          "Missing node sections. Unable to generate UnstructuredGrid.");
+    }
+
+    // points, reusing the arrays of a lone node section
+    int n_points = 0;
+    for (const NodeSection &section : node_secs) {
+      n_points += section.n_nodes;
+    }
+
+    // arrays are created with the GIL and filled without it
+    const NodeSection &first = node_secs[0];
+    bool reuse = node_secs.size() == 1;
+    bool copy_points = !reuse || first.single_precision;
+    bool copy_nid = !reuse || first.implicit_nid;
+    NDArray<double, 2> points_arr =
+        copy_points ? MakeNDArray<double, 2>({n_points, 3}) : first.coord;
+    NDArray<int, 1> nid_arr =
+        copy_nid ? MakeNDArray<int, 1>({n_points}) : first.nid;
+
+    size_t n_cells = 0;
+    std::vector<CellBlock> blocks;
+    for (const ElementShellSection &section : shell_secs) {
+      AddCellBlocks(section, false, n_cells, blocks);
+    }
+    for (const ElementSolidSection &section : solid_secs) {
+      AddCellBlocks(section, true, n_cells, blocks);
+    }
+
+    int n_cells_int = static_cast<int>(n_cells);
+    NDArray<uint8_t, 1> celltypes_arr =
+        MakeNDArray<uint8_t, 1>({n_cells_int});
+    NDArray<T, 1> offsets_arr = MakeNDArray<T, 1>({n_cells_int + 1});
+    NDArray<int, 1> pid_arr = MakeNDArray<int, 1>({n_cells_int});
+    uint8_t *celltypes = celltypes_arr.data();
+    T *offsets = offsets_arr.data();
+    int *pids = pid_arr.data();
+
+    // point index of each node ID, where a later duplicate wins
+    IdIndex node_index;
+    {
+      nb::gil_scoped_release release;
+      int start = 0;
+      for (const NodeSection &section : node_secs) {
+        if (copy_points) {
+          section.CopyCoordinates(points_arr.data() + start * 3);
+        }
+        if (copy_nid) {
+          section.CopyNid(nid_arr.data() + start);
+        }
+        start += section.n_nodes;
+      }
+      node_index = IdIndex(NodeIdBlocks(node_secs));
+
+      ForEachBlock(blocks.size(), [&](size_t i) {
+        CellBlock &block = blocks[i];
+        size_t cell = block.cell;
+        size_t n_conn = 0;
+        for (int e = block.begin; e < block.end; e++, cell++) {
+          const int *nodes = block.node_ids + block.section->Offset(e);
+          celltypes[cell] =
+              block.solid ? SolidCellType(nodes) : ShellCellType(nodes);
+          n_conn += CellWidth(celltypes[cell]);
+        }
+        block.n_conn = n_conn;
+      });
+    }
+
+    size_t n_conn = 0;
+    for (CellBlock &block : blocks) {
+      block.conn = n_conn;
+      n_conn += block.n_conn;
+    }
+    NDArray<T, 1> cells_arr = MakeNDArray<T, 1>({static_cast<int>(n_conn)});
+    T *cells = cells_arr.data();
+
+    auto map_id = [&](int id) {
+      int64_t index = node_index.Find(id);
+      if (index < 0) {
+        throw std::runtime_error("Element references node ID " +
+                                 std::to_string(id) +
+                                 ", which is missing from the node sections");
+      }
+      return static_cast<T>(index);
+    };
+
+    offsets[0] = 0;
+    {
+      nb::gil_scoped_release release;
+      ForEachBlock(blocks.size(), [&](size_t i) {
+        const CellBlock &block = blocks[i];
+        size_t cell = block.cell;
+        T c = static_cast<T>(block.conn);
+        for (int e = block.begin; e < block.end; e++, cell++) {
+          const int *nodes = block.node_ids + block.section->Offset(e);
+          if (block.solid) {
+            c += WriteSolidCell(nodes, celltypes[cell], cells + c, map_id);
+          } else {
+            c += WriteShellCell(nodes, celltypes[cell], cells + c, map_id);
+          }
+          offsets[cell + 1] = c;
+          pids[cell] = block.pid[e];
+        }
+      });
+    }
+
+    return nb::make_tuple(points_arr, nid_arr, cells_arr, offsets_arr,
+                          celltypes_arr, pid_arr);
+  }
+
+public:
+  std::vector<Keyword> keywords;
+  std::vector<size_t> node_keywords;
+  std::vector<size_t> element_solid_keywords;
+  std::vector<size_t> element_shell_keywords;
+  std::vector<NodeSection> node_sections;
+  std::vector<ElementSolidSection> element_solid_sections;
+  std::vector<ElementShellSection> element_shell_sections;
+
+  // Filenames of *INCLUDE keywords that couldn't be found
+  std::vector<std::string> missing_includes;
+
+  // The deck ``fname``, read with the I/O backend ``io_backend``, and in
+  // blocks of ``block_size`` bytes by the pread backend
+  Deck(const std::string &fname, int n_threads = 1,
+       const std::string &io_backend = "mmap",
+       size_t block_size = READ_BLOCK_BYTES)
+      : filename(fname), num_threads(n_threads),
+        backend(ParseIoBackend(io_backend)), block_bytes(block_size) {
+    sources.emplace_back(new SourceFile(fname, backend, block_bytes));
+    if (backend == IoBackend::Read) {
+      stream = static_cast<StreamedRange *>(sources[0]->data.get());
+    }
 
     // Likely bogus leak warnings. See:
     // https://nanobind.readthedocs.io/en/latest/faq.html#why-am-i-getting-errors-about-leaked-functions-and-types
     nb::set_leak_warnings(false);
   }
 
-  ~Deck() { memmap.close_file(); }
+  // A deck read from the bytes of ``buffer`` without copying them. ``name``
+  // stands in for the filename, and files the deck includes are found
+  // relative to its directory.
+  Deck(const NDArray<const uint8_t, 1> &buffer, const std::string &name,
+       int n_threads = 1)
+      : filename(name), num_threads(n_threads) {
+    sources.emplace_back(new SourceFile(name, new BufferRange(buffer)));
+    nb::set_leak_warnings(false);
+  }
+
+  // A deck whose bytes are written to it with WriteStream, such as by a
+  // thread decompressing the file ``name``, and parsed by Read as they
+  // arrive
+  Deck(const std::string &name, int n_threads, StreamedRange *bytes)
+      : filename(name), stream(bytes), num_threads(n_threads) {
+    sources.emplace_back(new SourceFile(name, bytes));
+    nb::set_leak_warnings(false);
+  }
+
+  // Append ``block`` to the bytes of a streamed deck. Returns false once its
+  // read has stopped and no longer needs them.
+  bool WriteStream(const NDArray<const uint8_t, 1> block) {
+    CheckStream();
+    nb::gil_scoped_release release;
+    return stream->Write(reinterpret_cast<const char *>(block.data()),
+                         block.shape(0));
+  }
+
+  // End the bytes of a streamed deck, with the error that ended them early
+  void CloseStream(const std::string &error) {
+    CheckStream();
+    stream->Close(error);
+  }
+
+  // Stop writing a streamed deck that won't be read
+  void AbortStream() {
+    CheckStream();
+    stream->Abort();
+  }
+
+  void CheckStream() const {
+    if (!stream || !sources[0]->buffered) {
+      throw std::runtime_error("The deck isn't streamed");
+    }
+  }
+
+  int GetNumThreads() const { return num_threads; }
+
+  // Changing the number of threads drops the existing pool
+  void SetNumThreads(int n_threads) {
+    if (n_threads != num_threads) {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      num_threads = n_threads;
+      pool.reset();
+    }
+  }
+
+  // Run parallel work on ``shared_pool``, which other decks may also use
+  void SharePool(const std::shared_ptr<ThreadPool> &shared_pool) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    pool = shared_pool;
+  }
+
+  // Bytes of the deck's own file, without the files it includes, including
+  // those still being read
+  size_t FileSize() const { return sources[0]->data->FullSize(); }
+
+  // Read only the shell, solid, and thick shell sections that are set, and
+  // keep only the elements of the parts ``part_ids`` or, with ``exclude``,
+  // of every other part. Applies to sections read or loaded afterwards.
+  void SetReadFilter(bool shells, bool solids, bool tshells,
+                     std::optional<NDArray<const int, 1>> part_ids,
+                     bool exclude) {
+    read_shells = shells;
+    read_solids = solids;
+    read_tshells = tshells;
+    part_filter.reset();
+    if (part_ids) {
+      part_filter.reset(new IdIndex({{part_ids->data(), part_ids->shape(0)}}));
+    }
+    exclude_parts = exclude;
+  }
+
+  bool GetSinglePrecision() const { return single_precision; }
+
+  bool GetReleaseBlocks() const { return release_blocks; }
+
+  // Free the blocks read by the pread backend as the deck is read
+  void SetReleaseBlocks(bool release) { release_blocks = release; }
+
+  // Bytes of section cards parsed by Read so far and in all, which is zero
+  // until the keywords are indexed. Safe to call while another thread reads.
+  nb::tuple Progress() const {
+    return nb::make_tuple(bytes_parsed.load(), bytes_to_parse.load());
+  }
+
+  // Stop a Read running on another thread at its next chunk of cards, along
+  // with any later reads, which throw
+  void Cancel() {
+    cancelled = true;
+    if (stream) {
+      stream->Abort();
+    }
+  }
+
+  bool IsCancelled() const { return cancelled; }
+
+  // Store the coordinates of node sections read or loaded afterwards in
+  // single precision
+  void SetSinglePrecision(bool float32) { single_precision = float32; }
+
+  // Whether SetReadFilter leaves out any sections or elements
+  bool IsFiltered() const {
+    return !read_shells || !read_solids || !read_tshells || part_filter;
+  }
+
+  // The deck followed by every file it includes
+  std::vector<std::string> Filenames() const {
+    std::vector<std::string> filenames;
+    for (const std::unique_ptr<SourceFile> &source : sources) {
+      filenames.push_back(source->filename);
+    }
+    return filenames;
+  }
+
+  // *NODE NID X Y Z TC RC
+  // Where TC and RC are translational and rotational constraints:
+  // TC Translational Constraint:
+  //  EQ.0: no constraints,
+  //  EQ.1: constrained x displacement,
+  //  EQ.2: constrained y displacement,
+  //  EQ.3: constrained z displacement,
+  //  EQ.4: constrained x and y displacements,
+  //  EQ.5: constrained y and z displacements,
+  //  EQ.6: constrained z and x displacements,
+  //  EQ.7: constrained x, y, and z displacements.
+  // RC Rotational constraint:
+  //  EQ.0: no constraints,
+  //  EQ.1: constrained x rotation,
+  //  EQ.2: constrained y rotation,
+  //  EQ.3: constrained z rotation,
+  //  EQ.4: constrained x and y rotations,
+  //  EQ.5: constrained y and z rotations,
+  //  EQ.6: constrained z and x rotations,
+  //  EQ.7: constrained x, y, and z rotations.
+  //
+  // Each node ID in each section is unique
+  //
+  // Example:
+  // *NODE
+  //        1-2.309401035E+00-2.309401035E+00-2.309401035E+00       0       0
+  //        2-2.039600611E+00-2.039600611E+00-2.039600611E+00       0       0
+  void ReadNodeSection() {
+    // Assumes that we have already read *NODE and are on the start of the
+    // node information
+    WaitForDeck();
+    SourceFile &deck = *sources[0];
+    const char *begin = deck.data->current;
+    const char *end;
+    NodeArrays arrays;
+    {
+      nb::gil_scoped_release release;
+      arrays = ParseNodeSection(CurrentFormat(), begin, deck.data->end(),
+                                num_threads != 1, &end);
+    }
+    deck.data->current = const_cast<char *>(end);
+    node_sections.push_back(MakeNodeSection(arrays, deck, begin));
+  }
+
+  // Read the section following the *ELEMENT_SECTION command
+  // EID PID NODE0 NODE1 ... NODE_N
+  // where:
+  //   EID: Element ID
+  //   PID: Part ID
+  //   NODE0: Index of node0
+  // ...
+  //
+  // Example
+  // *ELEMENT_SOLID
+  //       1       1       1       2       6       5      17      18      22 21
+  //       2       1       2       3       7       6      18      19      23 22
+  void ReadElementSolidSection() {
+    ReadElementSection(8, element_solid_sections);
+  }
+
+  // Read the section following the *ELEMENT_SHELL command
+  void ReadElementShellSection() {
+    ReadElementSection(4, element_shell_sections);
+  }
+
+  // Sort the keywords of the sections the reader parses by section type
+  void ClassifyKeywords() {
+    node_keywords.clear();
+    element_solid_keywords.clear();
+    element_shell_keywords.clear();
+    node_fields.reset();
+
+    for (size_t i = 0; i < keywords.size(); i++) {
+      switch (ReadSectionType(keywords[i].name)) {
+      case SectionType::Node:
+        node_keywords.push_back(i);
+        break;
+      case SectionType::ElementSolid:
+        element_solid_keywords.push_back(i);
+        break;
+      case SectionType::ElementShell:
+        element_shell_keywords.push_back(i);
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  // Record the name, position, and line of every keyword in the deck and in
+  // the files it includes, without parsing any sections. The keywords of an
+  // included file follow the *INCLUDE that first includes it. Large files
+  // are scanned in parallel.
+  void IndexKeywords() {
+    sources.resize(1);
+    missing_includes.clear();
+    IndexSource(*sources[0], num_threads != 1);
+    IndexIncludes();
+  }
+
+  // Index the files included by the indexed deck and merge their keywords
+  // with the deck's
+  void IndexIncludes() {
+    ResolveIncludes();
+
+    keywords.clear();
+    std::vector<bool> merged(sources.size(), false);
+    MergeKeywords(0, merged);
+    ClassifyKeywords();
+    DetectCardFormat();
+  }
+
+  // Parse the section of keyword ``index`` without storing it. Used to load
+  // sections on demand after IndexKeywords.
+  NodeSection LoadNodeSection(size_t index) {
+    const Keyword &keyword = GetKeyword(index);
+    const SourceFile &source = *sources[keyword.source];
+    const char *begin = KeywordCards(keyword);
+    const char *end;
+    NodeArrays arrays;
+    {
+      nb::gil_scoped_release release;
+      arena->Reserve(keyword.length);
+      arrays = ParseNodeSection(KeywordFormat(keyword), begin,
+                                source.data->end(), num_threads != 1, &end);
+    }
+    return MakeNodeSection(arrays, source, begin);
+  }
+
+  ElementSolidSection LoadElementSolidSection(size_t index) {
+    return LoadElementSection<ElementSolidSection>(index, 8);
+  }
+
+  ElementShellSection LoadElementShellSection(size_t index) {
+    return LoadElementSection<ElementShellSection>(index, 4);
+  }
+
+  // Parse the sections of the indexed keywords into the arena, one array
+  // set per section, reusing those in ``streamed``. Doesn't touch Python,
+  // so runs without the GIL.
+  void ParseSections(ParsedSections &parsed,
+                     const StreamedSections *streamed = nullptr) {
+    struct ParseTask {
+      SectionType type;
+      size_t slot;
+      size_t keyword;
+    };
+    std::vector<ParseTask> tasks;
+    for (size_t i = 0; i < node_keywords.size(); i++) {
+      tasks.push_back({SectionType::Node, i, node_keywords[i]});
+    }
+    for (size_t i = 0; i < element_solid_keywords.size(); i++) {
+      tasks.push_back(
+          {SectionType::ElementSolid, i, element_solid_keywords[i]});
+    }
+    for (size_t i = 0; i < element_shell_keywords.size(); i++) {
+      tasks.push_back(
+          {SectionType::ElementShell, i, element_shell_keywords[i]});
+    }
+
+    parsed.nodes.assign(node_keywords.size(), NodeArrays());
+    parsed.solids.assign(element_solid_keywords.size(), ElementArrays());
+    parsed.shells.assign(element_shell_keywords.size(), ElementArrays());
+
+    // sections parsed as the deck streamed in are kept, unless they were
+    // parsed with another format, such as one set by a later *KEYWORD
+    if (streamed) {
+      std::vector<ParseTask> remaining;
+      for (const ParseTask &task : tasks) {
+        const Keyword &keyword = keywords[task.keyword];
+        auto found = streamed->find(keyword.offset);
+        if (keyword.source != 0 || found == streamed->end() ||
+            found->second.format != KeywordFormat(keyword)) {
+          remaining.push_back(task);
+        } else if (task.type == SectionType::Node) {
+          parsed.nodes[task.slot] = found->second.nodes;
+        } else if (task.type == SectionType::ElementSolid) {
+          parsed.solids[task.slot] = found->second.elements;
+        } else {
+          parsed.shells[task.slot] = found->second.elements;
+        }
+      }
+      tasks.swap(remaining);
+    }
+
+    // a fresh arena for the sections, sized from their cards, which take at
+    // least as many bytes as their arrays unless free format. Sections
+    // parsed as the deck streamed in are already in the arena.
+    size_t section_bytes = 0;
+    for (const ParseTask &task : tasks) {
+      section_bytes += keywords[task.keyword].length;
+    }
+    if (!streamed) {
+      arena = std::make_shared<Arena>();
+      bytes_parsed = 0;
+    }
+    arena->Reserve(section_bytes);
+    bytes_to_parse = bytes_parsed + section_bytes;
+    CheckCancelled();
+    auto parse = [&](const ParseTask &task, bool parallel) {
+      const Keyword &keyword = keywords[task.keyword];
+      const char *begin = KeywordCards(keyword);
+      const char *file_end = sources[keyword.source]->data->end();
+      CardFormat format = KeywordFormat(keyword);
+      const char *end;
+      if (task.type == SectionType::Node) {
+        parsed.nodes[task.slot] =
+            ParseNodeSection(format, begin, file_end, parallel, &end);
+      } else if (task.type == SectionType::ElementSolid) {
+        parsed.solids[task.slot] =
+            ParseElementSection(format, begin, file_end, 8, parallel, &end);
+      } else {
+        parsed.shells[task.slot] =
+            ParseElementSection(format, begin, file_end, 4, parallel, &end);
+      }
+    };
+
+    // Large sections are split across the pool one at a time. The rest are
+    // parsed concurrently, one section per task.
+    std::vector<ParseTask> small_tasks;
+    for (const ParseTask &task : tasks) {
+      if (num_threads != 1 &&
+          keywords[task.keyword].length >= PARALLEL_MIN_BYTES) {
+        parse(task, true);
+      } else {
+        small_tasks.push_back(task);
+      }
+    }
+    if (num_threads == 1 || small_tasks.size() < 2) {
+      for (const ParseTask &task : small_tasks) {
+        parse(task, false);
+      }
+    } else {
+      ParallelFor(Pool(), small_tasks.size(),
+                  [&](size_t i) { parse(small_tasks[i], false); });
+    }
+
+    // the keyword lines counted in the total aren't cards, so finish the
+    // progress here
+    bytes_parsed = bytes_to_parse.load();
+  }
+
+  /* Read the entire deck, including the files it includes */
+  void Read() {
+    // parse every section into plain arrays without the GIL, then wrap them
+    // here, as only this thread may create Python objects
+    ParsedSections parsed;
+    {
+      nb::gil_scoped_release release;
+      Parse(parsed);
+    }
+    WrapSections(parsed);
+  }
+
+  // Index the keywords and parse every section, without touching Python
+  void Parse(ParsedSections &parsed) {
+    if (stream) {
+      ParseStream(parsed);
+      return;
+    }
+    IndexKeywords();
+    ParseSections(parsed);
+  }
+
+  // Index and parse a deck while it's written to its stream, so that
+  // parsing overlaps decompression. The keywords of each block are found as
+  // it arrives, up to its last complete line, and each section is parsed as
+  // soon as the keyword after it arrives. The files the deck includes, and
+  // its last section, are read once the stream is closed.
+  void ParseStream(ParsedSections &parsed) {
+    SourceFile &source = *sources[0];
+    const char *begin = source.data->begin();
+    std::vector<Keyword> &file_keywords = source.keywords;
+    sources.resize(1);
+    missing_includes.clear();
+    file_keywords.clear();
+    source.includes.clear();
+    card_format = CardFormat::Standard;
+    arena = std::make_shared<Arena>();
+    bytes_parsed = 0;
+    bytes_to_parse = 0;
+
+    // When the deck won't read its file again, a prefetched file is read a
+    // couple of blocks ahead of the parser, and the cards of each keyword
+    // are released once its section is parsed. The cards of *KEYWORD and
+    // *INCLUDE keywords are kept, as they're read once the stream ends, and
+    // nothing is released before the first *KEYWORD, which may change the
+    // format of the sections before it.
+    bool release = release_blocks && !source.buffered;
+    if (release) {
+      stream->LimitReadAhead(2 * block_bytes);
+    }
+
+    StreamedSections streamed;
+    bool found_format = false;
+    size_t arrived = 0;
+    size_t scanned = 0;
+    size_t n_lines = 0;
+    size_t n_complete = 0;
+    bool done = false;
+    try {
+      while (!done) {
+        arrived = stream->Wait(arrived, done);
+        // the bytes may have moved to a larger reservation
+        begin = source.data->begin();
+        CheckCancelled();
+        const char *scan_end = begin + arrived;
+        while (!done && scan_end > begin + scanned && scan_end[-1] != '\n') {
+          scan_end--;
+        }
+
+        size_t first = file_keywords.size();
+        size_t range_lines =
+            ScanKeywords(begin + scanned, scan_end, begin, file_keywords);
+        for (size_t i = first; i < file_keywords.size(); i++) {
+          file_keywords[i].line += n_lines;
+        }
+        n_lines += range_lines;
+        scanned = scan_end - begin;
+        bytes_to_parse = scanned;
+
+        // each keyword followed by another has all of its section
+        for (; n_complete + 1 < file_keywords.size(); n_complete++) {
+          const Keyword &keyword = file_keywords[n_complete];
+          const char *section_end =
+              begin + file_keywords[n_complete + 1].offset;
+          if (!found_format && keyword.name == "*KEYWORD") {
+            card_format = DeckCardFormat(begin + keyword.offset, section_end);
+            found_format = true;
+          }
+          ParseStreamedSection(keyword, section_end, streamed);
+          if (release && found_format && keyword.name != "*KEYWORD" &&
+              keyword.name.compare(0, 8, "*INCLUDE") != 0) {
+            const char *cards = NextLine(begin + keyword.offset, section_end);
+            stream->Release(cards - begin, section_end - begin);
+          }
+        }
+      }
+    } catch (...) {
+      stream->Abort();
+      throw;
+    }
+    CompleteKeywords(file_keywords, scanned);
+
+    IndexIncludes();
+    ParseSections(parsed, &streamed);
+  }
+
+  // Parse the section of ``keyword``, of the streamed deck, that ends at
+  // ``end`` into ``streamed`` when the read filter keeps it
+  void ParseStreamedSection(const Keyword &keyword, const char *end,
+                            StreamedSections &streamed) {
+    SectionType type = ReadSectionType(keyword.name);
+    if (type == SectionType::None) {
+      return;
+    }
+    const char *line = sources[0]->data->begin() + keyword.offset;
+    const char *cards = NextLine(line, end);
+    bool parallel = num_threads != 1 && end - cards >= PARALLEL_MIN_BYTES;
+    StreamedSection section;
+    section.format = KeywordCardFormat(line, end, card_format);
+    const char *section_end;
+    arena->Reserve(end - line);
+    if (type == SectionType::Node) {
+      section.nodes = ParseNodeSection(section.format, cards, end, parallel,
+                                       &section_end);
+    } else {
+      section.elements =
+          ParseElementSection(section.format, cards, end,
+                              type == SectionType::ElementSolid ? 8 : 4,
+                              parallel, &section_end);
+    }
+    streamed.emplace(keyword.offset, section);
+  }
+
+  // Wrap the parsed sections for Python, as the deck's sections. Needs the
+  // GIL.
+  void WrapSections(const ParsedSections &parsed) {
+    auto source_of = [&](size_t index) -> const SourceFile & {
+      return *sources[keywords[index].source];
+    };
+    node_sections.clear();
+    for (size_t i = 0; i < node_keywords.size(); i++) {
+      size_t index = node_keywords[i];
+      node_sections.push_back(MakeNodeSection(
+          parsed.nodes[i], source_of(index), KeywordCards(keywords[index])));
+    }
+    element_solid_sections.clear();
+    for (size_t i = 0; i < element_solid_keywords.size(); i++) {
+      size_t index = element_solid_keywords[i];
+      element_solid_sections.push_back(MakeElementSection<ElementSolidSection>(
+          parsed.solids[i], source_of(index), KeywordCards(keywords[index])));
+    }
+    element_shell_sections.clear();
+    for (size_t i = 0; i < element_shell_keywords.size(); i++) {
+      size_t index = element_shell_keywords[i];
+      element_shell_sections.push_back(MakeElementSection<ElementShellSection>(
+          parsed.shells[i], source_of(index), KeywordCards(keywords[index])));
+    }
+
+    ByteRange &bytes = *sources[0]->data;
+    bytes.current = bytes.end();
+    if (release_blocks) {
+      for (const std::unique_ptr<SourceFile> &source : sources) {
+        source->ReleaseBlocks();
+      }
+    }
+  }
+
+  // Write the keywords and the parsed sections to a binary cache at
+  // ``path``. The cache is written to a temporary file first and moved into
+  // place, so readers never see a partial cache.
+  void WriteCache(const std::string &path) {
+    // a missing include could appear later and change the deck without
+    // changing any of its files
+    if (!missing_includes.empty()) {
+      throw std::runtime_error("Cannot cache a deck with missing includes");
+    }
+    // the cache holds the whole deck, in double precision
+    if (IsFiltered()) {
+      throw std::runtime_error("Cannot cache a filtered deck");
+    }
+    if (single_precision) {
+      throw std::runtime_error(
+          "Cannot cache a deck with single precision coordinates");
+    }
+    // the cache is checked against the files of the deck
+    if (sources[0]->buffered) {
+      throw std::runtime_error("Cannot cache a deck read from a buffer");
+    }
+    nb::gil_scoped_release release;
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+
+    // every name is stored in one string: the files, then the keywords
+    std::string names;
+    std::vector<CacheSource> cache_sources;
+    for (size_t i = 0; i < sources.size(); i++) {
+      const SourceFile &source = *sources[i];
+      std::string source_path = i ? source.filename : CanonicalPath(filename);
+      CacheSource cache_source;
+      memset(&cache_source, 0, sizeof(cache_source));
+      FileSizeAndMtime(source.filename.c_str(), &cache_source.size,
+                       &cache_source.mtime_ns);
+      cache_source.hash = ContentHash(*source.data);
+      cache_source.name_offset = names.size();
+      cache_source.name_length = source_path.size();
+      names += source_path;
+      cache_sources.push_back(cache_source);
+    }
+
+    std::vector<CacheKeyword> cache_keywords;
+    for (const Keyword &keyword : keywords) {
+      cache_keywords.push_back({keyword.offset, keyword.length, keyword.line,
+                                names.size(), keyword.name.size(),
+                                keyword.source});
+      names += keyword.name;
+    }
+
+    // each section's arrays and their size in bytes, in the order they're
+    // written
+    std::vector<CacheSection> sections;
+    std::vector<std::pair<const void *, uint64_t>> arrays;
+    auto new_section = [](SectionType type, size_t keyword, size_t n_rows,
+                          int fpos) {
+      CacheSection section;
+      memset(&section, 0, sizeof(section));
+      section.type = static_cast<uint32_t>(type);
+      section.fpos = fpos;
+      section.keyword = keyword;
+      section.n_rows = n_rows;
+      return section;
+    };
+    auto add_array = [&](CacheSection &section, int j, const void *array_data,
+                         uint64_t n_values, size_t value_size) {
+      section.array_size[j] = n_values;
+      arrays.push_back({array_data, n_values * value_size});
+    };
+
+    // the arrays of compact sections, written out in full
+    std::deque<std::vector<int>> expanded;
+    auto expand = [&](size_t n, auto value) {
+      expanded.emplace_back(n);
+      for (size_t i = 0; i < n; i++) {
+        expanded.back()[i] = value(static_cast<int>(i));
+      }
+      return expanded.back().data();
+    };
+
+    for (size_t i = 0; i < node_sections.size(); i++) {
+      const NodeSection &node_section = node_sections[i];
+      size_t n_nodes = node_section.n_nodes;
+      CacheSection section =
+          new_section(SectionType::Node, node_keywords[i], n_nodes,
+                      node_section.fpos);
+      const int *nid = node_section.nid.data();
+      if (node_section.implicit_nid) {
+        nid = expand(n_nodes, [&](int j) { return node_section.Nid(j); });
+      }
+      const int *tc = node_section.tc.data();
+      const int *rc = node_section.rc.data();
+      if (node_section.zero_constraints) {
+        tc = rc = expand(n_nodes, [](int) { return 0; });
+      }
+      add_array(section, 0, nid, n_nodes, sizeof(int));
+      add_array(section, 1, node_section.coord.data(), n_nodes * 3,
+                sizeof(double));
+      add_array(section, 2, tc, n_nodes, sizeof(int));
+      add_array(section, 3, rc, n_nodes, sizeof(int));
+      sections.push_back(section);
+    }
+
+    auto add_element_sections = [&](SectionType type, const auto &list,
+                                    const std::vector<size_t> &list_keywords) {
+      for (size_t i = 0; i < list.size(); i++) {
+        const ElementSection &element_section = list[i];
+        CacheSection section =
+            new_section(type, list_keywords[i], element_section.n_elem,
+                        element_section.fpos);
+        size_t n_elem = element_section.n_elem;
+        const int *eid = element_section.eid.data();
+        if (element_section.implicit_eid) {
+          eid = expand(n_elem, [&](int j) { return element_section.Eid(j); });
+        }
+        const int *offsets = element_section.node_id_offsets.data();
+        if (element_section.stride) {
+          offsets = expand(n_elem + 1,
+                           [&](int j) { return element_section.Offset(j); });
+        }
+        add_array(section, 0, eid, n_elem, sizeof(int));
+        add_array(section, 1, element_section.pid.data(),
+                  element_section.pid.size(), sizeof(int));
+        add_array(section, 2, element_section.node_ids.data(),
+                  element_section.node_ids.size(), sizeof(int));
+        add_array(section, 3, offsets, n_elem + 1, sizeof(int));
+        sections.push_back(section);
+      }
+    };
+    add_element_sections(SectionType::ElementSolid, element_solid_sections,
+                         element_solid_keywords);
+    add_element_sections(SectionType::ElementShell, element_shell_sections,
+                         element_shell_keywords);
+
+    header.n_sources = cache_sources.size();
+    header.n_keywords = cache_keywords.size();
+    header.names_size = names.size();
+    header.n_sections = sections.size();
+
+    // lay out the arrays after the tables
+    uint64_t tables_end = sizeof(CacheHeader) +
+                          cache_sources.size() * sizeof(CacheSource) +
+                          cache_keywords.size() * sizeof(CacheKeyword) +
+                          names.size() + sections.size() * sizeof(CacheSection);
+    uint64_t position = tables_end;
+    for (size_t i = 0; i < arrays.size(); i++) {
+      position = CacheAlign(position);
+      sections[i / CACHE_SECTION_ARRAYS]
+          .array_offset[i % CACHE_SECTION_ARRAYS] = position;
+      position += arrays[i].second;
+    }
+    header.cache_size = position;
+
+    std::string temp_path = CacheTempName(path);
+    FILE *fp = fopen(temp_path.c_str(), "wb");
+    if (!fp) {
+      throw std::runtime_error("Cannot open cache file for writing.");
+    }
 
-  // *NODE NID X Y Z TC RC
-  // Where TC and RC are translational and rotational constraints:
-  // TC Translational Constraint:
-  //  EQ.0: no constraints,
-  //  EQ.1: constrained x displacement,
-  //  EQ.2: constrained y displacement,
-  //  EQ.3: constrained z displacement,
-  //  EQ.4: constrained x and y displacements,
-  //  EQ.5: constrained y and z displacements,
-  //  EQ.6: constrained z and x displacements,
-  //  EQ.7: constrained x, y, and z displacements.
-  // RC Rotational constraint:
-  //  EQ.0: no constraints,
-  //  EQ.1: constrained x rotation,
-  //  EQ.2: constrained y rotation,
-  //  EQ.3: constrained z rotation,
-  //  EQ.4: constrained x and y rotations,
-  //  EQ.5: constrained y and z rotations,
-  //  EQ.6: constrained z and x rotations,
-  //  EQ.7: constrained x, y, and z rotations.
-  //
-  // Each node ID in each section is unique
-  //
-  // Example:
-  // *NODE
-  //        1-2.309401035E+00-2.309401035E+00-2.309401035E+00       0       0
-  //        2-2.039600611E+00-2.039600611E+00-2.039600611E+00       0       0
-  void ReadNodeSection() {
-    // Assumes that we have already read *NODE and are on the start of the
-    // node information
+    try {
+      CacheWrite(fp, &header, sizeof(header));
+      CacheWrite(fp, cache_sources.data(),
+                 cache_sources.size() * sizeof(CacheSource));
+      CacheWrite(fp, cache_keywords.data(),
+                 cache_keywords.size() * sizeof(CacheKeyword));
+      CacheWrite(fp, names.data(), names.size());
+      CacheWrite(fp, sections.data(), sections.size() * sizeof(CacheSection));
+
+      position = tables_end;
+      for (size_t i = 0; i < arrays.size(); i++) {
+        uint64_t offset = sections[i / CACHE_SECTION_ARRAYS]
+                              .array_offset[i % CACHE_SECTION_ARRAYS];
+        CachePad(fp, position, offset);
+        CacheWrite(fp, arrays[i].first, arrays[i].second);
+        position = offset + arrays[i].second;
+      }
 
-#ifdef DEBUG
-    std::cout << "Reading node section" << std::endl;
-#endif
+      if (fclose(fp) != 0) {
+        fp = nullptr;
+        throw std::runtime_error("Error writing cache file");
+      }
+      fp = nullptr;
+      CacheReplace(temp_path, path);
+    } catch (...) {
+      if (fp) {
+        fclose(fp);
+      }
+      remove(temp_path.c_str());
+      throw;
+    }
+  }
 
-    // Since we don't know the total number of nodes, we'll use vectors here,
-    // even though a malloc would be more efficient. Seems they don't store the
-    // total number of nodes per section.
-    std::vector<int> nid;
-    nid.reserve(NNUM_RESERVE);
-    std::vector<double> coord;
-    coord.reserve(NNUM_RESERVE * 3);
+  // Load the keywords and sections from the cache at ``path``. Returns false
+  // without changing the deck when there's no cache, or when it's corrupt or
+  // was written for a different version of the deck or of any file it
+  // includes.
+  //
+  // The cache is memory mapped copy on write and its arrays are used in
+  // place, so the sections may be modified without changing the cache.
+  bool LoadCache(const std::string &path) {
+    if (IsFiltered() || single_precision || sources[0]->buffered) {
+      return false;
+    }
+    std::shared_ptr<MemoryMappedFile> cache;
+    try {
+      cache = std::make_shared<MemoryMappedFile>(path.c_str(),
+                                                 MapMode::CopyOnWrite);
+    } catch (const std::runtime_error &) {
+      return false;
+    }
 
-    std::vector<int> tc;
-    tc.reserve(NNUM_RESERVE);
+    char *data = cache->begin();
+    uint64_t size = cache->end() - data;
+    if (size < sizeof(CacheHeader)) {
+      return false;
+    }
 
-    std::vector<int> rc;
-    rc.reserve(NNUM_RESERVE);
+    CacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CACHE_VERSION ||
+        header.byte_order != CACHE_BYTE_ORDER || header.cache_size != size) {
+      return false;
+    }
 
-    int start_pos = memmap.tellg();
+    // the tables must fit within the cache
+    if (header.n_sources == 0 ||
+        header.n_sources > size / sizeof(CacheSource) ||
+        header.n_keywords > size / sizeof(CacheKeyword) ||
+        header.n_sections > size / sizeof(CacheSection) ||
+        header.names_size > size) {
+      return false;
+    }
+    uint64_t sources_offset = sizeof(CacheHeader);
+    uint64_t keywords_offset =
+        sources_offset + header.n_sources * sizeof(CacheSource);
+    uint64_t names_offset =
+        keywords_offset + header.n_keywords * sizeof(CacheKeyword);
+    uint64_t sections_offset = names_offset + header.names_size;
+    uint64_t tables_end =
+        sections_offset + header.n_sections * sizeof(CacheSection);
+    if (tables_end > size) {
+      return false;
+    }
 
-    int index = 0;
-    while (memmap[0] != '*') {
+    // name within the names stored in the cache, when it's in bounds
+    auto cached_name = [&](uint64_t offset, uint64_t length,
+                           std::string &name) {
+      if (offset > header.names_size || length > header.names_size - offset) {
+        return false;
+      }
+      name.assign(data + names_offset + offset, length);
+      return true;
+    };
+
+    // every file must have the size and modification time it had when the
+    // cache was written
+    std::vector<CacheSource> cache_sources(header.n_sources);
+    std::vector<std::string> source_paths(header.n_sources);
+    for (uint64_t i = 0; i < header.n_sources; i++) {
+      CacheSource &source = cache_sources[i];
+      memcpy(&source, data + sources_offset + i * sizeof(CacheSource),
+             sizeof(source));
+      std::string &source_path = source_paths[i];
+      if (!cached_name(source.name_offset, source.name_length, source_path)) {
+        return false;
+      }
+      if (i == 0 && source_path != CanonicalPath(filename)) {
+        return false;
+      }
 
-      // skip comments
-      if (memmap[0] == '$') {
-#ifdef DEBUG
-        std::cout << "Skipping comment line" << std::endl;
-#endif
-        memmap.seek_eol();
-        continue;
+      uint64_t source_size;
+      int64_t source_mtime_ns;
+      try {
+        FileSizeAndMtime(source_path.c_str(), &source_size, &source_mtime_ns);
+      } catch (const std::runtime_error &) {
+        return false;
+      }
+      if (source_size != source.size || source_mtime_ns != source.mtime_ns) {
+        return false;
       }
+    }
 
-#ifdef DEBUG
-      std::cout << "Reading node" << std::endl;
-#endif
+    // hashing reads every file, so it's checked last
+    std::vector<std::unique_ptr<SourceFile>> cached_sources(header.n_sources);
+    {
+      nb::gil_scoped_release release;
+      sources[0]->data->WaitComplete();
+      for (uint64_t i = 0; i < header.n_sources; i++) {
+        const ByteRange *bytes = sources[0]->data.get();
+        if (i) {
+          try {
+            cached_sources[i].reset(new SourceFile(source_paths[i]));
+          } catch (const std::runtime_error &) {
+            return false;
+          }
+          bytes = cached_sources[i]->data.get();
+        }
+        if (ContentHash(*bytes) != cache_sources[i].hash) {
+          return false;
+        }
+      }
+    }
 
-      // Read node num (assumes first 8 char)
-      nid.push_back(fast_atoi(memmap.current, 8));
-      memmap += 8;
+    std::vector<Keyword> cached_keywords(header.n_keywords);
+    for (uint64_t i = 0; i < header.n_keywords; i++) {
+      CacheKeyword keyword;
+      memcpy(&keyword, data + keywords_offset + i * sizeof(CacheKeyword),
+             sizeof(keyword));
+      Keyword &cached_keyword = cached_keywords[i];
+      if (!cached_name(keyword.name_offset, keyword.name_length,
+                       cached_keyword.name) ||
+          keyword.source >= header.n_sources) {
+        return false;
+      }
+      cached_keyword.offset = keyword.offset;
+      cached_keyword.length = keyword.length;
+      cached_keyword.line = keyword.line;
+      cached_keyword.source = keyword.source;
+      cached_keyword.filename = keyword.source ? source_paths[keyword.source]
+                                               : filename;
+    }
 
-#ifdef DEBUG
-      std::cout << "Reading NID " << nid.back() << std::endl;
-#endif
+    // pointer to array ``j`` of ``section`` when it's within the cache and
+    // holds ``n_values`` values
+    auto array_data = [&](const CacheSection &section, int j,
+                          uint64_t n_values, size_t value_size) -> char * {
+      uint64_t offset = section.array_offset[j];
+      if (section.array_size[j] != n_values || offset % CACHE_ALIGNMENT ||
+          offset < tables_end || offset > size ||
+          n_values > (size - offset) / value_size) {
+        return nullptr;
+      }
+      return data + offset;
+    };
+
+    std::vector<NodeSection> cached_node_sections;
+    std::vector<ElementSolidSection> cached_element_solid_sections;
+    std::vector<ElementShellSection> cached_element_shell_sections;
+    for (uint64_t i = 0; i < header.n_sections; i++) {
+      CacheSection section;
+      memcpy(&section, data + sections_offset + i * sizeof(CacheSection),
+             sizeof(section));
+      if (section.n_rows >= INT32_MAX || section.keyword >= header.n_keywords) {
+        return false;
+      }
+      int n_rows = static_cast<int>(section.n_rows);
+      const std::string &section_filename =
+          cached_keywords[section.keyword].filename;
+
+      SectionType type = static_cast<SectionType>(section.type);
+      if (type == SectionType::Node) {
+        int *nid = reinterpret_cast<int *>(
+            array_data(section, 0, n_rows, sizeof(int)));
+        double *coord = reinterpret_cast<double *>(
+            array_data(section, 1, 3 * section.n_rows, sizeof(double)));
+        int *tc = reinterpret_cast<int *>(
+            array_data(section, 2, n_rows, sizeof(int)));
+        int *rc = reinterpret_cast<int *>(
+            array_data(section, 3, n_rows, sizeof(int)));
+        if (!nid || !coord || !tc || !rc) {
+          return false;
+        }
 
-      // next three are always node coordinates in the format of F12.9
-      // which comes to 16 characters total
-      ans_strtod(memmap.current, 16, coord);
-      memmap += 16;
-      ans_strtod(memmap.current, 16, coord);
-      memmap += 16;
-      ans_strtod(memmap.current, 16, coord);
-      memmap += 16;
+        std::array<int, 1> nid_shape = {n_rows};
+        cached_node_sections.emplace_back(
+            WrapSharedNDArray<int, 1>(nid, nid_shape, cache),
+            WrapSharedNDArray<double, 2>(coord, {n_rows, 3}, cache),
+            WrapSharedNDArray<int, 1>(tc, nid_shape, cache),
+            WrapSharedNDArray<int, 1>(rc, nid_shape, cache), section.fpos);
+        cached_node_sections.back().filename = section_filename;
+      } else if (type == SectionType::ElementSolid ||
+                 type == SectionType::ElementShell) {
+        int num_nodes = type == SectionType::ElementSolid ? 8 : 4;
+        uint64_t n_node_ids = section.n_rows * num_nodes;
+        if (n_node_ids >= INT32_MAX) {
+          return false;
+        }
+        int *eid = reinterpret_cast<int *>(
+            array_data(section, 0, n_rows, sizeof(int)));
+        int *pid = reinterpret_cast<int *>(
+            array_data(section, 1, n_rows, sizeof(int)));
+        int *node_ids = reinterpret_cast<int *>(
+            array_data(section, 2, n_node_ids, sizeof(int)));
+        int *node_id_offsets = reinterpret_cast<int *>(
+            array_data(section, 3, section.n_rows + 1, sizeof(int)));
+        if (!eid || !pid || !node_ids || !node_id_offsets) {
+          return false;
+        }
 
-#ifdef DEBUG
-      std::cout << "Done reading coordinates " << std::endl;
-#endif
+        // the offsets index node_ids, so they're checked before use
+        for (int j = 0; j <= n_rows; j++) {
+          if (node_id_offsets[j] != j * num_nodes) {
+            return false;
+          }
+        }
 
-      // Populate constraints. These may be missing from the node section, and
-      // if they are, populate a zero.
-      if (memmap.eol()) {
-#ifdef DEBUG
-        std::cout << "EOL on tc" << std::endl;
-#endif
-        tc.push_back(0);
+        std::array<int, 1> nel_shape = {n_rows};
+        NDArray<int, 1> eid_arr =
+            WrapSharedNDArray<int, 1>(eid, nel_shape, cache);
+        NDArray<int, 1> pid_arr =
+            WrapSharedNDArray<int, 1>(pid, nel_shape, cache);
+        NDArray<int, 1> node_ids_arr = WrapSharedNDArray<int, 1>(
+            node_ids, {static_cast<int>(n_node_ids)}, cache);
+        NDArray<int, 1> node_id_offsets_arr =
+            WrapSharedNDArray<int, 1>(node_id_offsets, {n_rows + 1}, cache);
+        ElementSection *element_section;
+        if (type == SectionType::ElementSolid) {
+          cached_element_solid_sections.emplace_back(
+              eid_arr, pid_arr, node_ids_arr, node_id_offsets_arr);
+          element_section = &cached_element_solid_sections.back();
+        } else {
+          cached_element_shell_sections.emplace_back(
+              eid_arr, pid_arr, node_ids_arr, node_id_offsets_arr);
+          element_section = &cached_element_shell_sections.back();
+        }
+        element_section->fpos = section.fpos;
+        element_section->filename = section_filename;
       } else {
-        tc.push_back(fast_atoi(memmap.current, 8));
-        memmap += 8;
+        return false;
       }
+    }
 
-      if (memmap.eol()) {
-#ifdef DEBUG
-        std::cout << "EOL on rc" << std::endl;
-#endif
-        rc.push_back(0);
+    cached_sources[0] = std::move(sources[0]);
+    sources = std::move(cached_sources);
+    missing_includes.clear();
+    keywords = std::move(cached_keywords);
+    ClassifyKeywords();
+    DetectCardFormat();
+    node_sections = std::move(cached_node_sections);
+    element_solid_sections = std::move(cached_element_solid_sections);
+    element_shell_sections = std::move(cached_element_shell_sections);
+    ByteRange &bytes = *sources[0]->data;
+    bytes.current = bytes.end();
+    return true;
+  }
+
+  int ReadLine() {
+    WaitForDeck();
+    return sources[0]->data->read_line();
+  }
+
+  // Index the node IDs of ``node_secs``. Nodes are numbered in order across
+  // the sections, like the points of ToVTK. The index is built without the
+  // GIL and replaces the previous one with it.
+  void IndexNodeIds(const std::vector<NodeSection> &node_secs) {
+    IdIndex index;
+    {
+      nb::gil_scoped_release release;
+      index = IdIndex(NodeIdBlocks(node_secs));
+    }
+    node_id_index = std::move(index);
+  }
+
+  // Index the element IDs of the shell sections followed by the solid
+  // sections
+  void IndexElementIds(const std::vector<ElementShellSection> &shell_secs,
+                       const std::vector<ElementSolidSection> &solid_secs) {
+    std::vector<IdBlock> blocks;
+    for (const ElementShellSection &section : shell_secs) {
+      blocks.push_back(ElementIdBlock(section));
+    }
+    for (const ElementSolidSection &section : solid_secs) {
+      blocks.push_back(ElementIdBlock(section));
+    }
+    IdIndex index;
+    {
+      nb::gil_scoped_release release;
+      index = IdIndex(blocks);
+    }
+    element_id_index = std::move(index);
+  }
+
+  // Index of each node ID from IndexNodeIds, or -1 for a missing ID
+  NDArray<int64_t, 1> NodeIndex(const NDArray<const int, 1> ids) {
+    int n_ids = static_cast<int>(ids.shape(0));
+    NDArray<int64_t, 1> index_arr = MakeNDArray<int64_t, 1>({n_ids});
+    FindIds(node_id_index, ids.data(), n_ids, index_arr.data());
+    return index_arr;
+  }
+
+  // Section and row of each element ID from IndexElementIds, or -1 for both
+  // of a missing ID
+  nb::tuple ElementIndex(const NDArray<const int, 1> ids) {
+    int n_ids = static_cast<int>(ids.shape(0));
+    std::vector<int64_t> positions(n_ids);
+    FindIds(element_id_index, ids.data(), n_ids, positions.data());
+
+    NDArray<int, 1> section_arr = MakeNDArray<int, 1>({n_ids});
+    NDArray<int, 1> row_arr = MakeNDArray<int, 1>({n_ids});
+    int *section = section_arr.data();
+    int *row = row_arr.data();
+    for (int i = 0; i < n_ids; i++) {
+      if (positions[i] < 0) {
+        section[i] = row[i] = -1;
       } else {
-        rc.push_back(fast_atoi(memmap.current, 8));
+        std::pair<int, int> location = element_id_index.Locate(positions[i]);
+        section[i] = location.first;
+        row[i] = location.second;
       }
+    }
+    return nb::make_tuple(section_arr, row_arr);
+  }
 
-      // skip remainder of the line
-      memmap.seek_eol();
+  // Extract the elements of the parts ``part_ids`` from ``shell_secs`` and
+  // ``solid_secs`` along with the nodes they reference, which are found
+  // through the index of IndexNodeIds for ``node_secs``. Returns a list with
+  // one node section of the referenced nodes, in deck order, and lists of
+  // the selected elements of each shell and solid section, which are empty
+  // for sections without any. With ``renumber``, nodes and elements are
+  // numbered from 1 in order, shells before solids.
+  nb::tuple ExtractParts(const std::vector<NodeSection> &node_secs,
+                         const std::vector<ElementShellSection> &shell_secs,
+                         const std::vector<ElementSolidSection> &solid_secs,
+                         const NDArray<const int, 1> part_ids,
+                         bool renumber) {
+    size_t n_deck_nodes = 0;
+    for (const NodeSection &section : node_secs) {
+      n_deck_nodes += section.n_nodes;
+    }
+    if (node_id_index.Size() != n_deck_nodes) {
+      throw std::runtime_error("Index the node IDs before extracting parts");
+    }
+    IdIndex parts({{part_ids.data(), part_ids.shape(0)}});
+
+    std::vector<ElementShellSection> shells;
+    std::vector<ElementSolidSection> solids;
+    std::vector<std::vector<int64_t>> positions(shell_secs.size() +
+                                                solid_secs.size());
+    size_t s = 0;
+    for (const ElementShellSection &section : shell_secs) {
+      shells.push_back(SelectPartElements(section, parts, node_id_index,
+                                          positions[s++]));
+    }
+    for (const ElementSolidSection &section : solid_secs) {
+      solids.push_back(SelectPartElements(section, parts, node_id_index,
+                                          positions[s++]));
     }
 
-    NodeSection *node_section = new NodeSection(nid, coord, tc, rc, start_pos);
-    node_sections.push_back(*node_section);
+    // the referenced nodes, in the order of the deck
+    std::vector<int64_t> nodes;
+    {
+      nb::gil_scoped_release release;
+      for (const std::vector<int64_t> &section_positions : positions) {
+        nodes.insert(nodes.end(), section_positions.begin(),
+                     section_positions.end());
+      }
+      std::sort(nodes.begin(), nodes.end());
+      nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+    }
 
-    return;
-  }
+    int n_nodes = static_cast<int>(nodes.size());
+    NDArray<int, 1> nid_arr = MakeNDArray<int, 1>({n_nodes});
+    NDArray<double, 2> coord_arr = MakeNDArray<double, 2>({n_nodes, 3});
+    NDArray<int, 1> tc_arr = MakeNDArray<int, 1>({n_nodes});
+    NDArray<int, 1> rc_arr = MakeNDArray<int, 1>({n_nodes});
+    {
+      nb::gil_scoped_release release;
+      for (int i = 0; i < n_nodes; i++) {
+        std::pair<int, int> location = node_id_index.Locate(nodes[i]);
+        const NodeSection &section = node_secs[location.first];
+        int row = location.second;
+        nid_arr(i) = renumber ? i + 1 : section.Nid(row);
+        for (int j = 0; j < 3; j++) {
+          coord_arr(i, j) = section.Coord(row, j);
+        }
+        tc_arr(i) = section.Tc(row);
+        rc_arr(i) = section.Rc(row);
+      }
+    }
+    std::vector<NodeSection> node_sections;
+    node_sections.emplace_back(nid_arr, coord_arr, tc_arr, rc_arr, 0);
+
+    if (renumber) {
+      nb::gil_scoped_release release;
+      int eid = 0;
+      s = 0;
+      auto renumber_section = [&](ElementSection &section) {
+        for (int i = 0; i < section.n_elem; i++) {
+          section.eid(i) = ++eid;
+        }
+        const std::vector<int64_t> &section_positions = positions[s++];
+        for (size_t j = 0; j < section_positions.size(); j++) {
+          section.node_ids(j) = static_cast<int>(
+              std::lower_bound(nodes.begin(), nodes.end(),
+                               section_positions[j]) -
+              nodes.begin() + 1);
+        }
+      };
+      for (ElementShellSection &section : shells) {
+        renumber_section(section);
+      }
+      for (ElementSolidSection &section : solids) {
+        renumber_section(section);
+      }
+    }
 
-  template <typename T> T ReadElementSection(int num_nodes) {
+    return nb::make_tuple(node_sections, shells, solids);
+  }
 
-#ifdef DEBUG
-    std::cout << "Reading element section" << std::endl;
-#endif
+  // Merge node and element sections into the arrays of a single VTK grid:
+  // the points, their node IDs, the connectivity with node IDs mapped to
+  // point indices, the offsets, cell types, and the part ID of each cell.
+  // Shells come before solids. Connectivity and offsets are int64 when
+  // ``wide`` is set and int32 otherwise.
+  nb::tuple ToVTK(const std::vector<NodeSection> &node_secs,
+                  const std::vector<ElementShellSection> &shell_secs,
+                  const std::vector<ElementSolidSection> &solid_secs,
+                  bool wide) {
+    if (wide) {
+      return AssembleVTK<int64_t>(node_secs, shell_secs, solid_secs);
+    }
+    return AssembleVTK<int32_t>(node_secs, shell_secs, solid_secs);
+  }
 
-    std::vector<int> eid;
-    eid.reserve(ENUM_RESERVE);
+  // Copy the file containing the node sections ``sections``, given as
+  // indices into the node sections, to ``filename`` and overwrite the
+  // coordinates of their cards in the copy. ``coord_arr`` holds the nodes of
+  // each section in turn. The copy is mapped and its cards are rewritten in
+  // place, in parallel for large sections.
+  void OverwriteNodeSections(const std::string &filename,
+                             const std::vector<size_t> &sections,
+                             const NDArray<const double, 2> coord_arr) {
+    if (coord_arr.shape(1) != 3) {
+      throw std::invalid_argument("Expected 3D node coordinates");
+    }
+    size_t source_index, n_rows;
+    std::vector<NodeChunk> chunks =
+        ChunkNodeSections(sections, source_index, n_rows);
+    CheckNodeCount(coord_arr.shape(0), n_rows);
+    nb::gil_scoped_release release;
+
+    const SourceFile &source = *sources[source_index];
+    if (source.buffered) {
+      WriteFile(filename.c_str(), source.data->begin(),
+                source.data->end() - source.data->begin());
+    } else {
+      CloneFile(source.filename.c_str(), filename.c_str());
+    }
+    MemoryMappedFile out(filename.c_str(), MapMode::Write);
+    if (out.end() - out.begin() !=
+        source.data->end() - source.data->begin()) {
+      throw std::runtime_error("Error copying file");
+    }
 
-    std::vector<int> pid;
-    pid.reserve(ENUM_RESERVE);
+    const double *coord = coord_arr.data();
+    ForEachBlock(chunks.size(), [&](size_t i) {
+      const NodeChunk &chunk = chunks[i];
+      WriteNodeCards(chunk.format, out.begin() + chunk.begin,
+                     out.begin() + chunk.end, coord + chunk.row * 3,
+                     chunk.n_rows);
+    });
+  }
 
-    std::vector<int> node_ids;
-    node_ids.reserve(ENUM_RESERVE * 20); // using 20 as an upper guess
+  // Write a copy of the file containing every node section to each of
+  // ``filenames``, with the node coordinates of the copy ``k`` taken from
+  // ``coord_arr[k]``. The coordinate fields are located once, after which
+  // each file is written in a single pass, copying the bytes between the
+  // fields and formatting the fields. Files are written in parallel.
+  void WriteNodeVariants(const std::vector<std::string> &filenames,
+                         const NDArray<const double, 3> coord_arr) {
+    nb::gil_scoped_release release;
+    {
+      std::lock_guard<std::mutex> lock(node_fields_mutex);
+      if (!node_fields) {
+        LocateNodeFields();
+      }
+    }
+    const NodeFields &fields = *node_fields;
+    if (coord_arr.shape(0) != filenames.size()) {
+      throw std::invalid_argument(
+          "Expected one set of node coordinates for each file");
+    }
+    if (coord_arr.shape(2) != 3) {
+      throw std::invalid_argument("Expected 3D node coordinates");
+    }
+    size_t n_rows = fields.offsets.size();
+    CheckNodeCount(coord_arr.shape(1), n_rows);
+
+    // truncating a file of the deck would pull it from under its mapping
+    for (const std::string &name : filenames) {
+      for (const std::unique_ptr<SourceFile> &source : sources) {
+        if (!source->buffered &&
+            SameFile(name.c_str(), source->filename.c_str())) {
+          throw std::invalid_argument(
+              "Cannot write a variant over a file of the deck: " + name);
+        }
+      }
+    }
 
-    std::vector<int> node_id_offsets;
-    node_id_offsets.reserve(ENUM_RESERVE);
+    const char *data = sources[fields.source]->data->begin();
+    size_t size = sources[fields.source]->data->end() - data;
+    const double *coord = coord_arr.data();
 
-    int offset = 0;
-    node_id_offsets.push_back(0);
-    while (memmap[0] != '*') {
-      if (memmap[0] == '$') {
-        memmap.seek_eol();
-        continue;
+    auto write_variant = [&](size_t k) {
+      std::unique_ptr<FILE, int (*)(FILE *)> fp(
+          fopen(filenames[k].c_str(), "wb"), fclose);
+      if (!fp) {
+        throw std::runtime_error("Error creating file " + filenames[k]);
       }
 
-      eid.push_back(fast_atoi(memmap.current, 8));
-      memmap += 8;
-      pid.push_back(fast_atoi(memmap.current, 8));
-      memmap += 8;
+      std::vector<char> buffer;
+      buffer.reserve(VARIANT_BUFFER_BYTES + 3 * LongCards::float_width);
+      auto write = [&](const char *p, size_t n) {
+        if (fwrite(p, 1, n, fp.get()) != n) {
+          throw std::runtime_error("Error writing file " + filenames[k]);
+        }
+      };
+      auto flush = [&]() {
+        write(buffer.data(), buffer.size());
+        buffer.clear();
+      };
+      // large spans, such as the element sections, bypass the buffer
+      auto append = [&](const char *p, size_t n) {
+        if (buffer.size() + n > VARIANT_BUFFER_BYTES) {
+          flush();
+        }
+        if (n > VARIANT_BUFFER_BYTES) {
+          write(p, n);
+        } else {
+          buffer.insert(buffer.end(), p, p + n);
+        }
+      };
+
+      const double *variant = coord + k * n_rows * 3;
+      size_t pos = 0;
+      for (const NodeChunk &chunk : fields.chunks) {
+        int width = FloatWidth(chunk.format);
+        for (size_t row = chunk.row; row < chunk.row + chunk.n_rows; row++) {
+          size_t field = fields.offsets[row];
+          append(data + pos, field - pos);
+          size_t n = buffer.size();
+          buffer.resize(n + 3 * width);
+          FormatCoordinates(buffer.data() + n, variant + row * 3, width);
+          pos = field + 3 * width;
+        }
+      }
+      append(data + pos, size - pos);
+      flush();
 
-      // Read the specified number of nodes
-      for (int i = 0; i < num_nodes; i++) {
-        node_ids.push_back(fast_atoi(memmap.current, 8));
-        memmap += 8;
+      if (fclose(fp.release()) != 0) {
+        throw std::runtime_error("Error writing file " + filenames[k]);
       }
+    };
 
-      node_id_offsets.push_back(node_ids.size());
+    ForEachBlock(filenames.size(), write_variant);
+  }
+};
 
-      memmap.seek_eol();
+// Reads several decks on one pool that they share. Each deck is parsed by a
+// pool task, largest first, and its large sections are split across the
+// same pool, so workers that finish small decks help with the large ones.
+// Sections are wrapped for Python by the thread calling Next, in the order
+// the decks finish.
+class DeckLoader {
+private:
+  struct Item {
+    Deck *deck;
+    ParsedSections parsed;
+    std::exception_ptr error;
+    bool returned = false; // by Next
+  };
+  std::vector<Item> items;
+  std::shared_ptr<ThreadPool> pool;
+  std::mutex mutex;
+  std::condition_variable deck_finished;
+  std::deque<size_t> finished; // decks parsed but not yet returned by Next
+  size_t n_running = 0;
+
+  void Load(size_t index) {
+    Item &item = items[index];
+    try {
+      item.deck->Parse(item.parsed);
+    } catch (...) {
+      item.error = std::current_exception();
     }
 
-    T *element_section = new T(eid, pid, node_ids, node_id_offsets);
-    return *element_section;
+    std::lock_guard<std::mutex> lock(mutex);
+    finished.push_back(index);
+    n_running--;
+    deck_finished.notify_all();
   }
 
-  // Read the section following the *ELEMENT_SECTION command
-  // EID PID NODE0 NODE1 ... NODE_N
-  // where:
-  //   EID: Element ID
-  //   PID: Part ID
-  //   NODE0: Index of node0
-  // ...
-  //
-  // Example
-  // *ELEMENT_SOLID
-  //       1       1       1       2       6       5      17      18      22 21
-  //       2       1       2       3       7       6      18      19      23 22
-  void ReadElementSolidSection() {
-    element_solid_sections.push_back(
-        ReadElementSection<ElementSolidSection>(8));
+public:
+  // Start reading ``decks``, which must outlive the loader, on a pool of
+  // ``num_threads`` threads
+  DeckLoader(const std::vector<Deck *> &decks, int num_threads)
+      : pool(new ThreadPool(ResolveNumThreads(num_threads))) {
+    for (Deck *deck : decks) {
+      deck->SharePool(pool);
+      items.push_back({deck, ParsedSections(), nullptr, false});
+    }
+
+    std::vector<size_t> order(items.size());
+    for (size_t i = 0; i < order.size(); i++) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return items[a].deck->FileSize() > items[b].deck->FileSize();
+    });
+    n_running = items.size();
+    for (size_t index : order) {
+      pool->Submit([this, index] { Load(index); });
+    }
   }
 
-  // Read the section following the *ELEMENT_SHELL command
-  void ReadElementShellSection() {
-    element_shell_sections.push_back(
-        ReadElementSection<ElementShellSection>(4));
+  // Decks that weren't returned are cancelled, and waited for, as their
+  // tasks refer to the loader
+  ~DeckLoader() {
+    for (Item &item : items) {
+      if (!item.returned) {
+        item.deck->Cancel();
+      }
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    deck_finished.wait(lock, [this] { return n_running == 0; });
   }
 
-  /* Read the entire deck */
-  void Read() {
-    int first_char, next_char;
+  DeckLoader(const DeckLoader &) = delete;
+  DeckLoader &operator=(const DeckLoader &) = delete;
+
+  // Wait for the next deck to finish and wrap its sections, returning its
+  // index within the decks. Rethrows the error of a deck that failed.
+  size_t Next() {
+    size_t index = items.size();
+    {
+      nb::gil_scoped_release release;
+      std::unique_lock<std::mutex> lock(mutex);
+      deck_finished.wait(lock,
+                         [this] { return !finished.empty() || !n_running; });
+      if (!finished.empty()) {
+        index = finished.front();
+        finished.pop_front();
+      }
+    }
+    if (index == items.size()) {
+      throw nb::stop_iteration();
+    }
 
-    while (true) {
-      // Parse based on the first character rather than reading the entire
-      // line. It's faster and the parsing logic is always based on the first
-      // character
+    Item &item = items[index];
+    item.returned = true;
+    if (item.error) {
+      std::rethrow_exception(item.error);
+    }
+    item.deck->WrapSections(item.parsed);
+    item.parsed = ParsedSections();
+    return index;
+  }
+};
 
-      if (memmap.eof()) {
-#ifdef DEBUG
-        std::cout << "Reached EOF" << std::endl;
-#endif
-        break;
+// Reads the node or the element sections of a deck a chunk of cards at a
+// time, in one pass over the mapped file, for decks too large to hold in
+// memory. Every chunk is parsed into the same arrays, and the pages of the
+// file already read are released as it goes, so memory follows the size of
+// a chunk rather than of the deck. Files the deck includes aren't read, nor
+// are compressed decks, which are only read whole into memory by a Deck.
+class SectionReader {
+private:
+  MemoryMappedFile file;
+  bool read_nodes;
+  bool read_shells;
+  bool read_solids;
+  bool read_tshells;
+  int chunk_rows;
+  CardFormat card_format = CardFormat::Standard;
+  CardFormat format = CardFormat::Standard; // of the current section
+  bool in_section = false;
+  const char *pos;      // start of the next line to read
+  const char *released; // end of the pages released so far
+
+  // Release the pages before ``pos`` once enough have been read
+  void ReleaseRead(bool force = false) {
+    if (force || pos - released >= RELEASE_BYTES) {
+      file.Release(released, pos);
+      released = pos;
+    }
+  }
+
+  // Skip the cards of a section that isn't read
+  void SkipCards() {
+    const char *end = file.end();
+    while (pos < end && *pos != '*') {
+      pos = NextLine(pos, end);
+      ReleaseRead();
+    }
+  }
+
+  // Move to the cards of the next section that's read. Returns false at the
+  // end of the file.
+  bool NextSection() {
+    const char *end = file.end();
+    SkipCards();
+    while (pos < end) {
+      const char *line = pos;
+      pos = NextLine(line, end);
+      const char *name_end = line;
+      while (name_end < pos &&
+             !isspace(static_cast<unsigned char>(*name_end))) {
+        name_end++;
+      }
+      std::string name(line, name_end);
+      if (name == "*KEYWORD") {
+        card_format = DeckCardFormat(line, end);
       }
 
-      first_char = memmap[0];
-#ifdef DEBUG
-      std::cout << "Read character: " << static_cast<char>(first_char)
-                << std::endl;
-#endif
+      SectionType type = KeywordSectionType(name);
+      bool read = false;
+      if (read_nodes) {
+        read = type == SectionType::Node;
+      } else if (type == SectionType::ElementShell) {
+        read = read_shells;
+        num_nodes = 4;
+      } else if (type == SectionType::ElementSolid) {
+        read = name.compare(0, 15, "*ELEMENT_TSHELL") == 0 ? read_tshells
+                                                            : read_solids;
+        num_nodes = 8;
+      }
+      if (read) {
+        format = KeywordCardFormat(line, end, card_format);
+        keyword = name;
+        section++;
+        in_section = true;
+        return true;
+      }
+      SkipCards();
+    }
+    return false;
+  }
 
-      // Check if line contains a keyword
-      if (first_char != '*') {
-        memmap.seek_eol();
+  // Parse up to ``chunk_rows`` cards of the current section into the
+  // arrays, ending the section at its last card
+  template <typename Layout> int ReadCards() {
+    const char *end = file.end();
+    int n = 0;
+    while (n < chunk_rows) {
+      if (pos >= end || *pos == '*') {
+        in_section = false;
+        break;
+      }
+      const char *p = pos;
+      const char *next = NextLine(p, end);
+      pos = next;
+      if (*p == '$') {
         continue;
       }
-
-      memmap.read_line();
-      if (memmap.line.compare(0, 5, "*NODE") == 0) {
-        ReadNodeSection();
-      } else if (memmap.line.compare(0, 14, "*ELEMENT_SOLID") == 0) {
-        ReadElementSolidSection();
-      } else if (memmap.line.compare(0, 14, "*ELEMENT_SHELL") == 0) {
-        ReadElementShellSection();
-      } else if (memmap.line.compare(0, 15, "*ELEMENT_TSHELL") == 0) {
-        ReadElementSolidSection();
+      bool free_format = memchr(p, ',', next - p) != nullptr;
+      if (read_nodes) {
+        double *xyz = &coord.data()[n * 3];
+        int *row_nid = &nid.data()[n];
+        int *row_tc = &tc.data()[n];
+        int *row_rc = &rc.data()[n];
+        if (free_format) {
+          ParseNodeFreeLine(p, next, row_nid, xyz, row_tc, row_rc);
+        } else {
+          ParseNodeLine<Layout>(p, next, row_nid, xyz, row_tc, row_rc);
+        }
+      } else {
+        int *row_nodes = &node_ids.data()[n * num_nodes];
+        if (free_format) {
+          ParseElementFreeLine(p, next, num_nodes, &eid.data()[n],
+                               &pid.data()[n], row_nodes);
+        } else {
+          ParseElementLine<Layout>(p, end, num_nodes, &eid.data()[n],
+                                   &pid.data()[n], row_nodes);
+        }
       }
+      n++;
     }
+    return n;
   }
 
-  int ReadLine() { return memmap.read_line(); }
-};
+public:
+  // The section of the last chunk, as its index among the sections read,
+  // its keyword, and the nodes of each of its elements
+  int section = -1;
+  std::string keyword;
+  int num_nodes = 0;
+
+  // Arrays each chunk is parsed into, of which the first rows hold the
+  // chunk. Node IDs of elements are ``num_nodes`` to a row.
+  NDArray<int, 1> nid;
+  NDArray<double, 2> coord;
+  NDArray<int, 1> tc;
+  NDArray<int, 1> rc;
+  NDArray<int, 1> eid;
+  NDArray<int, 1> pid;
+  NDArray<int, 1> node_ids;
 
-void OverwriteNodeSection(const char *filename, int fpos,
-                          const NDArray<const double, 2> coord_arr) {
+  // Read the node sections of ``filename`` when ``nodes`` is set, and
+  // otherwise its element sections of the kinds selected
+  SectionReader(const std::string &filename, bool nodes, int rows,
+                bool shells, bool solids, bool tshells)
+      : file(filename.c_str()), read_nodes(nodes), read_shells(shells),
+        read_solids(solids), read_tshells(tshells), chunk_rows(rows) {
+    if (rows < 1 || rows > INT_MAX / MAX_ELEMENT_NODES) {
+      throw std::invalid_argument("Invalid number of rows per chunk");
+    }
+    // pages are released once read, so the whole deck isn't read ahead
+    file.AdviseSequential(false);
+    pos = released = file.begin();
+    if (read_nodes) {
+      nid = MakeNDArray<int, 1>({rows});
+      coord = MakeNDArray<double, 2>({rows, 3});
+      tc = MakeNDArray<int, 1>({rows});
+      rc = MakeNDArray<int, 1>({rows});
+    } else {
+      eid = MakeNDArray<int, 1>({rows});
+      pid = MakeNDArray<int, 1>({rows});
+      node_ids = MakeNDArray<int, 1>({rows * MAX_ELEMENT_NODES});
+    }
+  }
 
-  // Open the file with read and write permissions
-  FILE *fp = fopen(filename, "rb+");
-  if (!fp) {
-    throw std::runtime_error("Cannot open file for reading and writing.");
+  // Parse the next chunk of cards into the arrays and return the number of
+  // cards. A chunk holds the cards of a single section. Returns 0 once
+  // every section has been read.
+  int Next() {
+    nb::gil_scoped_release release;
+    int n = 0;
+    while (n == 0) {
+      if (!in_section && !NextSection()) {
+        ReleaseRead(true);
+        return 0;
+      }
+      switch (format) {
+      case CardFormat::I10:
+        n = ReadCards<I10Cards>();
+        break;
+      case CardFormat::Long:
+        n = ReadCards<LongCards>();
+        break;
+      default:
+        n = ReadCards<StandardCards>();
+        break;
+      }
+    }
+    ReleaseRead(true);
+    return n;
+  }
+};
+
+// Check the arrays of a node section built from Python
+static void CheckNodeArrays(const NDArray<int, 1> &nid,
+                            const NDArray<double, 2> &coord,
+                            const NDArray<int, 1> &tc,
+                            const NDArray<int, 1> &rc) {
+  size_t n_nodes = nid.shape(0);
+  if (coord.shape(0) != n_nodes || coord.shape(1) != 3) {
+    throw std::invalid_argument("Expected coordinates of shape (" +
+                                std::to_string(n_nodes) + ", 3)");
+  }
+  if (tc.shape(0) != n_nodes || rc.shape(0) != n_nodes) {
+    throw std::invalid_argument("Expected tc and rc of length " +
+                                std::to_string(n_nodes));
   }
+}
 
-  // Seek to the start position of the node section
-  if (fseek(fp, fpos, SEEK_SET) != 0) {
-    fclose(fp);
-    throw std::runtime_error(
-        "Cannot seek to the start position of the node section.");
+// Check the arrays of an element section built from Python
+static void CheckElementArrays(const NDArray<int, 1> &eid,
+                               const NDArray<int, 1> &pid,
+                               const NDArray<int, 1> &node_ids,
+                               const NDArray<int, 1> &node_id_offsets) {
+  size_t n_elem = eid.shape(0);
+  if (pid.shape(0) != n_elem) {
+    throw std::invalid_argument("Expected pid of length " +
+                                std::to_string(n_elem));
+  }
+  if (node_id_offsets.shape(0) != n_elem + 1) {
+    throw std::invalid_argument("Expected node_id_offsets of length " +
+                                std::to_string(n_elem + 1));
   }
 
-  int node_idx = 0;
-  off_t line_start_pos;
-  char line[256];
+  const int *offsets = node_id_offsets.data();
+  if (offsets[0] != 0 ||
+      offsets[n_elem] != static_cast<int64_t>(node_ids.shape(0))) {
+    throw std::invalid_argument("node_id_offsets must begin at 0 and end at "
+                                "the length of node_ids");
+  }
+  for (size_t i = 0; i < n_elem; i++) {
+    if (offsets[i + 1] < offsets[i]) {
+      throw std::invalid_argument("node_id_offsets must not decrease");
+    }
+  }
+}
 
-  int n_coord = coord_arr.shape(0);
-  const double *coord = coord_arr.data();
+// Build a node section from Python arrays, with zero constraints when
+// ``tc`` or ``rc`` are omitted. IDs and constraints may be read only, such
+// as those of another section.
+static void InitNodeSection(NodeSection *section, NDArray<const int, 1> nid,
+                            NDArray<double, 2> coord,
+                            std::optional<NDArray<const int, 1>> tc,
+                            std::optional<NDArray<const int, 1>> rc) {
+  NDArray<int, 1> nid_arr = ShareConstNDArray(nid);
+  int n_nodes = static_cast<int>(nid.shape(0));
+  NDArray<int, 1> tc_arr =
+      tc ? ShareConstNDArray(*tc) : MakeNDArray<int, 1>({n_nodes}, true);
+  NDArray<int, 1> rc_arr =
+      rc ? ShareConstNDArray(*rc) : MakeNDArray<int, 1>({n_nodes}, true);
+  CheckNodeArrays(nid_arr, coord, tc_arr, rc_arr);
+  new (section) NodeSection(nid_arr, coord, tc_arr, rc_arr, 0);
+}
 
-  // Prepare buffers for formatted coordinates
-  char coord_str[17] = {0};
+// Build a shell or solid element section from Python arrays. IDs and
+// offsets may be read only, such as those of another section.
+template <typename T>
+static void InitElementSection(T *section, NDArray<const int, 1> eid,
+                               NDArray<int, 1> pid, NDArray<int, 1> node_ids,
+                               NDArray<const int, 1> node_id_offsets) {
+  NDArray<int, 1> eid_arr = ShareConstNDArray(eid);
+  NDArray<int, 1> offsets_arr = ShareConstNDArray(node_id_offsets);
+  CheckElementArrays(eid_arr, pid, node_ids, offsets_arr);
+  new (section) T(eid_arr, pid, node_ids, offsets_arr);
+}
 
-  while (fgets(line, sizeof(line), fp)) {
-    // Record the position of the beginning of the line
-    int line_end_pos = ftell(fp);
-    line_start_pos = line_end_pos - strlen(line);
+// Write a new deck of the given sections to ``filename``: *KEYWORD, the
+// node sections, the shell, solid and thick shell element sections, and
+// *END. Cards are formatted in blocks, in parallel unless ``num_threads`` is
+// 1, and the blocks are written in order. Cards are in long format when
+// ``long_format`` is set and standard fixed width format otherwise.
+void WriteDeck(const std::string &filename,
+               const std::vector<NodeSection> &node_secs,
+               const std::vector<ElementShellSection> &shell_secs,
+               const std::vector<ElementSolidSection> &solid_secs,
+               const std::vector<ElementSolidSection> &tshell_secs,
+               bool long_format, int num_threads) {
+  CardFormat format = long_format ? CardFormat::Long : CardFormat::Standard;
+
+  // every block formats its text into a buffer of its own
+  std::vector<std::function<void(std::string &)>> blocks;
+  auto add_text = [&](std::string text) {
+    blocks.push_back([text](std::string &out) { out = text; });
+  };
+  auto add_elements = [&](const char *keyword, const ElementSection &section,
+                          int num_nodes) {
+    if (!section.n_elem) {
+      return;
+    }
+    add_text(keyword);
+    for (int begin = 0; begin < section.n_elem;
+         begin += WRITE_ROWS_PER_BLOCK) {
+      int end = std::min(section.n_elem, begin + WRITE_ROWS_PER_BLOCK);
+      blocks.push_back([&section, num_nodes, begin, end,
+                        format](std::string &out) {
+        FormatElementCards(section, num_nodes, begin, end, format, out);
+      });
+    }
+  };
 
-    // Skip comment lines
-    if (line[0] == '$') {
+  add_text(long_format ? "*KEYWORD LONG=Y\n" : "*KEYWORD\n");
+  for (const NodeSection &section : node_secs) {
+    if (!section.n_nodes) {
       continue;
     }
-
-    // Check for end of node section
-    if (line[0] == '*') {
-      break;
+    add_text("*NODE\n");
+    for (int begin = 0; begin < section.n_nodes;
+         begin += WRITE_ROWS_PER_BLOCK) {
+      int end = std::min(section.n_nodes, begin + WRITE_ROWS_PER_BLOCK);
+      blocks.push_back([&section, begin, end, format](std::string &out) {
+        FormatNodeCards(section, begin, end, format, out);
+      });
     }
+  }
+  for (const ElementShellSection &section : shell_secs) {
+    add_elements("*ELEMENT_SHELL\n", section, 4);
+  }
+  for (const ElementSolidSection &section : solid_secs) {
+    add_elements("*ELEMENT_SOLID\n", section, 8);
+  }
+  for (const ElementSolidSection &section : tshell_secs) {
+    add_elements("*ELEMENT_TSHELL\n", section, 8);
+  }
+  add_text("*END\n");
 
-    // Check if we have more nodes to process
-    if (node_idx >= n_coord) {
-      break;
-    }
+  std::unique_ptr<FILE, int (*)(FILE *)> fp(fopen(filename.c_str(), "wb"),
+                                            fclose);
+  if (!fp) {
+    throw std::runtime_error("Error creating file " + filename);
+  }
 
-    // Ensure the line is long enough
-    size_t line_length = strlen(line);
-    if (line_length < 56) {
-      throw std::runtime_error("Insufficient line length.");
+  // format a batch of blocks at a time, so memory is bounded by the batch
+  // rather than the deck
+  std::unique_ptr<ThreadPool> pool;
+  size_t batch_size = 1;
+  if (num_threads != 1) {
+    pool.reset(new ThreadPool(ResolveNumThreads(num_threads)));
+    batch_size = pool->Size() * CHUNKS_PER_THREAD;
+  }
+  std::vector<std::string> buffers(batch_size);
+  for (size_t first = 0; first < blocks.size(); first += batch_size) {
+    size_t n = std::min(batch_size, blocks.size() - first);
+    auto format_block = [&](size_t i) { blocks[first + i](buffers[i]); };
+    if (pool && n > 1) {
+      ParallelFor(*pool, n, format_block);
+    } else {
+      for (size_t i = 0; i < n; i++) {
+        format_block(i);
+      }
     }
 
-    // Format the coordinates
-    for (int ii = 0; ii < 3; ii++) {
-      // Generate the formatted string
-      FormatWithExp(coord_str, 17, coord[node_idx * 3 + ii], 16, 9, 2);
-      memcpy(&line[8 + ii * 16], coord_str, 16); // coordinate field
+    for (size_t i = 0; i < n; i++) {
+      const std::string &buffer = buffers[i];
+      if (fwrite(buffer.data(), 1, buffer.size(), fp.get()) != buffer.size()) {
+        throw std::runtime_error("Error writing file " + filename);
+      }
     }
+  }
 
-    // Seek back to the beginning of the line and write the updated line
-    fseek(fp, line_start_pos, SEEK_SET);
-    fwrite(line, 1, line_length, fp);
-#if defined(_WIN32) || defined(_WIN64)
-    fseek(fp, line_end_pos, SEEK_SET);
-#endif
+  if (fclose(fp.release()) != 0) {
+    throw std::runtime_error("Error writing file " + filename);
+  }
+}
 
-    // Move to the next node
-    node_idx++;
+// Overwrite the coordinates of the standard *NODE cards at byte ``fpos`` of
+// ``filename`` in place, up to the end of the section or of ``coord_arr``
+void OverwriteNodeSection(const char *filename, int fpos,
+                          const NDArray<const double, 2> coord_arr) {
+  MemoryMappedFile file(filename, MapMode::Write);
+  if (fpos < 0 || fpos > file.end() - file.begin()) {
+    throw std::out_of_range("Node section position out of range");
   }
 
-  fclose(fp);
+  char *begin = file.begin() + fpos;
+  char *end = file.begin() + (FindSectionEnd(begin, file.end()) - file.begin());
+  size_t n_rows = std::min(static_cast<size_t>(coord_arr.shape(0)),
+                           CountCardLines(begin, end));
+  WriteNodeCards(CardFormat::Standard, begin, end, coord_arr.data(), n_rows);
 }
 
 NB_MODULE(_deck, m) {
+  nb::class_<Keyword>(m, "Keyword")
+      .def("__repr__", &Keyword::ToString)
+      .def_ro("name", &Keyword::name)
+      .def_ro("offset", &Keyword::offset)
+      .def_ro("length", &Keyword::length)
+      .def_ro("line", &Keyword::line)
+      .def_ro("filename", &Keyword::filename);
+
   nb::class_<NodeSection>(m, "NodeSection")
       .def(nb::init())
+      .def("__init__", &InitNodeSection, "nid"_a, "coordinates"_a,
+           "tc"_a = nb::none(), "rc"_a = nb::none())
       .def("__repr__", &NodeSection::ToString)
       .def("__len__", &NodeSection::Length)
-      .def_ro("coordinates", &NodeSection::coord, nb::rv_policy::automatic)
-      .def_ro("nid", &NodeSection::nid, nb::rv_policy::automatic)
-      .def_ro("tc", &NodeSection::tc, nb::rv_policy::automatic)
-      .def_ro("rc", &NodeSection::rc, nb::rv_policy::automatic)
-      .def_ro("fpos", &NodeSection::fpos);
+      .def_prop_ro("coordinates", &NodeSection::Coordinates)
+      .def_prop_ro("nid", &NodeSection::NidArray)
+      .def_prop_ro("tc", &NodeSection::TcArray)
+      .def_prop_ro("rc", &NodeSection::RcArray)
+      .def_ro("fpos", &NodeSection::fpos)
+      .def_ro("filename", &NodeSection::filename);
 
   nb::class_<ElementSolidSection>(m, "ElementSolidSection")
       .def(nb::init())
+      .def("__init__", &InitElementSection<ElementSolidSection>, "eid"_a,
+           "pid"_a, "node_ids"_a, "node_id_offsets"_a)
       .def("__repr__", &ElementSolidSection::ToString)
       .def("__len__", &ElementSolidSection::Length)
       .def("to_vtk", &ElementSolidSection::ToVTK)
-      .def_ro("eid", &ElementSolidSection::eid, nb::rv_policy::automatic)
+      .def_prop_ro("eid", &ElementSolidSection::EidArray)
       .def_ro("pid", &ElementSolidSection::pid, nb::rv_policy::automatic)
       .def_ro("node_ids", &ElementSolidSection::node_ids,
               nb::rv_policy::automatic)
-      .def_ro("node_id_offsets", &ElementSolidSection::node_id_offsets,
-              nb::rv_policy::automatic);
+      .def_prop_ro("node_id_offsets", &ElementSolidSection::NodeIdOffsetsArray)
+      .def_ro("fpos", &ElementSolidSection::fpos)
+      .def_ro("filename", &ElementSolidSection::filename);
 
   nb::class_<ElementShellSection>(m, "ElementShellSection")
       .def(nb::init())
+      .def("__init__", &InitElementSection<ElementShellSection>, "eid"_a,
+           "pid"_a, "node_ids"_a, "node_id_offsets"_a)
       .def("__repr__", &ElementShellSection::ToString)
       .def("__len__", &ElementShellSection::Length)
       .def("to_vtk", &ElementShellSection::ToVTK)
-      .def_ro("eid", &ElementShellSection::eid, nb::rv_policy::automatic)
+      .def_prop_ro("eid", &ElementShellSection::EidArray)
       .def_ro("pid", &ElementShellSection::pid, nb::rv_policy::automatic)
       .def_ro("node_ids", &ElementShellSection::node_ids,
               nb::rv_policy::automatic)
-      .def_ro("node_id_offsets", &ElementShellSection::node_id_offsets,
-              nb::rv_policy::automatic);
+      .def_prop_ro("node_id_offsets", &ElementShellSection::NodeIdOffsetsArray)
+      .def_ro("fpos", &ElementShellSection::fpos)
+      .def_ro("filename", &ElementShellSection::filename);
 
   nb::class_<Deck>(m, "_Deck")
-      .def(nb::init<const std::string &>(), "fname"_a, "A LS-DYNA deck.")
+      .def(nb::init<const std::string &, int, const std::string &, size_t>(),
+           "fname"_a, "num_threads"_a = 1, "io_backend"_a = "mmap",
+           "block_size"_a = READ_BLOCK_BYTES, "A LS-DYNA deck.")
+      .def(nb::init<const NDArray<const uint8_t, 1> &, const std::string &,
+                    int>(),
+           "buffer"_a, "name"_a, "num_threads"_a = 1)
+      .def_static(
+          "streamed",
+          [](const std::string &name, int num_threads, size_t size_hint,
+             nb::object start) -> Deck * {
+            if (start.is_none()) {
+              return new Deck(name, num_threads, new StreamedRange(size_hint));
+            }
+            return new Deck(name, num_threads,
+                            new DecompressedRange(size_hint, start));
+          },
+          "name"_a, "num_threads"_a = 1, "size_hint"_a = 0,
+          "start"_a = nb::none())
+      .def_prop_rw("num_threads", &Deck::GetNumThreads, &Deck::SetNumThreads)
+      .def_prop_rw("single_precision", &Deck::GetSinglePrecision,
+                   &Deck::SetSinglePrecision)
+      .def_prop_rw("release_blocks", &Deck::GetReleaseBlocks,
+                   &Deck::SetReleaseBlocks)
+      .def_ro("keywords", &Deck::keywords)
+      .def_ro("node_keywords", &Deck::node_keywords)
+      .def_ro("element_solid_keywords", &Deck::element_solid_keywords)
+      .def_ro("element_shell_keywords", &Deck::element_shell_keywords)
       .def_ro("node_sections", &Deck::node_sections)
       .def_ro("element_solid_sections", &Deck::element_solid_sections)
       .def_ro("element_shell_sections", &Deck::element_shell_sections)
+      .def_ro("missing_includes", &Deck::missing_includes)
+      .def_prop_ro("filenames", &Deck::Filenames)
+      .def_prop_ro("progress", &Deck::Progress)
+      .def_prop_ro("cancelled", &Deck::IsCancelled)
+      .def("cancel", &Deck::Cancel)
+      .def("set_read_filter", &Deck::SetReadFilter, "shells"_a, "solids"_a,
+           "tshells"_a, "part_ids"_a = nb::none(), "exclude"_a = false)
       .def("read", &Deck::Read)
+      .def("write_stream", &Deck::WriteStream, "block"_a)
+      .def("close_stream", &Deck::CloseStream, "error"_a = "")
+      .def("abort_stream", &Deck::AbortStream)
+      .def("index_keywords", &Deck::IndexKeywords,
+           nb::call_guard<nb::gil_scoped_release>())
+      .def("write_cache", &Deck::WriteCache, "path"_a)
+      .def("load_cache", &Deck::LoadCache, "path"_a)
+      .def("load_node_section", &Deck::LoadNodeSection, "index"_a)
+      .def("load_element_solid_section", &Deck::LoadElementSolidSection,
+           "index"_a)
+      .def("load_element_shell_section", &Deck::LoadElementShellSection,
+           "index"_a)
       .def("read_line", &Deck::ReadLine)
       .def("read_element_solid_section", &Deck::ReadElementSolidSection)
       .def("read_element_shell_section", &Deck::ReadElementShellSection)
-      .def("read_node_section", &Deck::ReadNodeSection);
-
-  m.def("overwrite_node_section", &OverwriteNodeSection);
+      .def("read_node_section", &Deck::ReadNodeSection)
+      .def("to_vtk", &Deck::ToVTK, "node_sections"_a, "shell_sections"_a,
+           "solid_sections"_a, "wide"_a = false)
+      .def("index_node_ids", &Deck::IndexNodeIds, "node_sections"_a)
+      .def("index_element_ids", &Deck::IndexElementIds, "shell_sections"_a,
+           "solid_sections"_a)
+      .def("node_index", &Deck::NodeIndex, "ids"_a)
+      .def("element_index", &Deck::ElementIndex, "ids"_a)
+      .def("extract_parts", &Deck::ExtractParts, "node_sections"_a,
+           "shell_sections"_a, "solid_sections"_a, "part_ids"_a,
+           "renumber"_a = false)
+      .def("overwrite_node_sections", &Deck::OverwriteNodeSections,
+           "filename"_a, "sections"_a, "nodes"_a)
+      .def("write_node_variants", &Deck::WriteNodeVariants, "filenames"_a,
+           "nodes"_a);
+
+  nb::class_<DeckLoader>(m, "_DeckLoader")
+      .def(nb::init<const std::vector<Deck *> &, int>(), "decks"_a,
+           "num_threads"_a = 0, nb::keep_alive<1, 2>())
+      .def("__iter__", [](nb::object self) { return self; })
+      .def("__next__", &DeckLoader::Next);
+
+  nb::class_<SectionReader>(m, "_SectionReader")
+      .def(nb::init<const std::string &, bool, int, bool, bool, bool>(),
+           "filename"_a, "nodes"_a, "chunk_rows"_a, "shells"_a = true,
+           "solids"_a = true, "tshells"_a = true)
+      .def("next", &SectionReader::Next)
+      .def_ro("section", &SectionReader::section)
+      .def_ro("keyword", &SectionReader::keyword)
+      .def_ro("num_nodes", &SectionReader::num_nodes)
+      .def_ro("nid", &SectionReader::nid)
+      .def_ro("coordinates", &SectionReader::coord)
+      .def_ro("tc", &SectionReader::tc)
+      .def_ro("rc", &SectionReader::rc)
+      .def_ro("eid", &SectionReader::eid)
+      .def_ro("pid", &SectionReader::pid)
+      .def_ro("node_ids", &SectionReader::node_ids);
+
+  m.def("overwrite_node_section", &OverwriteNodeSection,
+        nb::call_guard<nb::gil_scoped_release>());
+  m.def("write_deck", &WriteDeck, "filename"_a, "node_sections"_a,
+        "shell_sections"_a, "solid_sections"_a, "tshell_sections"_a,
+        "long_format"_a = false, "num_threads"_a = 1,
+        nb::call_guard<nb::gil_scoped_release>());
 }
@@ -0,0 +1,261 @@
+#ifndef DECK_CACHE_HEADER_H
+#define DECK_CACHE_HEADER_H
+
+// Binary cache of the sections parsed from a deck.
+//
+// The cache is keyed by the size, modification time, and a hash of the
+// contents of the deck and of every file it includes, and is only used when
+// all three match for every file. Its layout is:
+//
+//   CacheHeader
+//   CacheSource[n_sources], the deck first
+//   CacheKeyword[n_keywords]
+//   the file and keyword names, concatenated
+//   CacheSection[n_sections]
+//   the section arrays, each aligned to CACHE_ALIGNMENT bytes
+//
+// Arrays are stored in native byte order so they can be memory mapped and
+// used in place. A cache written on a machine of a different byte order fails
+// the header check and is rewritten.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32) || defined(_WIN64)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <process.h>
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define CACHE_MAGIC "LSDMRCHE"
+#define CACHE_VERSION 2
+#define CACHE_BYTE_ORDER 0x01020304u
+
+// Alignment of each array within the cache
+#define CACHE_ALIGNMENT 64
+
+// Bytes hashed per block. Blocks are hashed independently so large decks can
+// be hashed in parallel, and the block hashes are then hashed together.
+#define CACHE_HASH_BLOCK (1 << 22)
+
+// Arrays of each section: nid, coordinates, tc, rc for node sections and eid,
+// pid, node_ids, node_id_offsets for element sections
+#define CACHE_SECTION_ARRAYS 4
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t n_sources;
+  uint64_t n_keywords;
+  uint64_t names_size;
+  uint64_t n_sections;
+  uint64_t cache_size;
+};
+
+// A file of the deck, identified by its canonical path
+struct CacheSource {
+  uint64_t size;
+  int64_t mtime_ns;
+  uint64_t hash;
+  uint64_t name_offset; // into the concatenated names
+  uint64_t name_length;
+};
+
+struct CacheKeyword {
+  uint64_t offset;
+  uint64_t length;
+  uint64_t line;
+  uint64_t name_offset; // into the concatenated names
+  uint64_t name_length;
+  uint64_t source; // index of the file containing the keyword
+};
+
+struct CacheSection {
+  uint32_t type; // SectionType
+  int32_t fpos;
+  uint64_t keyword; // index of the section's keyword
+  uint64_t n_rows;
+  uint64_t array_offset[CACHE_SECTION_ARRAYS]; // bytes from the start
+  uint64_t array_size[CACHE_SECTION_ARRAYS];   // number of values
+};
+
+// Round ``offset`` up to the alignment of the cache arrays
+static inline uint64_t CacheAlign(uint64_t offset) {
+  const uint64_t mask = CACHE_ALIGNMENT - 1;
+  return (offset + mask) & ~mask;
+}
+
+// Size and modification time (in nanoseconds) of a file
+static inline void FileSizeAndMtime(const char *filename, uint64_t *size,
+                                    int64_t *mtime_ns) {
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA attrs;
+  if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &attrs)) {
+    throw std::runtime_error("Error getting file attributes");
+  }
+  *size = (static_cast<uint64_t>(attrs.nFileSizeHigh) << 32) |
+          attrs.nFileSizeLow;
+  // 100 ns intervals since 1601, from the Unix epoch like stat, so that
+  // they fit in nanoseconds
+  uint64_t ticks =
+      (static_cast<uint64_t>(attrs.ftLastWriteTime.dwHighDateTime) << 32) |
+      attrs.ftLastWriteTime.dwLowDateTime;
+  const int64_t unix_epoch_ticks = 116444736000000000;
+  *mtime_ns = (static_cast<int64_t>(ticks) - unix_epoch_ticks) * 100;
+#else
+  struct stat st;
+  if (stat(filename, &st) == -1) {
+    throw std::runtime_error("Error getting file size");
+  }
+  *size = st.st_size;
+#ifdef __APPLE__
+  *mtime_ns = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 +
+              st.st_mtimespec.tv_nsec;
+#else
+  *mtime_ns =
+      static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+#endif
+}
+
+// XXH64 by Yann Collet. See https://github.com/Cyan4973/xxHash
+static const uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t XXHRotl(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t XXHRead64(const char *p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint32_t XXHRead32(const char *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint64_t XXHRound(uint64_t acc, uint64_t input) {
+  acc += input * XXH_PRIME64_2;
+  acc = XXHRotl(acc, 31);
+  return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t XXHMergeRound(uint64_t acc, uint64_t value) {
+  acc ^= XXHRound(0, value);
+  return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static inline uint64_t HashBytes(const char *p, size_t len, uint64_t seed) {
+  const char *end = p + len;
+  uint64_t h;
+
+  if (len >= 32) {
+    uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+    uint64_t v2 = seed + XXH_PRIME64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - XXH_PRIME64_1;
+    const char *limit = end - 32;
+    do {
+      v1 = XXHRound(v1, XXHRead64(p));
+      v2 = XXHRound(v2, XXHRead64(p + 8));
+      v3 = XXHRound(v3, XXHRead64(p + 16));
+      v4 = XXHRound(v4, XXHRead64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    h = XXHRotl(v1, 1) + XXHRotl(v2, 7) + XXHRotl(v3, 12) + XXHRotl(v4, 18);
+    h = XXHMergeRound(h, v1);
+    h = XXHMergeRound(h, v2);
+    h = XXHMergeRound(h, v3);
+    h = XXHMergeRound(h, v4);
+  } else {
+    h = seed + XXH_PRIME64_5;
+  }
+
+  h += static_cast<uint64_t>(len);
+
+  while (p + 8 <= end) {
+    h ^= XXHRound(0, XXHRead64(p));
+    h = XXHRotl(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(XXHRead32(p)) * XXH_PRIME64_1;
+    h = XXHRotl(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= static_cast<uint64_t>(static_cast<unsigned char>(*p)) * XXH_PRIME64_5;
+    h = XXHRotl(h, 11) * XXH_PRIME64_1;
+    p++;
+  }
+
+  h ^= h >> 33;
+  h *= XXH_PRIME64_2;
+  h ^= h >> 29;
+  h *= XXH_PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+// Write ``size`` bytes or throw
+static inline void CacheWrite(FILE *fp, const void *data, size_t size) {
+  if (size && fwrite(data, 1, size, fp) != size) {
+    throw std::runtime_error("Error writing cache file");
+  }
+}
+
+// Pad the file with zeros up to ``offset``
+static inline void CachePad(FILE *fp, uint64_t position, uint64_t offset) {
+  static const char zeros[CACHE_ALIGNMENT] = {0};
+  CacheWrite(fp, zeros, offset - position);
+}
+
+// Temporary name the cache is written to before it's moved into place,
+// unique to this process and call so concurrent writers, in other processes
+// or on other threads, don't clobber each other
+static inline std::string CacheTempName(const std::string &path) {
+  static std::atomic<uint64_t> n_names{0};
+#ifdef _WIN32
+  int pid = _getpid();
+#else
+  int pid = getpid();
+#endif
+  return path + ".tmp." + std::to_string(pid) + "." +
+         std::to_string(n_names++);
+}
+
+// Atomically replace ``path`` with ``temp_path``
+static inline void CacheReplace(const std::string &temp_path,
+                                const std::string &path) {
+#ifdef _WIN32
+  bool ok = MoveFileExA(temp_path.c_str(), path.c_str(),
+                        MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  bool ok = rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+  if (!ok) {
+    remove(temp_path.c_str());
+    throw std::runtime_error("Error moving cache file into place");
+  }
+}
+
+#endif // DECK_CACHE_HEADER_H
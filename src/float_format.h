@@ -0,0 +1,171 @@
+#ifndef FLOAT_FORMAT_HEADER_H
+#define FLOAT_FORMAT_HEADER_H
+
+// Formatting of fixed width FORTRAN E format fields, e.g. "-2.309401035E+00".
+//
+// The decimal significand is rounded from a double precision product of the
+// value and a power of ten. Each product carries a bounded rounding error, so
+// the rare value whose significand lands too close to a rounding tie to be
+// decided from the product is formatted by snprintf instead. The output is
+// therefore the same as printf's "%E", without its parsing of the format,
+// its locale, or the shifting needed for a two digit exponent.
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fast_float.h"
+
+// Most significant digits of a field; larger significands aren't integers
+// held exactly by a double once scaled
+#define MAX_FORMAT_DIGITS 14
+
+// log10(2), for estimating the decimal exponent of a value from its binary
+// exponent
+#define LOG10_2 0.30102999566398119521
+
+static const uint64_t UINT_POWER_OF_TEN[] = {
+    1ull,
+    10ull,
+    100ull,
+    1000ull,
+    10000ull,
+    100000ull,
+    1000000ull,
+    10000000ull,
+    100000000ull,
+    1000000000ull,
+    10000000000ull,
+    100000000000ull,
+    1000000000000ull,
+    10000000000000ull,
+    100000000000000ull,
+    1000000000000000ull};
+
+// Round ``a`` * 10^(digits - 1 - exp10) to the nearest integer. Returns false
+// when the product is too close to a rounding tie for its rounding error to
+// be ruled out.
+static inline bool RoundScaled(double a, int exp10, int digits,
+                               uint64_t &significand) {
+  int k = digits - 1 - exp10;
+  double scaled = a;
+  int n_products = 1;
+  for (; k > 22; k -= 22, n_products++) {
+    scaled *= 1e22;
+  }
+  for (; k < -22; k += 22, n_products++) {
+    scaled /= 1e22;
+  }
+  if (k < 0) {
+    scaled /= EXACT_POWER_OF_TEN[-k];
+  } else {
+    scaled *= EXACT_POWER_OF_TEN[k];
+  }
+
+  // each product is off by at most half an ulp of its result; allow twice
+  // that per product
+  double tolerance = scaled * n_products * DBL_EPSILON;
+  double whole = floor(scaled);
+  double fraction = scaled - whole;
+  if (fabs(fraction - 0.5) <= tolerance) {
+    return false;
+  }
+  significand = static_cast<uint64_t>(whole) + (fraction > 0.5);
+  return true;
+}
+
+// Significand and exponent of ``a`` from snprintf, which rounds exactly
+static inline void PrintfSignificand(double a, int digits,
+                                     uint64_t &significand, int &exp10) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*E", digits - 1, a);
+  const char *p = buffer;
+  significand = 0;
+  for (; *p != 'E'; p++) {
+    // skip the decimal point, whatever the locale
+    if (IsDigit(*p)) {
+      significand = significand * 10 + (*p - '0');
+    }
+  }
+  exp10 = atoi(p + 1);
+}
+
+// Round the positive, finite ``a`` to ``digits`` significant digits, giving
+// the significand as an integer of exactly ``digits`` digits and the decimal
+// exponent of its first digit
+static inline void DecimalSignificand(double a, int digits,
+                                      uint64_t &significand, int &exp10) {
+  if (a == 0) {
+    significand = 0;
+    exp10 = 0;
+    return;
+  }
+
+  // the estimate is the exponent of the value or one less
+  int exp2;
+  frexp(a, &exp2);
+  exp10 = static_cast<int>(floor((exp2 - 1) * LOG10_2));
+  if (RoundScaled(a, exp10, digits, significand)) {
+    if (significand < UINT_POWER_OF_TEN[digits]) {
+      return;
+    }
+    exp10++;
+    if (RoundScaled(a, exp10, digits, significand)) {
+      // rounded up to the next power of ten
+      if (significand == UINT_POWER_OF_TEN[digits]) {
+        significand /= 10;
+        exp10++;
+      }
+      return;
+    }
+  }
+  PrintfSignificand(a, digits, significand, exp10);
+}
+
+// Write ``value`` in exactly ``width`` characters at ``dst``, in E format with
+// a two digit exponent and as many significant digits as fit, e.g.
+// " 1.234567890E+00" for a width of 16 or " 1.2345678901235E+00" for 20.
+// Exponents of three digits take the place of the last significant digit, as
+// in " 1.00000000E+100". No terminating null is written.
+//
+// ``value`` must be finite and ``width`` at most MAX_FORMAT_DIGITS + 6.
+static inline void FormatExpField(char *dst, double value, int width) {
+  int digits = width - 6;
+  uint64_t significand;
+  int exp10;
+  DecimalSignificand(fabs(value), digits, significand, exp10);
+  if (exp10 <= -100 || exp10 >= 100) {
+    digits--;
+    DecimalSignificand(fabs(value), digits, significand, exp10);
+    // a value just under 1E-99 can round up to it
+    if (exp10 > -100 && exp10 < 100) {
+      digits++;
+      significand *= 10;
+    }
+  }
+
+  char *p = dst;
+  *p++ = signbit(value) ? '-' : ' ';
+  for (int i = digits - 1; i > 0; i--) {
+    p[i + 1] = static_cast<char>('0' + significand % 10);
+    significand /= 10;
+  }
+  p[0] = static_cast<char>('0' + significand);
+  p[1] = '.';
+  p += digits + 1;
+
+  *p++ = 'E';
+  *p++ = exp10 < 0 ? '-' : '+';
+  int exponent = exp10 < 0 ? -exp10 : exp10;
+  if (exponent >= 100) {
+    *p++ = static_cast<char>('0' + exponent / 100);
+    exponent %= 100;
+  }
+  *p++ = static_cast<char>('0' + exponent / 10);
+  *p = static_cast<char>('0' + exponent % 10);
+}
+
+#endif // FLOAT_FORMAT_HEADER_H
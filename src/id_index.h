@@ -0,0 +1,170 @@
+#ifndef ID_INDEX_HEADER_H
+#define ID_INDEX_HEADER_H
+
+// Index from node or element IDs to their position across the sections of a
+// deck.
+//
+// IDs are numbered consecutively across their blocks (one block per section),
+// so the value of an ID is its position in the concatenated sections. Decks
+// whose IDs are mostly contiguous get a dense table indexed by ID. Sparse
+// ones, such as decks that prefix IDs with a part number, get an open
+// addressing hash table instead, so memory stays proportional to the number
+// of IDs rather than to the largest one.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// A dense table is used when it has at most this many slots per ID
+#define ID_INDEX_MAX_DENSE_RATIO 2
+
+// The ID that marks an empty slot of the hash table, and so can't be indexed
+#define ID_INDEX_EMPTY INT32_MIN
+
+// IDs of one block: ``n`` IDs at ``ids``, or the IDs numbered consecutively
+// from ``first`` when ``ids`` is null
+struct IdBlock {
+  const int *ids;
+  size_t n;
+  int first = 0;
+
+  int operator[](size_t i) const {
+    return ids ? ids[i] : first + static_cast<int>(i);
+  }
+};
+
+class IdIndex {
+private:
+  struct Entry {
+    int32_t id;
+    int32_t value;
+  };
+
+  bool dense = true;
+
+  // dense table of the value of each ID from ``min_id``
+  int64_t min_id = 0;
+  std::vector<int32_t> table;
+
+  // open addressing hash table with linear probing, at most half full
+  std::vector<Entry> entries;
+  int hash_shift = 63;
+
+  // first value of each block followed by the number of IDs
+  std::vector<int64_t> block_start;
+
+  // Fibonacci hashing, which spreads the consecutive runs of IDs found in
+  // most decks across the table
+  size_t Slot(int id) const {
+    uint64_t key = static_cast<uint32_t>(id);
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> hash_shift);
+  }
+
+  void Insert(int id, int32_t value) {
+    size_t mask = entries.size() - 1;
+    size_t slot = Slot(id);
+    while (entries[slot].id != ID_INDEX_EMPTY && entries[slot].id != id) {
+      slot = (slot + 1) & mask;
+    }
+    entries[slot] = {id, value};
+  }
+
+public:
+  IdIndex() { block_start.push_back(0); }
+
+  // Index the IDs of each block. An ID that repeats keeps its last position.
+  explicit IdIndex(const std::vector<IdBlock> &blocks) {
+    size_t n_ids = 0;
+    int min = INT32_MAX;
+    int max = INT32_MIN;
+    block_start.push_back(0);
+    for (const IdBlock &block : blocks) {
+      if (!block.ids && block.n) {
+        min = std::min(min, block.first);
+        max = std::max(max, block[block.n - 1]);
+      }
+      for (size_t i = 0; block.ids && i < block.n; i++) {
+        min = std::min(min, block.ids[i]);
+        max = std::max(max, block.ids[i]);
+      }
+      n_ids += block.n;
+      block_start.push_back(static_cast<int64_t>(n_ids));
+    }
+    if (n_ids > static_cast<size_t>(INT32_MAX)) {
+      throw std::length_error("Too many IDs to index");
+    }
+
+    min_id = min;
+    size_t range = n_ids ? static_cast<size_t>(int64_t(max) - min) + 1 : 0;
+    dense = range <= ID_INDEX_MAX_DENSE_RATIO * n_ids;
+
+    int32_t value = 0;
+    if (dense) {
+      table.assign(range, -1);
+      for (const IdBlock &block : blocks) {
+        for (size_t i = 0; i < block.n; i++) {
+          table[block[i] - min_id] = value++;
+        }
+      }
+      return;
+    }
+
+    size_t capacity = 2;
+    while (capacity < 2 * n_ids) {
+      capacity *= 2;
+      hash_shift--;
+    }
+    entries.assign(capacity, {ID_INDEX_EMPTY, -1});
+    for (const IdBlock &block : blocks) {
+      for (size_t i = 0; i < block.n; i++) {
+        Insert(block[i], value++);
+      }
+    }
+  }
+
+  // Position of ``id``, or -1 when it isn't indexed
+  int64_t Find(int id) const {
+    if (dense) {
+      // in 64 bits, as the distance between 32 bit IDs can overflow them
+      uint64_t slot = static_cast<uint64_t>(int64_t(id) - min_id);
+      return slot < table.size() ? table[slot] : -1;
+    }
+
+    size_t mask = entries.size() - 1;
+    for (size_t slot = Slot(id);; slot = (slot + 1) & mask) {
+      const Entry &entry = entries[slot];
+      if (entry.id == id) {
+        return entry.value;
+      } else if (entry.id == ID_INDEX_EMPTY) {
+        return -1;
+      }
+    }
+  }
+
+  // Find each of ``n`` IDs
+  void FindMany(const int *ids, size_t n, int64_t *out) const {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = Find(ids[i]);
+    }
+  }
+
+  // Block containing ``position`` and the position within it
+  std::pair<int, int> Locate(int64_t position) const {
+    size_t block =
+        std::upper_bound(block_start.begin(), block_start.end(), position) -
+        block_start.begin() - 1;
+    return {static_cast<int>(block),
+            static_cast<int>(position - block_start[block])};
+  }
+
+  // Number of indexed positions
+  size_t Size() const { return static_cast<size_t>(block_start.back()); }
+
+  bool IsDense() const { return dense; }
+};
+
+#endif // ID_INDEX_HEADER_H
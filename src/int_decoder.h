@@ -0,0 +1,308 @@
+#ifndef INT_DECODER_HEADER_H
+#define INT_DECODER_HEADER_H
+
+// Decoder for cards of fixed width integer fields, such as the element cards
+// of *ELEMENT_SOLID and *ELEMENT_SHELL. Standard cards have 8 character
+// fields, which have SIMD kernels.
+//
+// Fields may be blank, padded with leading spaces, and negative. Any other
+// field (left justified, containing tabs, the end of the line, etc.) is
+// handled by the scalar decoder, which ignores everything but digits and a
+// minus sign. A card ends at the end of its line, and the fields past the
+// end of the line are zero.
+//
+// The SSE4.1 and AVX2 kernels are compiled with target attributes and chosen
+// at runtime, so the module still loads on CPUs without them.
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define INT_DECODER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define INT_DECODER_TARGET(x)
+#else
+#define INT_DECODER_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+// Width of each integer field
+#define I8_WIDTH 8
+
+enum class IntDecoderKernel { Scalar, SSE41, AVX2 };
+
+// Fast ASCII string to integer. Reads ``intsz`` characters, ignoring
+// everything but the digits and a minus sign.
+static inline int fast_atoi(const char *raw, const int intsz) {
+  int val = 0;
+  bool negative = false;
+  int c;
+  char current_char;
+
+  for (c = 0; c < intsz; ++c) {
+    current_char = *raw++;
+
+    // Multiply by 10 only if current_char is a digit
+    if (current_char >= '0' && current_char <= '9') {
+      val = val * 10 + (current_char - '0');
+    } else if (current_char == '-') {
+      negative = true;
+    }
+  }
+
+  return negative ? -val : val;
+}
+
+// Decode ``n_fields`` fields of ``Width`` characters with fast_atoi. Reading
+// stops at the end of the line or at ``end``, whichever comes first.
+template <int Width>
+static inline void DecodeIntCardScalar(const char *p, const char *end,
+                                       int n_fields, int *out) {
+  size_t avail = end - p;
+  if (avail > static_cast<size_t>(n_fields) * Width) {
+    avail = n_fields * Width;
+  }
+
+  const char *line_end =
+      static_cast<const char *>(memchr(p, '\n', avail));
+  if (!line_end) {
+    line_end = p + avail;
+  } else if (line_end > p && line_end[-1] == '\r') {
+    line_end--;
+  }
+
+  int n_full = static_cast<int>((line_end - p) / Width);
+  for (int i = 0; i < n_full; i++) {
+    out[i] = fast_atoi(p + i * Width, Width);
+  }
+
+  // a field cut short by the end of the line, then the missing fields
+  if (n_full < n_fields) {
+    const char *last = p + n_full * Width;
+    out[n_full] = fast_atoi(last, static_cast<int>(line_end - last));
+    for (int i = n_full + 1; i < n_fields; i++) {
+      out[i] = 0;
+    }
+  }
+}
+
+static inline void DecodeI8CardScalar(const char *p, const char *end,
+                                      int n_fields, int *out) {
+  DecodeIntCardScalar<I8_WIDTH>(p, end, n_fields, out);
+}
+
+#ifdef INT_DECODER_X86
+
+// Check the digit, space, and minus sign masks of ``n_fields`` fields and
+// apply the signs to ``out``. Each field must be right justified digits,
+// optionally preceded by a minus sign, padded with spaces.
+static inline bool FinishI8Fields(uint32_t digit_mask, uint32_t space_mask,
+                                  uint32_t minus_mask, int n_fields,
+                                  int *out) {
+  uint32_t all_mask = n_fields == 4 ? 0xFFFFFFFFu : 0xFFFFu;
+  if ((digit_mask | space_mask | minus_mask) != all_mask) {
+    return false;
+  }
+
+  // Within a field, every digit but the last character and every minus sign
+  // must be followed by a digit.
+  uint32_t not_last = 0x7F7F7F7Fu & all_mask;
+  uint32_t followed_by_digit = (digit_mask >> 1) & not_last;
+  if (((digit_mask & not_last) | minus_mask) & ~followed_by_digit) {
+    return false;
+  }
+
+  if (minus_mask) {
+    for (int i = 0; i < n_fields; i++) {
+      if ((minus_mask >> (I8_WIDTH * i)) & 0xFF) {
+        out[i] = -out[i];
+      }
+    }
+  }
+  return true;
+}
+
+// Decode two fields (16 characters). Returns false when either field needs
+// the scalar decoder.
+INT_DECODER_TARGET("sse4.1")
+static inline bool DecodeI8x2SSE41(const char *p, int *out) {
+  __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  __m128i values = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+  __m128i is_digit =
+      _mm_cmpeq_epi8(_mm_min_epu8(values, _mm_set1_epi8(9)), values);
+  __m128i is_space = _mm_cmpeq_epi8(chars, _mm_set1_epi8(' '));
+  __m128i is_minus = _mm_cmpeq_epi8(chars, _mm_set1_epi8('-'));
+
+  // zero everything but the digits, then combine them in pairs, fours, and
+  // eights. Blanks before the digits act as leading zeros.
+  values = _mm_and_si128(values, is_digit);
+  __m128i pairs = _mm_maddubs_epi16(
+      values, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1,
+                            10, 1));
+  __m128i fours =
+      _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+  fours = _mm_packus_epi32(fours, fours);
+  __m128i eights = _mm_madd_epi16(
+      fours, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(out), eights);
+
+  return FinishI8Fields(_mm_movemask_epi8(is_digit),
+                        _mm_movemask_epi8(is_space),
+                        _mm_movemask_epi8(is_minus), 2, out);
+}
+
+// Decode four fields (32 characters). Returns false when any field needs the
+// scalar decoder.
+INT_DECODER_TARGET("avx2")
+static inline bool DecodeI8x4AVX2(const char *p, int *out) {
+  __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  __m256i values = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+  __m256i is_digit =
+      _mm256_cmpeq_epi8(_mm256_min_epu8(values, _mm256_set1_epi8(9)), values);
+  __m256i is_space = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' '));
+  __m256i is_minus = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('-'));
+
+  values = _mm256_and_si256(values, is_digit);
+  __m256i pairs = _mm256_maddubs_epi16(
+      values,
+      _mm256_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1,
+                       10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+  __m256i fours = _mm256_madd_epi16(
+      pairs, _mm256_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1, 100, 1, 100, 1,
+                               100, 1, 100, 1));
+  fours = _mm256_packus_epi32(fours, fours);
+  __m256i eights = _mm256_madd_epi16(
+      fours, _mm256_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1, 10000,
+                               1, 10000, 1, 10000, 1, 10000, 1));
+
+  // each 128 bit lane holds its two fields in the low 64 bits
+  eights = _mm256_permute4x64_epi64(eights, 0x08);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                   _mm256_castsi256_si128(eights));
+
+  return FinishI8Fields(_mm256_movemask_epi8(is_digit),
+                        _mm256_movemask_epi8(is_space),
+                        _mm256_movemask_epi8(is_minus), 4, out);
+}
+
+INT_DECODER_TARGET("sse4.1")
+static void DecodeI8CardSSE41(const char *p, const char *end, int n_fields,
+                              int *out) {
+  int i = 0;
+  while (i + 2 <= n_fields && end - p >= 16 && DecodeI8x2SSE41(p, out + i)) {
+    p += 2 * I8_WIDTH;
+    i += 2;
+  }
+  DecodeI8CardScalar(p, end, n_fields - i, out + i);
+}
+
+INT_DECODER_TARGET("avx2")
+static void DecodeI8CardAVX2(const char *p, const char *end, int n_fields,
+                             int *out) {
+  int i = 0;
+  while (i + 4 <= n_fields && end - p >= 32 && DecodeI8x4AVX2(p, out + i)) {
+    p += 4 * I8_WIDTH;
+    i += 4;
+  }
+  // the AVX2 kernel stops at the first field it can't decode, which may be
+  // within the first two fields of a block
+  while (i + 2 <= n_fields && end - p >= 16 && DecodeI8x2SSE41(p, out + i)) {
+    p += 2 * I8_WIDTH;
+    i += 2;
+  }
+  DecodeI8CardScalar(p, end, n_fields - i, out + i);
+}
+
+// Best kernel this CPU supports
+static inline IntDecoderKernel DetectIntDecoderKernel() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  int n_ids = info[0];
+  __cpuid(info, 1);
+  bool has_sse41 = (info[2] & (1 << 19)) != 0;
+  bool has_osxsave = (info[2] & (1 << 27)) != 0;
+  bool has_avx2 = false;
+  if (n_ids >= 7 && has_osxsave && (_xgetbv(0) & 0x6) == 0x6) {
+    __cpuidex(info, 7, 0);
+    has_avx2 = (info[1] & (1 << 5)) != 0;
+  }
+#else
+  __builtin_cpu_init();
+  bool has_sse41 = __builtin_cpu_supports("sse4.1");
+  bool has_avx2 = __builtin_cpu_supports("avx2");
+#endif
+  if (has_avx2) {
+    return IntDecoderKernel::AVX2;
+  }
+  if (has_sse41) {
+    return IntDecoderKernel::SSE41;
+  }
+  return IntDecoderKernel::Scalar;
+}
+
+#else
+
+static inline IntDecoderKernel DetectIntDecoderKernel() {
+  return IntDecoderKernel::Scalar;
+}
+
+#endif // INT_DECODER_X86
+
+typedef void (*DecodeI8CardFn)(const char *, const char *, int, int *);
+
+static inline DecodeI8CardFn IntDecoderFunction(IntDecoderKernel kernel) {
+  switch (kernel) {
+#ifdef INT_DECODER_X86
+  case IntDecoderKernel::AVX2:
+    return DecodeI8CardAVX2;
+  case IntDecoderKernel::SSE41:
+    return DecodeI8CardSSE41;
+#endif
+  default:
+    return DecodeI8CardScalar;
+  }
+}
+
+static inline const char *IntDecoderName(IntDecoderKernel kernel) {
+  switch (kernel) {
+  case IntDecoderKernel::AVX2:
+    return "avx2";
+  case IntDecoderKernel::SSE41:
+    return "sse4.1";
+  default:
+    return "scalar";
+  }
+}
+
+// Kernel selected for this CPU, detected once
+static inline DecodeI8CardFn &DecodeI8CardDispatch() {
+  static DecodeI8CardFn fn = IntDecoderFunction(DetectIntDecoderKernel());
+  return fn;
+}
+
+// Decode ``n_fields`` 8 character integer fields starting at ``p`` into
+// ``out``. ``end`` bounds how far the decoder may read, and fields past the end
+// of the line are zero.
+static inline void DecodeI8Card(const char *p, const char *end, int n_fields,
+                                int *out) {
+  DecodeI8CardDispatch()(p, end, n_fields, out);
+}
+
+// Decode ``n_fields`` integer fields of ``Width`` characters. Only 8 character
+// fields have SIMD kernels; wider ones, such as those of long format cards,
+// are decoded with the scalar decoder.
+template <int Width>
+static inline void DecodeIntCard(const char *p, const char *end, int n_fields,
+                                 int *out) {
+  if constexpr (Width == I8_WIDTH) {
+    DecodeI8Card(p, end, n_fields, out);
+  } else {
+    DecodeIntCardScalar<Width>(p, end, n_fields, out);
+  }
+}
+
+#endif // INT_DECODER_HEADER_H
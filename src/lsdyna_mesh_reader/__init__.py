@@ -3,7 +3,15 @@
 from importlib.metadata import PackageNotFoundError, version
 
 from lsdyna_mesh_reader import examples
-from lsdyna_mesh_reader.deck import Deck
+from lsdyna_mesh_reader.deck import (
+    Deck,
+    DeckFuture,
+    ElementChunk,
+    NodeChunk,
+    iter_elements,
+    iter_nodes,
+    write_deck,
+)
 
 # get current version from the package metadata
 try:
@@ -12,4 +20,13 @@ except PackageNotFoundError:
     __version__ = "unknown"
 
 
-__all__ = ["examples", "Deck"]
+__all__ = [
+    "examples",
+    "Deck",
+    "DeckFuture",
+    "ElementChunk",
+    "NodeChunk",
+    "iter_elements",
+    "iter_nodes",
+    "write_deck",
+]
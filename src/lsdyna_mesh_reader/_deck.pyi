@@ -1,4 +1,4 @@
-from typing import List, Tuple
+from typing import List, Optional, Tuple, Union, overload
 
 import numpy as np
 from numpy.typing import NDArray
@@ -7,15 +7,37 @@ from numpy.typing import NDArray
 IntArray = NDArray[np.int32]
 FloatArray1D = NDArray[np.float64]
 FloatArray2D = NDArray[np.float64]
+FloatArray3D = NDArray[np.float64]
 LongArray1D = NDArray[np.int64]
 Uint8Array1D = NDArray[np.uint8]
 
+class Keyword:
+    @property
+    def name(self) -> str: ...
+    @property
+    def offset(self) -> int: ...
+    @property
+    def length(self) -> int: ...
+    @property
+    def line(self) -> int: ...
+    @property
+    def filename(self) -> str: ...
+
 class NodeSection:
+    @overload
     def __init__(self) -> None: ...
+    @overload
+    def __init__(
+        self,
+        nid: IntArray,
+        coordinates: FloatArray2D,
+        tc: Optional[IntArray] = None,
+        rc: Optional[IntArray] = None,
+    ) -> None: ...
     @property
     def nid(self) -> IntArray: ...
     @property
-    def coordinates(self) -> FloatArray2D: ...
+    def coordinates(self) -> Union[FloatArray2D, NDArray[np.float32]]: ...
     @property
     def tc(self) -> IntArray: ...
     @property
@@ -23,9 +45,16 @@ class NodeSection:
     def __len__(self) -> int: ...
     @property
     def fpos(self) -> int: ...
+    @property
+    def filename(self) -> str: ...
 
 class ElementSection:
+    @overload
     def __init__(self) -> None: ...
+    @overload
+    def __init__(
+        self, eid: IntArray, pid: IntArray, node_ids: IntArray, node_id_offsets: IntArray
+    ) -> None: ...
     @property
     def eid(self) -> IntArray: ...
     @property
@@ -34,6 +63,10 @@ class ElementSection:
     def node_ids(self) -> IntArray: ...
     @property
     def node_id_offsets(self) -> IntArray: ...
+    @property
+    def fpos(self) -> int: ...
+    @property
+    def filename(self) -> str: ...
     def __len__(self) -> int: ...
     def to_vtk(self) -> Tuple[LongArray1D, LongArray1D, Uint8Array1D]: ...
 
@@ -41,17 +74,150 @@ class ElementShellSection(ElementSection): ...
 class ElementSolidSection(ElementSection): ...
 
 class _Deck:
-    def __init__(self, fname: str) -> None: ...
+    @overload
+    def __init__(
+        self,
+        fname: str,
+        num_threads: int = 1,
+        io_backend: str = "mmap",
+        block_size: int = 16777216,
+    ) -> None: ...
+    @overload
+    def __init__(self, buffer: Uint8Array1D, name: str, num_threads: int = 1) -> None: ...
+    @staticmethod
+    def streamed(name: str, num_threads: int = 1) -> _Deck: ...
+    @property
+    def num_threads(self) -> int: ...
+    @num_threads.setter
+    def num_threads(self, num_threads: int) -> None: ...
+    @property
+    def progress(self) -> Tuple[int, int]: ...
+    @property
+    def cancelled(self) -> bool: ...
+    def cancel(self) -> None: ...
+    @property
+    def single_precision(self) -> bool: ...
+    @single_precision.setter
+    def single_precision(self, single_precision: bool) -> None: ...
+    @property
+    def keywords(self) -> List[Keyword]: ...
+    @property
+    def node_keywords(self) -> List[int]: ...
+    @property
+    def element_solid_keywords(self) -> List[int]: ...
+    @property
+    def element_shell_keywords(self) -> List[int]: ...
     @property
     def node_sections(self) -> List[NodeSection]: ...
     @property
     def element_solid_sections(self) -> List[ElementSolidSection]: ...
     @property
     def element_shell_sections(self) -> List[ElementShellSection]: ...
+    @property
+    def missing_includes(self) -> List[str]: ...
+    @property
+    def filenames(self) -> List[str]: ...
+    def set_read_filter(
+        self,
+        shells: bool,
+        solids: bool,
+        tshells: bool,
+        part_ids: Optional[IntArray] = None,
+        exclude: bool = False,
+    ) -> None: ...
     def read_line(self) -> int: ...
     def read_element_solid_section(self) -> None: ...
     def read_element_shell_section(self) -> None: ...
     def read_node_section(self) -> None: ...
     def read(self) -> None: ...
+    def write_stream(self, block: Uint8Array1D) -> bool: ...
+    def close_stream(self, error: str = "") -> None: ...
+    def abort_stream(self) -> None: ...
+    def index_keywords(self) -> None: ...
+    def write_cache(self, path: str) -> None: ...
+    def load_cache(self, path: str) -> bool: ...
+    def load_node_section(self, index: int) -> NodeSection: ...
+    def load_element_solid_section(self, index: int) -> ElementSolidSection: ...
+    def load_element_shell_section(self, index: int) -> ElementShellSection: ...
+    def to_vtk(
+        self,
+        node_sections: List[NodeSection],
+        shell_sections: List[ElementShellSection],
+        solid_sections: List[ElementSolidSection],
+        wide: bool = False,
+    ) -> Tuple[
+        FloatArray2D,
+        IntArray,
+        NDArray[np.integer],
+        NDArray[np.integer],
+        Uint8Array1D,
+        IntArray,
+    ]: ...
+    def index_node_ids(self, node_sections: List[NodeSection]) -> None: ...
+    def index_element_ids(
+        self,
+        shell_sections: List[ElementShellSection],
+        solid_sections: List[ElementSolidSection],
+    ) -> None: ...
+    def node_index(self, ids: IntArray) -> LongArray1D: ...
+    def element_index(self, ids: IntArray) -> Tuple[IntArray, IntArray]: ...
+    def extract_parts(
+        self,
+        node_sections: List[NodeSection],
+        shell_sections: List[ElementShellSection],
+        solid_sections: List[ElementSolidSection],
+        part_ids: IntArray,
+        renumber: bool = False,
+    ) -> Tuple[List[NodeSection], List[ElementShellSection], List[ElementSolidSection]]: ...
+    def overwrite_node_sections(
+        self, filename: str, sections: List[int], nodes: FloatArray2D
+    ) -> None: ...
+    def write_node_variants(self, filenames: List[str], nodes: FloatArray3D) -> None: ...
+
+class _DeckLoader:
+    def __init__(self, decks: List[_Deck], num_threads: int = 0) -> None: ...
+    def __iter__(self) -> _DeckLoader: ...
+    def __next__(self) -> int: ...
+
+class _SectionReader:
+    def __init__(
+        self,
+        filename: str,
+        nodes: bool,
+        chunk_rows: int,
+        shells: bool = True,
+        solids: bool = True,
+        tshells: bool = True,
+    ) -> None: ...
+    def next(self) -> int: ...
+    @property
+    def section(self) -> int: ...
+    @property
+    def keyword(self) -> str: ...
+    @property
+    def num_nodes(self) -> int: ...
+    @property
+    def nid(self) -> IntArray: ...
+    @property
+    def coordinates(self) -> FloatArray2D: ...
+    @property
+    def tc(self) -> IntArray: ...
+    @property
+    def rc(self) -> IntArray: ...
+    @property
+    def eid(self) -> IntArray: ...
+    @property
+    def pid(self) -> IntArray: ...
+    @property
+    def node_ids(self) -> IntArray: ...
 
 def overwrite_node_section(filename: str, fpos: int, nodes: FloatArray2D) -> None: ...
+def write_deck(
+    filename: str,
+    node_sections: List[NodeSection],
+    shell_sections: List[ElementShellSection],
+    solid_sections: List[ElementSolidSection],
+    tshell_sections: List[ElementSolidSection],
+    long_format: bool = False,
+    num_threads: int = 1,
+) -> None: ...
@@ -1,18 +1,41 @@
+import gzip
 import os
-import shutil
+import threading
+import warnings
+import weakref
+from concurrent.futures import CancelledError, Executor, Future
 from pathlib import Path
-from typing import TYPE_CHECKING, List, Union
+from typing import (
+    TYPE_CHECKING,
+    Any,
+    BinaryIO,
+    Callable,
+    Dict,
+    Generic,
+    Iterable,
+    Iterator,
+    List,
+    NamedTuple,
+    Sequence,
+    Tuple,
+    TypeVar,
+    Union,
+    overload,
+)
 
 import numpy as np
-from numpy.typing import NDArray
+from numpy.typing import ArrayLike, NDArray
 
 from lsdyna_mesh_reader._deck import (
     ElementShellSection,
     ElementSolidSection,
+    Keyword,
     NodeSection,
     _Deck,
-    overwrite_node_section,
+    _DeckLoader,
+    _SectionReader,
 )
+from lsdyna_mesh_reader._deck import write_deck as _write_deck
 
 if TYPE_CHECKING:
     try:
@@ -23,10 +46,257 @@ if TYPE_CHECKING:
 
 #: Largest value ``int32`` cell arrays can hold. VTK stores 32-bit offsets and
 #: connectivity natively, at half the memory of the 64-bit ``ID_TYPE``, so the
-#: grid is built from ``int32`` whenever the deck indexes fewer points than
-#: this.
+#: grid is built from ``int32`` whenever the deck's points and connectivity
+#: both fit within this.
 _INT32_MAX = np.iinfo(np.int32).max
 
+#: Suffix of the binary cache written next to a deck with ``cache=True``.
+CACHE_SUFFIX = ".lsdcache"
+
+#: Element keywords that can be selected when reading a deck.
+ELEMENT_KEYWORDS = ("*ELEMENT_SHELL", "*ELEMENT_SOLID", "*ELEMENT_TSHELL")
+
+#: Compression of a deck inferred from the suffix of its filename.
+COMPRESSION_SUFFIXES = {".gz": "gzip", ".zst": "zstd"}
+
+#: Bytes decompressed at a time when reading a compressed deck. Each block is
+#: parsed while the next one is decompressed.
+_DECOMPRESS_BLOCK_BYTES = 1 << 22
+
+#: Decompressed bytes assumed per compressed byte when a compressed deck's
+#: header doesn't give its size. Room for the deck is reserved from this
+#: estimate, which costs address space rather than memory, and is enlarged
+#: when it's exceeded.
+_COMPRESSION_RATIO = 16
+
+#: Bytes read at a time by the ``"pread"`` I/O backend. Each block is parsed
+#: while the next one is read.
+_READ_BLOCK_BYTES = 1 << 24
+
+#: Parameters of :class:`Deck` that choose how its file is read, passed to
+#: :func:`_new_reader` rather than used once the file is open.
+_READER_PARAMETERS = ("compression", "io_backend", "block_size")
+
+
+def _batched(arrays: Iterable[ArrayLike], size: int) -> Iterator[NDArray[np.float64]]:
+    """Stack the arrays of an iterable in batches of at most ``size``."""
+    batch = []
+    for array in arrays:
+        batch.append(np.asarray(array, dtype=np.float64))
+        if len(batch) == size:
+            yield np.stack(batch)
+            batch = []
+    if batch:
+        yield np.stack(batch)
+
+
+def _check_filename(filename: Union[str, Path]) -> str:
+    """Return the path of a deck as a string, checking that it exists."""
+    filename = str(filename)
+    if not os.path.isfile(filename):
+        raise FileNotFoundError(f"Invalid file or unable to locate {filename}")
+    return filename
+
+
+def _check_uncompressed(filename: Union[str, Path]) -> str:
+    """Return the path of a deck read a chunk at a time, checking that it
+    exists and isn't compressed, as the chunks are parsed from the mapped file.
+    """
+    filename = _check_filename(filename)
+    if _check_compression(filename, "infer") is not None:
+        raise ValueError(
+            f"Can't read the compressed deck {filename} a chunk at a time, "
+            "read it with Deck instead"
+        )
+    return filename
+
+
+def _check_compression(filename: str, compression: Union[str, None]) -> Union[str, None]:
+    """Return the compression of a deck, inferred from its suffix for ``"infer"``."""
+    if compression == "infer":
+        return COMPRESSION_SUFFIXES.get(os.path.splitext(filename)[1].lower())
+    if compression is not None and compression not in COMPRESSION_SUFFIXES.values():
+        raise ValueError(
+            f"Unknown compression {compression!r}, expected 'gzip', 'zstd', 'infer', or None"
+        )
+    return compression
+
+
+def _open_compressed(filename: str, compression: str) -> BinaryIO:
+    """Open a compressed deck for reading its decompressed bytes."""
+    if compression == "gzip":
+        return gzip.open(filename, "rb")
+    try:
+        from compression import zstd  # type: ignore[import-not-found]
+    except ImportError:
+        try:
+            import zstandard  # type: ignore[import-not-found]
+        except ImportError:
+            raise ImportError(
+                "Reading zstd compressed decks requires Python 3.14 or the zstandard package"
+            ) from None
+        return zstandard.open(filename, "rb")
+    return zstd.open(filename, "rb")
+
+
+def _decompressed_size(filename: str, compression: str) -> int:
+    """Estimate the decompressed size of a compressed deck.
+
+    The size is taken from the header of a zstd frame or the trailer of a gzip
+    member, which holds it modulo ``2**32`` and so is only used for files too
+    small to decompress to more than that. Otherwise, or when the size is less
+    than that of the compressed file, such as for a deck of several gzip
+    members, it's estimated from :data:`_COMPRESSION_RATIO`.
+    """
+    compressed_size = os.path.getsize(filename)
+    size = 0
+    with open(filename, "rb") as f:
+        if compression == "gzip":
+            if compressed_size * _COMPRESSION_RATIO < 1 << 32:
+                f.seek(max(compressed_size - 4, 0))
+                size = int.from_bytes(f.read(4), "little")
+        else:
+            header = f.read(18)
+            if len(header) >= 6 and header[:4] == b"\x28\xb5\x2f\xfd":
+                descriptor = header[4]
+                single_segment = descriptor >> 5 & 1
+                n_bytes = (single_segment, 2, 4, 8)[descriptor >> 6]
+                start = 5 + (not single_segment) + (0, 1, 2, 4)[descriptor & 3]
+                if n_bytes and len(header) >= start + n_bytes:
+                    size = int.from_bytes(header[start : start + n_bytes], "little")
+                    size += 256 if n_bytes == 2 else 0
+    if size < compressed_size:
+        size = compressed_size * _COMPRESSION_RATIO
+    return size
+
+
+class _Decompressor:
+    """Decompress a deck into its streamed reader on a background thread.
+
+    The reader is created along with the decompressor, which starts the first
+    time the reader waits for the deck, so that decks opened ahead of their
+    parse aren't all decompressed at once. Decompression releases the GIL, so
+    the reader parses each block while the next one is decompressed.
+    """
+
+    def __init__(self, filename: str, compression: str, num_threads: int) -> None:
+        self._filename = filename
+        self._compression = compression
+        self._error: Union[BaseException, None] = None
+        self._thread: Union[threading.Thread, None] = None
+        self._closed = False
+        self._lock = threading.Lock()
+
+        # the reader only holds a weak reference, so the two don't form a
+        # cycle, which the garbage collector can't see through the reader
+        ref = weakref.ref(self)
+
+        def start() -> None:
+            decompressor = ref()
+            if decompressor is not None:
+                decompressor._start()
+
+        self.deck = _Deck.streamed(
+            filename, num_threads, _decompressed_size(filename, compression), start
+        )
+
+    def _start(self) -> None:
+        with self._lock:
+            if self._closed or self._thread is not None:
+                return
+            self._thread = threading.Thread(
+                target=self._run,
+                args=(self._filename, self._compression),
+                name=f"decompress {self._filename}",
+            )
+            self._thread.daemon = True
+            self._thread.start()
+
+    def _run(self, filename: str, compression: str) -> None:
+        try:
+            with _open_compressed(filename, compression) as f:
+                while True:
+                    block = f.read(_DECOMPRESS_BLOCK_BYTES)
+                    # the reader stops taking blocks once it fails or is cancelled
+                    if not block or not self.deck.write_stream(np.frombuffer(block, np.uint8)):
+                        break
+        except BaseException as exc:
+            self._error = exc
+            self.deck.close_stream(f"Error decompressing {filename}: {exc}")
+        else:
+            self.deck.close_stream()
+
+    def close(self) -> None:
+        """Stop decompressing a deck that's no longer read and wait for the
+        thread, if it started. Raises the error that stopped decompression, if
+        any.
+        """
+        with self._lock:
+            self._closed = True
+        self.deck.abort_stream()
+        if self._thread is not None:
+            self._thread.join()
+        if self._error is not None:
+            raise self._error
+
+
+def _new_reader(
+    filename: str,
+    num_threads: int,
+    cache: Union[bool, str, Path] = False,
+    compression: Union[str, None] = "infer",
+    io_backend: str = "mmap",
+    block_size: int = _READ_BLOCK_BYTES,
+) -> Tuple[_Deck, Union[_Decompressor, None]]:
+    """Create the reader of ``filename``. A compressed deck is decompressed
+    into its reader on a background thread, which is also returned.
+    """
+    compression = _check_compression(filename, compression)
+    if compression is None:
+        return _Deck(filename, num_threads, io_backend, block_size), None
+    if cache is not False:
+        raise ValueError("A compressed deck can't be cached")
+    decompressor = _Decompressor(filename, compression, num_threads)
+    return decompressor.deck, decompressor
+
+
+def _pop_reader_parameters(kwargs: Dict[str, Any]) -> Dict[str, Any]:
+    """Remove the parameters of :func:`_new_reader` from ``kwargs`` and return them."""
+    return {key: kwargs.pop(key) for key in _READER_PARAMETERS if key in kwargs}
+
+
+def _check_element_keywords(keywords: Sequence[str]) -> List[str]:
+    """Return the element keywords in upper case, checking each is known."""
+    keywords = [keyword.upper() for keyword in keywords]
+    for keyword in keywords:
+        if keyword not in ELEMENT_KEYWORDS:
+            raise ValueError(
+                f"Unknown element keyword {keyword}, expected one of {ELEMENT_KEYWORDS}"
+            )
+    return keywords
+
+
+def _int32_ids(ids: ArrayLike) -> Tuple[NDArray[np.int32], Union[NDArray[np.bool_], None]]:
+    """Return ``ids`` as a contiguous int32 array and a mask of the IDs outside
+    the range of int32, which are 0 in the array, or ``None`` when there are none.
+    """
+    ids = np.asarray(ids)
+    if ids.dtype.kind in "iuf":
+        info = np.iinfo(np.int32)
+        out_of_range = (ids < int(info.min)) | (ids > int(info.max))
+        if out_of_range.any():
+            ids = np.where(out_of_range, 0, ids)
+            return np.ascontiguousarray(ids, dtype=np.int32), out_of_range
+    return np.ascontiguousarray(ids, dtype=np.int32), None
+
+
+def _part_ids(pid: ArrayLike) -> NDArray[np.int32]:
+    """Return the part IDs ``pid`` as a flat int32 array, checking each fits."""
+    part_ids, out_of_range = _int32_ids(pid)
+    if out_of_range is not None:
+        raise ValueError(f"Part ID {np.asarray(pid)[out_of_range][0]} is out of the range of int32")
+    return part_ids.ravel()
+
 
 def _uniform_cell_width(offsets: NDArray[np.integer]) -> Union[int, None]:
     """Return the points per cell when every cell is the same width.
@@ -58,6 +328,110 @@ def _uniform_cell_width(offsets: NDArray[np.integer]) -> Union[int, None]:
     return width
 
 
+SectionT = TypeVar("SectionT", NodeSection, ElementSolidSection, ElementShellSection)
+
+
+class _LazySections(Sequence[SectionT], Generic[SectionT]):
+    """Sections of a deck that are parsed the first time they're accessed.
+
+    Each section is parsed once, even when several threads access it at once.
+
+    Parameters
+    ----------
+    keyword_indices : Sequence[int]
+        Index of each section's keyword within ``_Deck.keywords``.
+    load : Callable[[int], SectionT]
+        Parses the section of a keyword index.
+
+    """
+
+    def __init__(self, keyword_indices: Sequence[int], load: Callable[[int], SectionT]) -> None:
+        self._keyword_indices = list(keyword_indices)
+        self._load = load
+        self._sections: List[Union[SectionT, None]] = [None] * len(self._keyword_indices)
+        self._locks = [threading.Lock() for _ in self._keyword_indices]
+
+    def __len__(self) -> int:
+        return len(self._keyword_indices)
+
+    @overload
+    def __getitem__(self, index: int) -> SectionT: ...
+
+    @overload
+    def __getitem__(self, index: slice) -> List[SectionT]: ...
+
+    def __getitem__(self, index: Union[int, slice]) -> Union[SectionT, List[SectionT]]:
+        if isinstance(index, slice):
+            return [self[i] for i in range(*index.indices(len(self)))]
+
+        section = self._sections[index]
+        if section is None:
+            with self._locks[index]:
+                section = self._sections[index]
+                if section is None:
+                    section = self._load(self._keyword_indices[index])
+                    self._sections[index] = section
+        return section
+
+    def __repr__(self) -> str:
+        return repr(list(self))
+
+
+class DeckFuture(Future["Deck"]):
+    """Deck loading in the background, returned by :func:`Deck.load_async`.
+
+    A :class:`concurrent.futures.Future` whose result is the :class:`Deck`,
+    which can also report the progress of the load and cancel it while it
+    runs.
+
+    """
+
+    def __init__(self, deck: _Deck) -> None:
+        super().__init__()
+        self._deck = deck
+
+    def progress(self) -> Tuple[int, int]:
+        """Return the bytes of node and element cards parsed so far and in all.
+
+        The total is ``0`` until the keywords of the deck, and of the files it
+        includes, are indexed. Loading from a cache or lazily doesn't parse
+        any cards.
+
+        Examples
+        --------
+        >>> future = lsdyna_mesh_reader.Deck.load_async("vehicle.k", num_threads=0)
+        >>> future.progress()
+        (402653184, 1493172224)
+
+        """
+        return self._deck.progress
+
+    def cancel(self) -> bool:
+        """Cancel loading the deck.
+
+        A pending load never starts, and a running one stops at its next
+        chunk of cards. :func:`DeckFuture.result` then raises
+        ``concurrent.futures.CancelledError``.
+
+        Returns
+        -------
+        bool
+            ``False`` when the deck has already loaded, otherwise ``True``.
+
+        """
+        if super().cancel():
+            self._deck.cancel()
+            return True
+        if self.done():
+            return False
+        self._deck.cancel()
+        return True
+
+    def cancelled(self) -> bool:
+        """Return ``True`` when the load was cancelled."""
+        return super().cancelled() or (self.done() and self._deck.cancelled)
+
+
 class Deck:
     r"""LS-DYNA deck.
 
@@ -65,6 +439,98 @@ class Deck:
     ----------
     filename : str | pathlib.Path
         Path to the keyword file (``*.k``, ``*.key``, ``*.dyn``).
+    num_threads : int, default: 1
+        Number of threads used to read large node and element sections. Use
+        ``0`` or a negative value to use every available core. Sections
+        smaller than 1 MB are always read on a single thread.
+    lazy : bool, default: False
+        Only index the keywords of the deck when opening it, and parse each
+        node and element section the first time it's accessed. This makes
+        opening a large deck to list its keywords or read a single section
+        much faster.
+    cache : bool | str | pathlib.Path, default: False
+        Cache the parsed sections in a binary file. ``True`` stores the cache
+        next to the deck as ``<filename>.lsdcache``, and a path stores it
+        there instead. The cache is used when the size, modification time,
+        and contents of the deck match the ones it was written for, and its
+        arrays are memory mapped rather than parsed or copied. Otherwise the
+        deck is read and the cache is (re)written. A lazy deck without a
+        valid cache isn't parsed up front and doesn't write one.
+    pid : array_like[int], optional
+        Only keep the elements of these parts.
+    exclude_pid : array_like[int], optional
+        Keep the elements of every part except these.
+    element_keywords : sequence[str], optional
+        Only read the element sections of these keywords, any of
+        ``"*ELEMENT_SHELL"``, ``"*ELEMENT_SOLID"``, and ``"*ELEMENT_TSHELL"``.
+        Variants of a keyword, such as ``*ELEMENT_SHELL_THICKNESS``, follow
+        it.
+    exclude_element_keywords : sequence[str], optional
+        Read the element sections of every keyword except these.
+    nodes_only : bool, default: False
+        Only read the node sections.
+    float32 : bool, default: False
+        Store node coordinates in single precision, halving their memory.
+        Their ``coordinates`` are then ``numpy.float32`` arrays. Single
+        precision decks can't be cached.
+    compression : str, optional
+        Compression of the file, ``"gzip"`` or ``"zstd"``, or ``None`` for an
+        uncompressed file. By default it's inferred from the suffix of
+        ``filename``, ``.gz`` or ``.zst``. Reading zstd requires Python 3.14
+        or the ``zstandard`` package. Compressed decks can't be cached.
+    io_backend : str, default: "mmap"
+        How the deck and the files it includes are read. ``"mmap"`` maps them
+        into memory, hinting that they're read from start to end so that the
+        pages ahead of the parser are read before it reaches them.
+        ``"mmap_populate"`` also reads every page while mapping, on Linux.
+        ``"pread"`` reads them in blocks of ``block_size`` bytes on a
+        background thread, parsing the blocks already read while the next
+        one is read, which is usually fastest on network filesystems such as
+        NFS or Lustre. Reading starts when the deck is parsed. The blocks of
+        a lazy or cached deck are held in memory for the life of the deck,
+        while those of any other deck are freed as they're parsed, and the
+        few methods that read the file again, such as
+        :func:`Deck.write_node_variants`, map it. Not used for compressed
+        decks.
+    block_size : int, default: 16777216
+        Bytes read at a time by the ``"pread"`` backend.
+
+    Notes
+    -----
+    Files included with ``*INCLUDE`` are read along with the deck, and their
+    keywords and sections follow the ``*INCLUDE`` as if the file were pasted
+    there. Relative paths are resolved against the including file, the deck,
+    then each ``*INCLUDE_PATH`` and ``*INCLUDE_PATH_RELATIVE`` directory. A
+    file included more than once is only read at its first ``*INCLUDE``, and
+    one that can't be found is skipped with a warning.
+
+    A compressed deck is decompressed in blocks on a background thread while
+    it's read, without writing it to disk. Each section is parsed as soon as
+    all of it has been decompressed, so reading takes little longer than
+    decompressing. The decompressed deck is held in memory in full, in place
+    of the mapped file of an uncompressed deck, so a compressed deck must fit
+    in memory.
+
+    Filters on parts and element keywords are applied while parsing, so a
+    filtered deck only stores what it keeps. Sections of excluded keywords
+    aren't parsed at all, and only the part ID of each element card is
+    decoded until the card is known to be kept. Filtered decks can't be
+    cached.
+
+    Sections are stored compactly. Node and element IDs numbered
+    consecutively, offsets of elements with the same number of nodes, and
+    constraints that are all zero aren't stored, and their arrays are only
+    created the first time they're accessed from Python.
+
+    The arrays of the sections are views into a few large blocks of memory
+    owned by the deck, which are freed once the deck and every array from it
+    are deleted.
+
+    A deck and its sections may be read from several threads at once, which
+    runs in parallel on free-threaded Python. Arrays created on first access,
+    lazily parsed sections, and the ID indices are each created once, under a
+    lock. Methods that change the deck, such as setting
+    :attr:`Deck.num_threads`, must not run while other threads use it.
 
     Examples
     --------
@@ -76,24 +542,514 @@ class Deck:
       Element Solid sections:     1
       Element Shell sections:     1
 
+    Open a deck lazily and parse only its first node section.
+
+    >>> deck = lsdyna_mesh_reader.Deck(examples.birdball, lazy=True)
+    >>> deck.node_sections[0].coordinates
+    array([[ -2.30940104,  -2.30940104,  -2.30940104],
+           [ -2.03960061,  -2.03960061,  -2.03960061],
+           [ -1.76980031,  -1.76980031,  -1.76980031],
+           ...,
+           [ -4.        , -10.        ,   0.        ],
+           [ -2.        , -10.        ,   0.        ],
+           [  0.        , -10.        ,   0.        ]])
+
+    Cache the parsed deck so that opening it again skips parsing.
+
+    >>> deck = lsdyna_mesh_reader.Deck("model.k", cache=True)  # writes model.k.lsdcache
+    >>> deck = lsdyna_mesh_reader.Deck("model.k", cache=True)  # loads the cache
+
+    Read only the shells of part 2.
+
+    >>> deck = lsdyna_mesh_reader.Deck(
+    ...     examples.birdball, pid=[2], element_keywords=["*ELEMENT_SHELL"]
+    ... )
+    >>> len(deck.element_shell_sections[0]), len(deck.element_solid_sections)
+    (100, 0)
+
     """
 
-    def __init__(self, filename: Union[str, Path]) -> None:
+    def __init__(
+        self,
+        filename: Union[str, Path],
+        num_threads: int = 1,
+        lazy: bool = False,
+        cache: Union[bool, str, Path] = False,
+        pid: Union[ArrayLike, None] = None,
+        exclude_pid: Union[ArrayLike, None] = None,
+        element_keywords: Union[Sequence[str], None] = None,
+        exclude_element_keywords: Union[Sequence[str], None] = None,
+        nodes_only: bool = False,
+        float32: bool = False,
+        compression: Union[str, None] = "infer",
+        io_backend: str = "mmap",
+        block_size: int = _READ_BLOCK_BYTES,
+    ) -> None:
         """Initialize the deck object."""
-        filename = str(filename)
-        if not os.path.isfile(filename):
-            raise FileNotFoundError(f"Invalid file or unable to locate {filename}")
-        self._deck = _Deck(filename)
-        self._deck.read()
+        filename = _check_filename(filename)
+        deck, decompressor = _new_reader(
+            filename, num_threads, cache, compression, io_backend, block_size
+        )
+        self._load(
+            deck,
+            filename,
+            decompressor,
+            lazy=lazy,
+            cache=cache,
+            pid=pid,
+            exclude_pid=exclude_pid,
+            element_keywords=element_keywords,
+            exclude_element_keywords=exclude_element_keywords,
+            nodes_only=nodes_only,
+            float32=float32,
+        )
+
+    def _load(
+        self,
+        deck: _Deck,
+        filename: str,
+        decompressor: Union[_Decompressor, None] = None,
+        **kwargs: Any,
+    ) -> None:
+        """Read or index ``filename`` with ``deck``, as described in :class:`Deck`,
+        while ``decompressor`` decompresses a compressed deck into it.
+        """
+        try:
+            if self._open(deck, filename, **kwargs):
+                self._deck.read()
+        finally:
+            # raises the error that stopped decompression in place of the read's
+            if decompressor is not None:
+                decompressor.close()
+        self._finish()
+
+    def _open(
+        self,
+        deck: _Deck,
+        filename: str,
+        lazy: bool = False,
+        cache: Union[bool, str, Path] = False,
+        pid: Union[ArrayLike, None] = None,
+        exclude_pid: Union[ArrayLike, None] = None,
+        element_keywords: Union[Sequence[str], None] = None,
+        exclude_element_keywords: Union[Sequence[str], None] = None,
+        nodes_only: bool = False,
+        float32: bool = False,
+    ) -> bool:
+        """Set up ``deck`` to read ``filename``, and load or index it when it's
+        cached or lazy. Returns ``True`` when its sections still need reading,
+        after which :func:`Deck._finish` completes the deck.
+        """
+        self._deck = deck
         self._filename = filename
 
+        if pid is not None and exclude_pid is not None:
+            raise ValueError("Specify either `pid` or `exclude_pid`, not both")
+        read_keywords = set(ELEMENT_KEYWORDS)
+        if element_keywords is not None:
+            read_keywords = set(_check_element_keywords(element_keywords))
+        if exclude_element_keywords is not None:
+            read_keywords -= set(_check_element_keywords(exclude_element_keywords))
+        if nodes_only:
+            read_keywords = set()
+        part_ids = exclude_pid if pid is None else pid
+        if part_ids is not None:
+            part_ids = _part_ids(part_ids)
+        self._deck.set_read_filter(
+            "*ELEMENT_SHELL" in read_keywords,
+            "*ELEMENT_SOLID" in read_keywords,
+            "*ELEMENT_TSHELL" in read_keywords,
+            part_ids,
+            exclude_pid is not None,
+        )
+        if cache is not False and (part_ids is not None or read_keywords != set(ELEMENT_KEYWORDS)):
+            raise ValueError("A filtered deck can't be cached")
+        if cache is not False and float32:
+            raise ValueError("A deck with single precision coordinates can't be cached")
+        self._deck.single_precision = float32
+
+        self._node_sections: Sequence[NodeSection]
+        self._element_solid_sections: Sequence[ElementSolidSection]
+        self._element_shell_sections: Sequence[ElementShellSection]
+
+        if cache is True:
+            cache_path: Union[str, None] = filename + CACHE_SUFFIX
+        elif cache is False:
+            cache_path = None
+        else:
+            cache_path = str(cache)
+        self._cache_path = cache_path
+        self._from_cache = cache_path is not None and self._deck.load_cache(cache_path)
+        self._lazy = lazy
+        # only lazy and cached decks read their files again once they're read
+        self._deck.release_blocks = not lazy and cache_path is None
+
+        if self._from_cache:
+            self._node_sections = self._deck.node_sections
+            self._element_solid_sections = self._deck.element_solid_sections
+            self._element_shell_sections = self._deck.element_shell_sections
+        elif lazy:
+            self._deck.index_keywords()
+            self._node_sections = _LazySections(
+                self._deck.node_keywords, self._deck.load_node_section
+            )
+            self._element_solid_sections = _LazySections(
+                self._deck.element_solid_keywords, self._deck.load_element_solid_section
+            )
+            self._element_shell_sections = _LazySections(
+                self._deck.element_shell_keywords, self._deck.load_element_shell_section
+            )
+        return not self._from_cache and not lazy
+
+    def _finish(self) -> None:
+        """Complete a deck opened by :func:`Deck._open` once it's read."""
+        if not self._from_cache and not self._lazy:
+            self._node_sections = self._deck.node_sections
+            self._element_solid_sections = self._deck.element_solid_sections
+            self._element_shell_sections = self._deck.element_shell_sections
+            # a missing include may appear later, so these decks aren't cached
+            cache_path = self._cache_path
+            if cache_path is not None and not self._deck.missing_includes:
+                try:
+                    self._deck.write_cache(cache_path)
+                except RuntimeError as exc:
+                    warnings.warn(f"Unable to write the deck cache {cache_path}: {exc}")
+        for include in self._deck.missing_includes:
+            warnings.warn(f"Unable to locate the included file {include}")
+        self._keywords = self._deck.keywords
+        self._node_ids_indexed = False
+        self._element_ids_indexed = False
+        self._index_lock = threading.Lock()
+
+    @classmethod
+    def from_buffer(
+        cls, buffer: Any, name: str = "<buffer>", num_threads: int = 1, **kwargs: Any
+    ) -> "Deck":
+        """Read a deck from the bytes of a buffer rather than from a file.
+
+        The bytes are parsed in place, without being copied or written to
+        disk, and the buffer is kept alive as long as the deck.
+
+        Parameters
+        ----------
+        buffer : bytes | bytearray | memoryview | numpy.ndarray
+            Contents of the keyword file, as any contiguous object supporting
+            the buffer protocol. It must not change while the deck is used.
+        name : str, default: ``"<buffer>"``
+            Name of the deck, reported by :attr:`Deck.filenames`. Files
+            included by the deck are found relative to its directory.
+        num_threads : int, default: 1
+            Number of threads used to read large sections. See :class:`Deck`.
+        **kwargs
+            Other parameters of :class:`Deck`, such as ``lazy`` or ``pid``.
+            Decks read from a buffer can't be cached.
+
+        Returns
+        -------
+        Deck
+            The deck.
+
+        Examples
+        --------
+        Read a deck decompressed in memory.
+
+        >>> import gzip
+        >>> import lsdyna_mesh_reader
+        >>> with open("model.k.gz", "rb") as f:
+        ...     data = gzip.decompress(f.read())
+        >>> deck = lsdyna_mesh_reader.Deck.from_buffer(data, name="model.k")
+
+        """
+        if kwargs.get("cache", False) is not False:
+            raise ValueError("A deck read from a buffer can't be cached")
+        data = np.frombuffer(buffer, dtype=np.uint8)
+        deck = cls.__new__(cls)
+        deck._load(_Deck(data, name, num_threads), name, **kwargs)
+        return deck
+
+    @classmethod
+    def load_async(
+        cls,
+        filename: Union[str, Path],
+        num_threads: int = 1,
+        executor: Union[Executor, None] = None,
+        **kwargs: Any,
+    ) -> DeckFuture:
+        """Load a deck in the background.
+
+        Parsing runs without holding the GIL, so other Python threads keep
+        running while the deck loads, and several decks can load at once.
+
+        Parameters
+        ----------
+        filename : str | pathlib.Path
+            Path to the keyword file.
+        num_threads : int, default: 1
+            Number of threads used to read large sections. See :class:`Deck`.
+        executor : concurrent.futures.Executor, optional
+            Load the deck on this executor rather than on a new thread.
+        **kwargs
+            Other parameters of :class:`Deck`, such as ``lazy`` or ``cache``.
+
+        Returns
+        -------
+        DeckFuture
+            Future of the loaded deck, which reports the progress of the load
+            and can cancel it.
+
+        Examples
+        --------
+        Load two decks while doing other work, then wait for both.
+
+        >>> import lsdyna_mesh_reader
+        >>> futures = [
+        ...     lsdyna_mesh_reader.Deck.load_async(filename, num_threads=0)
+        ...     for filename in ["vehicle.k", "barrier.k"]
+        ... ]
+        >>> futures[0].progress()
+        (402653184, 1493172224)
+        >>> vehicle, barrier = [future.result() for future in futures]
+
+        """
+        filename = _check_filename(filename)
+        deck, decompressor = _new_reader(
+            filename, num_threads, kwargs.get("cache", False), **_pop_reader_parameters(kwargs)
+        )
+        future = DeckFuture(deck)
+
+        def load() -> None:
+            if not future.set_running_or_notify_cancel():
+                return
+            try:
+                result = cls.__new__(cls)
+                result._load(deck, filename, decompressor, **kwargs)
+            except BaseException as exc:
+                future.set_exception(CancelledError() if deck.cancelled else exc)
+            else:
+                # a cancel that came too late to stop the read still counts
+                if deck.cancelled:
+                    future.set_exception(CancelledError())
+                else:
+                    future.set_result(result)
+
+        if executor is None:
+            threading.Thread(target=load, name=f"load {filename}").start()
+        else:
+            executor.submit(load)
+        return future
+
+    @classmethod
+    def load_many(
+        cls, filenames: Iterable[Union[str, Path]], num_threads: int = 0, **kwargs: Any
+    ) -> List["Deck"]:
+        """Load several decks at once on one pool of threads.
+
+        Parameters
+        ----------
+        filenames : iterable[str | pathlib.Path]
+            Paths to the keyword files.
+        num_threads : int, default: 0
+            Number of threads of the pool, shared by every deck. Use ``0`` or
+            a negative value to use every available core.
+        **kwargs
+            Other parameters of :class:`Deck`, such as ``pid`` or ``cache``,
+            applied to every deck.
+
+        Returns
+        -------
+        list[Deck]
+            The decks, in the order of ``filenames``.
+
+        Notes
+        -----
+        Each deck is parsed by a task of the pool, largest file first, and
+        its large sections are split across the same pool, so threads that
+        finish the small decks help parse the large ones. Decks share the
+        pool afterwards, as for :func:`Deck.to_grid`. Each compressed deck
+        is decompressed on a thread of its own while it's parsed.
+
+        See :func:`Deck.load_many_as_completed` to use each deck as soon as
+        it's loaded.
+
+        Examples
+        --------
+        >>> import lsdyna_mesh_reader
+        >>> filenames = [f"variant_{i}.k" for i in range(500)]
+        >>> decks = lsdyna_mesh_reader.Deck.load_many(filenames, num_threads=8)
+
+        """
+        loaded = dict(cls.load_many_as_completed(filenames, num_threads, **kwargs))
+        return [loaded[i] for i in range(len(loaded))]
+
+    @classmethod
+    def load_many_as_completed(
+        cls, filenames: Iterable[Union[str, Path]], num_threads: int = 0, **kwargs: Any
+    ) -> Iterator[Tuple[int, "Deck"]]:
+        """Load several decks at once, yielding each as it finishes.
+
+        Takes the same parameters as :func:`Deck.load_many`. Loading starts
+        before this returns. Decks loaded from a cache or opened lazily are
+        yielded first.
+
+        Returns
+        -------
+        iterator[tuple[int, Deck]]
+            The index of each deck within ``filenames`` and the deck, in the
+            order they finish. Decks that haven't been yielded when the
+            iterator is closed or deleted are cancelled.
+
+        Examples
+        --------
+        >>> import lsdyna_mesh_reader
+        >>> filenames = [f"variant_{i}.k" for i in range(500)]
+        >>> for i, deck in lsdyna_mesh_reader.Deck.load_many_as_completed(filenames):
+        ...     print(filenames[i], len(deck.node_sections[0]))
+
+        """
+        filenames = [_check_filename(filename) for filename in filenames]
+        reader_parameters = _pop_reader_parameters(kwargs)
+        readers = [
+            _new_reader(filename, num_threads, kwargs.get("cache", False), **reader_parameters)
+            for filename in filenames
+        ]
+        decompressors = {
+            i: decompressor
+            for i, (_, decompressor) in enumerate(readers)
+            if decompressor is not None
+        }
+
+        def close(indices: List[int]) -> None:
+            """Close the decompressors of the decks ``indices``, then raise the
+            first error that stopped decompression, if any.
+            """
+            error = None
+            for i in indices:
+                decompressor = decompressors.pop(i, None)
+                try:
+                    if decompressor is not None:
+                        decompressor.close()
+                except BaseException as exc:
+                    if error is None:
+                        error = exc
+            if error is not None:
+                raise error
+
+        decks = [cls.__new__(cls) for _ in filenames]
+        ready = []
+        to_read = []
+        try:
+            for i, (deck, filename) in enumerate(zip(decks, filenames)):
+                if deck._open(readers[i][0], filename, **kwargs):
+                    to_read.append(i)
+                else:
+                    ready.append(i)
+        except BaseException:
+            for reader, _ in readers:
+                reader.cancel()
+            close(list(decompressors))
+            raise
+        loader = _DeckLoader([decks[i]._deck for i in to_read], num_threads)
+
+        def finish() -> Iterator[Tuple[int, "Deck"]]:
+            # each deck's decompressor is closed once it's read, which raises
+            # the error that stopped decompression in place of the read's
+            yielded = set()
+            try:
+                for i in ready:
+                    close([i])
+                    decks[i]._finish()
+                    yielded.add(i)
+                    yield i, decks[i]
+                for j in loader:
+                    i = to_read[j]
+                    close([i])
+                    decks[i]._finish()
+                    yielded.add(i)
+                    yield i, decks[i]
+            except BaseException:
+                for i, (reader, _) in enumerate(readers):
+                    if i not in yielded:
+                        reader.cancel()
+                close(list(decompressors))
+                raise
+
+        return finish()
+
+    @property
+    def num_threads(self) -> int:
+        """Return or set the number of threads used to read sections.
+
+        Examples
+        --------
+        >>> import lsdyna_mesh_reader
+        >>> from lsdyna_mesh_reader import examples
+        >>> deck = lsdyna_mesh_reader.Deck(examples.birdball, num_threads=4)
+        >>> deck.num_threads
+        4
+
+        """
+        return self._deck.num_threads
+
+    @num_threads.setter
+    def num_threads(self, num_threads: int) -> None:
+        self._deck.num_threads = num_threads
+
     @property
-    def element_solid_sections(self) -> List[ElementSolidSection]:
+    def filenames(self) -> List[str]:
+        """Return the filename of the deck followed by every file it includes.
+
+        Included files are given by their absolute path.
+
+        Examples
+        --------
+        >>> import lsdyna_mesh_reader
+        >>> from lsdyna_mesh_reader import examples
+        >>> deck = lsdyna_mesh_reader.Deck(examples.birdball)
+        >>> deck.filenames
+        ['/path/to/lsdyna_mesh_reader/examples/birdball.k']
+
+        """
+        return self._deck.filenames
+
+    @property
+    def keywords(self) -> List[Keyword]:
+        """Return every keyword in the deck.
+
+        Each keyword records its name, the file containing it, the byte offset
+        and line number of its keyword line within that file, and its length
+        in bytes up to the next keyword. This is available without parsing any
+        sections when the deck is opened with ``lazy=True``.
+
+        Returns
+        -------
+        List[Keyword]
+
+        Examples
+        --------
+        >>> import lsdyna_mesh_reader
+        >>> from lsdyna_mesh_reader import examples
+        >>> deck = lsdyna_mesh_reader.Deck(examples.birdball, lazy=True)
+        >>> deck.keywords[24:]
+        [Keyword(*NODE, line=85, offset=3295, length=93519),
+         Keyword(*ELEMENT_SOLID, line=1367, offset=96814, length=66111),
+         Keyword(*ELEMENT_SHELL, line=2184, offset=162925, length=4915),
+         Keyword(*INITIAL_VELOCITY_NODE, line=2285, offset=167840, length=52544),
+         Keyword(*END, line=3567, offset=220384, length=5)]
+
+        """
+        return self._keywords
+
+    @property
+    def element_solid_sections(self) -> Sequence[ElementSolidSection]:
         """Return the element_solid sections.
 
         Returns
         -------
-        List[ElementSolidSection]
+        Sequence[ElementSolidSection]
+            A list, or a sequence parsing each section on first access when
+            the deck was opened with ``lazy=True``.
+            The element IDs and node ID offsets of every section are read only
+            arrays.
 
         Examples
         --------
@@ -118,15 +1074,19 @@ class Deck:
          array([ 6,  7, 11, 10, 22, 23, 27, 26], dtype=int32)]
 
         """
-        return self._deck.element_solid_sections
+        return self._element_solid_sections
 
     @property
-    def element_shell_sections(self) -> List[ElementShellSection]:
+    def element_shell_sections(self) -> Sequence[ElementShellSection]:
         """Return the element_shell sections.
 
         Returns
         -------
-        List[ElementShellSection]
+        Sequence[ElementShellSection]
+            A list, or a sequence parsing each section on first access when
+            the deck was opened with ``lazy=True``.
+            The element IDs and node ID offsets of every section are read only
+            arrays.
 
         Examples
         --------
@@ -156,15 +1116,19 @@ class Deck:
          array([381, 392, 393, 382], dtype=int32)]
 
         """
-        return self._deck.element_shell_sections
+        return self._element_shell_sections
 
     @property
-    def node_sections(self) -> List[NodeSection]:
+    def node_sections(self) -> Sequence[NodeSection]:
         """Return the node sections.
 
         Returns
         -------
-        List[NodeSection]
+        Sequence[NodeSection]
+            A list, or a sequence parsing each section on first access when
+            the deck was opened with ``lazy=True``.
+            The node IDs and constraints of every section are read only
+            arrays.
 
         Examples
         --------
@@ -190,7 +1154,7 @@ class Deck:
                [  0.        , -10.        ,   0.        ]])
 
         """
-        return self._deck.node_sections
+        return self._node_sections
 
     def to_grid(self) -> "UnstructuredGrid":
         """Convert the mesh within the deck to a pyvista.UnstructuredGrid.
@@ -203,6 +1167,10 @@ class Deck:
         -----
         This requires ``pyvista`` to be installed.
 
+        The points are those of every node section, in order, and the cells
+        are those of the shell sections followed by the solid sections. Cells
+        are assembled in C++ on the deck's threads.
+
         Examples
         --------
         Load an example keyword deck and convert it to an unstructured grid.
@@ -230,61 +1198,34 @@ class Deck:
         """
         try:
             import pyvista as pv
-            from pyvista import ID_TYPE, CellArray
+            from pyvista import CellArray
             from pyvista._vtk import numpy_to_vtk, vtkCellArray
             from pyvista.core.pointset import UnstructuredGrid
         except ImportError as exc:
             msg = "Deck.to_grid requires PyVista. Install it with: pip install pyvista"
             raise ImportError(msg) from exc
 
-        if not self.node_sections:
+        node_sections = list(self.node_sections)
+        if not node_sections:
             raise RuntimeError("Missing node sections. Unable to generate UnstructuredGrid.")
 
-        node_section = self.node_sections[0]
-
-        n_points = len(node_section)
-
-        # Point indices only have to reach n_points, so int32 covers any deck
-        # short of 2**31 nodes and keeps the connectivity half the size.
-        index_dtype = np.int32 if n_points <= _INT32_MAX else ID_TYPE
-
-        # map between the node ids and a sequential index
-        id_map = np.empty(node_section.nid[-1] + 1, dtype=index_dtype)
-        id_map[node_section.nid] = np.arange(n_points, dtype=index_dtype)
-
-        element_sections = self.element_shell_sections + self.element_solid_sections
-
-        if not element_sections:
+        shell_sections = list(self.element_shell_sections)
+        solid_sections = list(self.element_solid_sections)
+        if not shell_sections and not solid_sections:
             raise NotImplementedError("Deck missing element sections")
 
-        # add shell sections
-        offsets: List[NDArray[np.integer]] = []
-        celltypes: List[NDArray[np.uint8]] = []
-        cells: List[NDArray[np.integer]] = []
-        part_ids = []
-        for section in element_sections:
-            section_cells, section_offset, section_celltypes = section.to_vtk()
-            if offsets:
-                # we need to shift by the last value of the last offset
-                offsets.append(section_offset[1:] + offsets[-1][-1])
-            else:
-                offsets.append(section_offset)
-
-            celltypes.append(section_celltypes)
-            cells.append(id_map[section_cells])
-            part_ids.append(section.pid)
-
-        cells_arr = np.hstack(cells, dtype=index_dtype)
-
-        # Offsets index the connectivity rather than the points, so they get
-        # their own check. VTK only drops to 32-bit storage when both arrays
-        # are int32, and a mismatch is promoted back to ID_TYPE.
-        offset_dtype = index_dtype if cells_arr.size <= _INT32_MAX else ID_TYPE
-        offsets_arr = np.hstack(offsets, dtype=offset_dtype)
-        celltypes_arr = np.hstack(celltypes, dtype=np.uint8)
+        # Connectivity is at most every node of every element, and offsets
+        # index it, so both stay int32 when it and the points fit. VTK only
+        # drops to 32-bit storage when both arrays are int32.
+        n_points = sum(len(section) for section in node_sections)
+        n_conn = sum(section.node_ids.size for section in shell_sections + solid_sections)
+        wide = max(n_points, n_conn) > _INT32_MAX
+        points, nid, cells_arr, offsets_arr, celltypes_arr, part_ids = self._deck.to_vtk(
+            node_sections, shell_sections, solid_sections, wide
+        )
 
         grid = UnstructuredGrid()
-        grid.points = pv.pyvista_ndarray(node_section.coordinates)
+        grid.points = pv.pyvista_ndarray(points)
 
         # VTK 9.6.2 can store one cell width in place of an offset per cell,
         # which is an array shorter by n_cells + 1 to build and to hold. Decks
@@ -300,11 +1241,191 @@ class Deck:
         grid.SetCells(vtk_cell_type, vtk_cells)
 
         # add part and node ids
-        grid.cell_data["Part ID"] = np.hstack(part_ids)
-        grid.point_data["Node ID"] = node_section.nid
+        grid.cell_data["Part ID"] = part_ids
+        grid.point_data["Node ID"] = nid
 
         return grid
 
+    def _index_node_ids(self) -> None:
+        """Index the node IDs once, on first use from any thread."""
+        if not self._node_ids_indexed:
+            with self._index_lock:
+                if not self._node_ids_indexed:
+                    self._deck.index_node_ids(list(self.node_sections))
+                    self._node_ids_indexed = True
+
+    def _index_element_ids(self) -> None:
+        """Index the element IDs once, on first use from any thread."""
+        if not self._element_ids_indexed:
+            with self._index_lock:
+                if not self._element_ids_indexed:
+                    self._deck.index_element_ids(
+                        list(self.element_shell_sections), list(self.element_solid_sections)
+                    )
+                    self._element_ids_indexed = True
+
+    def node_index(self, nid: ArrayLike) -> NDArray[np.int64]:
+        """Return the index of each node ID.
+
+        Nodes are numbered in order across every node section, which is also
+        the order of the points of :func:`Deck.to_grid`.
+
+        Parameters
+        ----------
+        nid : array_like[int]
+            Node IDs to look up.
+
+        Returns
+        -------
+        numpy.ndarray[numpy.int64]
+            Index of each node ID, or ``-1`` for an ID that isn't in the deck.
+
+        Notes
+        -----
+        The index is built on first use. Decks with mostly contiguous IDs are
+        indexed with a table and sparse ones with a hash table, so its memory
+        is proportional to the number of nodes rather than the largest ID. An
+        ID repeated across node sections resolves to its last node.
+
+        Examples
+        --------
+        >>> import lsdyna_mesh_reader
+        >>> from lsdyna_mesh_reader import examples
+        >>> deck = lsdyna_mesh_reader.Deck(examples.birdball)
+        >>> deck.node_index([1344, 0])
+        array([1280,   -1])
+
+        """
+        self._index_node_ids()
+        ids, out_of_range = _int32_ids(nid)
+        index = self._deck.node_index(ids.ravel()).reshape(ids.shape)
+        # no node has an ID outside the range of int32
+        if out_of_range is not None:
+            index[out_of_range] = -1
+        return index
+
+    def element_index(self, eid: ArrayLike) -> Tuple[NDArray[np.int32], NDArray[np.int32]]:
+        """Return the section and row of each element ID.
+
+        Sections are numbered across the shell sections followed by the solid
+        sections, which is also the order of the cells of
+        :func:`Deck.to_grid`.
+
+        Parameters
+        ----------
+        eid : array_like[int]
+            Element IDs to look up.
+
+        Returns
+        -------
+        numpy.ndarray[numpy.int32]
+            Index of the section of each element within
+            ``element_shell_sections`` followed by ``element_solid_sections``,
+            or ``-1`` for an ID that isn't in the deck.
+        numpy.ndarray[numpy.int32]
+            Row of each element within its section, or ``-1`` for an ID that
+            isn't in the deck.
+
+        Notes
+        -----
+        The index is built on first use, like the one of
+        :func:`Deck.node_index`. An ID repeated across element sections
+        resolves to its last element.
+
+        Examples
+        --------
+        >>> import lsdyna_mesh_reader
+        >>> from lsdyna_mesh_reader import examples
+        >>> deck = lsdyna_mesh_reader.Deck(examples.wheel)
+        >>> section, row = deck.element_index([1, 2])
+
+        """
+        self._index_element_ids()
+        ids, out_of_range = _int32_ids(eid)
+        section, row = self._deck.element_index(ids.ravel())
+        section, row = section.reshape(ids.shape), row.reshape(ids.shape)
+        if out_of_range is not None:
+            section[out_of_range] = row[out_of_range] = -1
+        return section, row
+
+    def extract_parts(
+        self,
+        pid: ArrayLike,
+        renumber: bool = False,
+        filename: Union[str, Path, None] = None,
+        long_format: bool = False,
+    ) -> Tuple[List[NodeSection], List[ElementShellSection], List[ElementSolidSection]]:
+        """Extract the elements of some parts and the nodes they reference.
+
+        Parameters
+        ----------
+        pid : array_like[int]
+            Part IDs to extract.
+        renumber : bool, default: False
+            Number the extracted nodes and elements from 1, nodes in deck
+            order and elements in order with shells before solids, rather
+            than keeping their IDs.
+        filename : str | pathlib.Path, optional
+            Also write the extracted sections to a new, standalone deck. Thick
+            shells are written as ``*ELEMENT_TSHELL`` and other solids as
+            ``*ELEMENT_SOLID``.
+        long_format : bool, default: False
+            Write ``filename`` in long format. See :func:`write_deck`.
+
+        Returns
+        -------
+        list[NodeSection]
+            The referenced nodes, as a single section.
+        list[ElementShellSection]
+            Selected elements of each shell section that has any.
+        list[ElementSolidSection]
+            Selected elements of each solid and thick shell section that has
+            any.
+
+        Notes
+        -----
+        Nodes are found through the node ID index of :func:`Deck.node_index`,
+        so only the element sections are scanned, and the work beyond that
+        scan is proportional to the size of the selection.
+
+        Examples
+        --------
+        Write part 2 of a deck to a new deck.
+
+        >>> import lsdyna_mesh_reader
+        >>> from lsdyna_mesh_reader import examples
+        >>> deck = lsdyna_mesh_reader.Deck(examples.birdball)
+        >>> nodes, shells, solids = deck.extract_parts([2], filename="part_2.k")
+        >>> len(nodes[0]), len(shells[0])
+        (121, 100)
+
+        """
+        self._index_node_ids()
+        shell_sections = list(self.element_shell_sections)
+        solid_sections = list(self.element_solid_sections)
+        part_ids = _part_ids(pid)
+        nodes, shells, solids = self._deck.extract_parts(
+            list(self.node_sections), shell_sections, solid_sections, part_ids, renumber
+        )
+
+        if filename is not None:
+            # keep thick shells as thick shells; empty sections are skipped
+            solid_names = [self._keywords[i].name for i in self._deck.element_solid_keywords]
+            is_tshell = [name.startswith("*ELEMENT_TSHELL") for name in solid_names]
+            write_deck(
+                filename,
+                nodes,
+                shell_sections=shells,
+                solid_sections=[sec for sec, tshell in zip(solids, is_tshell) if not tshell],
+                tshell_sections=[sec for sec, tshell in zip(solids, is_tshell) if tshell],
+                long_format=long_format,
+                num_threads=self.num_threads,
+            )
+
+        shells = [section for section in shells if len(section)]
+        solids = [section for section in solids if len(section)]
+        return nodes, shells, solids
+
     def overwrite_node_section(
         self, filename: Union[str, Path], nodes: NDArray[np.float64]
     ) -> None:
@@ -321,7 +1442,10 @@ class Deck:
 
         Notes
         -----
-        Overwrites the first node section.
+        Overwrites the first node section. When that section is in an
+        included file, the new file is a copy of the included file rather
+        than of the deck. See :func:`Deck.overwrite_node_sections` to
+        overwrite every node section.
 
         Examples
         --------
@@ -348,9 +1472,116 @@ class Deck:
                 f"nodes in the node section ({nsec.nid.size})"
             )
 
-        filename = str(filename)
-        shutil.copy(self._filename, filename)
-        overwrite_node_section(filename, nsec.fpos, nodes)
+        self._deck.overwrite_node_sections(
+            str(filename), [0], np.ascontiguousarray(nodes, dtype=np.float64)
+        )
+
+    def overwrite_node_sections(self, filename: Union[str, Path], nodes: ArrayLike) -> None:
+        """Create a new deck file with every node section overwritten.
+
+        Parameters
+        ----------
+        filename : str | pathlib.Path
+            Path to the new file.
+        nodes : array_like[float]
+            ``(n_nodes, 3)`` new node coordinates of every node section in
+            turn, which is also the order of the points of
+            :func:`Deck.to_grid`.
+
+        Notes
+        -----
+        The file containing the node sections is copied, sharing its blocks
+        where the filesystem supports it, and the coordinates are written in
+        place into the copy's cards, in parallel according to
+        :attr:`Deck.num_threads`. Every node section must be in the same file,
+        and each card must already be wide enough to hold its three
+        coordinates, so cards in comma separated free format or with blank
+        trailing coordinates can't be overwritten.
+
+        Examples
+        --------
+        >>> import lsdyna_mesh_reader
+        >>> from lsdyna_mesh_reader import examples
+        >>> deck = lsdyna_mesh_reader.Deck(examples.birdball)
+        >>> grid = deck.to_grid()
+        >>> deck.overwrite_node_sections("new_deck.k", grid.points * 2)
+
+        """
+        if not self.node_sections:
+            raise RuntimeError("This deck is missing a node section")
+
+        nodes = np.ascontiguousarray(nodes, dtype=np.float64)
+        if nodes.ndim != 2 or nodes.shape[1] != 3:
+            raise ValueError(f"Expected `nodes` to contain 3D coordinates, not {nodes.shape}")
+
+        sections = list(range(len(self.node_sections)))
+        self._deck.overwrite_node_sections(str(filename), sections, nodes)
+
+    def write_node_variants(
+        self,
+        filenames: Sequence[Union[str, Path]],
+        nodes: Union[ArrayLike, Iterable[ArrayLike]],
+    ) -> None:
+        """Write copies of the deck that differ only in their node coordinates.
+
+        Parameters
+        ----------
+        filenames : sequence[str | pathlib.Path]
+            Path of each new file.
+        nodes : array_like[float] | iterable[array_like[float]]
+            ``(n_files, n_nodes, 3)`` coordinates of every node section of
+            each file, like the ``nodes`` of
+            :func:`Deck.overwrite_node_sections`, or an iterable of
+            ``(n_nodes, 3)`` arrays, one for each file, so the coordinates of
+            every file don't have to be held at once.
+
+        Notes
+        -----
+        This is intended for design of experiments and shape optimization
+        studies, which need many copies of the same deck. The coordinate
+        fields of the deck are located once, after which each file is written
+        in a single pass, with several files written at a time according to
+        :attr:`Deck.num_threads`. The same limitations as
+        :func:`Deck.overwrite_node_sections` apply.
+
+        Examples
+        --------
+        >>> import numpy as np
+        >>> import lsdyna_mesh_reader
+        >>> from lsdyna_mesh_reader import examples
+        >>> deck = lsdyna_mesh_reader.Deck(examples.birdball)
+        >>> points = deck.to_grid().points
+        >>> scales = np.linspace(0.9, 1.1, 10)
+        >>> filenames = [f"variant_{i}.k" for i in range(scales.size)]
+        >>> deck.write_node_variants(filenames, points * scales[:, None, None])
+
+        """
+        if not self.node_sections:
+            raise RuntimeError("This deck is missing a node section")
+        filenames = [str(filename) for filename in filenames]
+
+        if isinstance(nodes, np.ndarray):
+            batches: Iterable[ArrayLike] = [nodes]
+        else:
+            # write as many files at a time as there are threads
+            batch_size = self.num_threads if self.num_threads > 0 else os.cpu_count() or 1
+            batches = _batched(nodes, batch_size)
+
+        n_written = 0
+        for batch in batches:
+            batch = np.ascontiguousarray(batch, dtype=np.float64)
+            if batch.ndim != 3 or batch.shape[2] != 3:
+                raise ValueError(
+                    f"Expected `nodes` to contain sets of 3D coordinates, not {batch.shape}"
+                )
+            batch_filenames = filenames[n_written : n_written + batch.shape[0]]
+            if len(batch_filenames) != batch.shape[0]:
+                raise ValueError("Expected one set of node coordinates for each filename")
+            self._deck.write_node_variants(batch_filenames, batch)
+            n_written += batch.shape[0]
+
+        if n_written != len(filenames):
+            raise ValueError("Expected one set of node coordinates for each filename")
 
     def __repr__(self) -> str:
         lines = ["LSDYNA Deck with:"]
@@ -359,3 +1590,250 @@ class Deck:
         lines.append(f"  Element Shell sections:     {len(self.element_shell_sections)}")
 
         return "\n".join(lines)
+
+
+def write_deck(
+    filename: Union[str, Path],
+    node_sections: Sequence[NodeSection] = (),
+    shell_sections: Sequence[ElementShellSection] = (),
+    solid_sections: Sequence[ElementSolidSection] = (),
+    tshell_sections: Sequence[ElementSolidSection] = (),
+    long_format: bool = False,
+    num_threads: int = 1,
+) -> None:
+    """Write a new deck of node and element sections.
+
+    Parameters
+    ----------
+    filename : str | pathlib.Path
+        Path to the new deck.
+    node_sections : sequence[NodeSection], optional
+        Sections written as ``*NODE`` blocks.
+    shell_sections : sequence[ElementShellSection], optional
+        Sections written as ``*ELEMENT_SHELL`` blocks of four nodes per
+        element.
+    solid_sections : sequence[ElementSolidSection], optional
+        Sections written as ``*ELEMENT_SOLID`` blocks of eight nodes per
+        element.
+    tshell_sections : sequence[ElementSolidSection], optional
+        Sections written as ``*ELEMENT_TSHELL`` blocks of eight nodes per
+        element.
+    long_format : bool, default: False
+        Write the cards in long format, with 20 character fields, and begin
+        the deck with ``*KEYWORD LONG=Y``. Otherwise the cards are in the
+        standard fixed width format, where IDs must fit in 8 characters.
+    num_threads : int, default: 1
+        Number of threads used to format the cards. Use ``0`` or a negative
+        value to use every available core.
+
+    Notes
+    -----
+    Sections may be ones read from a deck or built from arrays, such as
+    ``NodeSection(nid, coordinates)``. Elements with fewer nodes than a card
+    holds repeat their last node, as triangles and tetrahedra do in a deck.
+
+    The cards are formatted in blocks, several at a time when ``num_threads``
+    isn't 1, and the blocks are written to the file in order.
+
+    Examples
+    --------
+    Write the mesh of a deck to a new deck in long format.
+
+    >>> import lsdyna_mesh_reader
+    >>> from lsdyna_mesh_reader import examples
+    >>> deck = lsdyna_mesh_reader.Deck(examples.birdball)
+    >>> lsdyna_mesh_reader.write_deck(
+    ...     "mesh.k",
+    ...     deck.node_sections,
+    ...     shell_sections=deck.element_shell_sections,
+    ...     solid_sections=deck.element_solid_sections,
+    ...     long_format=True,
+    ... )
+
+    Write a single quadrilateral.
+
+    >>> import numpy as np
+    >>> from lsdyna_mesh_reader.deck import ElementShellSection, NodeSection
+    >>> nodes = NodeSection(
+    ...     np.arange(1, 5, dtype=np.int32),
+    ...     np.array([[0, 0, 0], [1, 0, 0], [1, 1, 0], [0, 1, 0]], dtype=float),
+    ... )
+    >>> shells = ElementShellSection(
+    ...     np.array([1], dtype=np.int32),
+    ...     np.array([1], dtype=np.int32),
+    ...     np.arange(1, 5, dtype=np.int32),
+    ...     np.array([0, 4], dtype=np.int32),
+    ... )
+    >>> lsdyna_mesh_reader.write_deck("quad.k", [nodes], shell_sections=[shells])
+
+    """
+    _write_deck(
+        str(filename),
+        list(node_sections),
+        list(shell_sections),
+        list(solid_sections),
+        list(tshell_sections),
+        long_format,
+        num_threads,
+    )
+
+
+class NodeChunk(NamedTuple):
+    """Nodes read from a section of a deck by :func:`iter_nodes`."""
+
+    #: Index of the ``*NODE`` section within the deck.
+    section: int
+    #: ``(n,)`` node IDs.
+    nid: NDArray[np.int32]
+    #: ``(n, 3)`` node coordinates.
+    coordinates: NDArray[np.float64]
+    #: ``(n,)`` translational constraints.
+    tc: NDArray[np.int32]
+    #: ``(n,)`` rotational constraints.
+    rc: NDArray[np.int32]
+
+
+class ElementChunk(NamedTuple):
+    """Elements read from a section of a deck by :func:`iter_elements`."""
+
+    #: Index of the element section within the deck, counting only the
+    #: sections that are read.
+    section: int
+    #: Keyword of the section, such as ``"*ELEMENT_SHELL"``.
+    keyword: str
+    #: ``(n,)`` element IDs.
+    eid: NDArray[np.int32]
+    #: ``(n,)`` part IDs.
+    pid: NDArray[np.int32]
+    #: ``(n, num_nodes)`` node IDs of each element, four for shells and eight
+    #: for solids and thick shells.
+    node_ids: NDArray[np.int32]
+
+
+def iter_nodes(filename: Union[str, Path], chunk_rows: int = 1_000_000) -> Iterator[NodeChunk]:
+    """Iterate over the nodes of a deck a chunk at a time.
+
+    Parameters
+    ----------
+    filename : str | pathlib.Path
+        Path to the deck.
+    chunk_rows : int, default: 1_000_000
+        Most nodes in each chunk.
+
+    Yields
+    ------
+    NodeChunk
+        Up to ``chunk_rows`` nodes of a ``*NODE`` section. A section larger
+        than ``chunk_rows`` is split over several chunks with the same
+        ``section``.
+
+    Notes
+    -----
+    Unlike :class:`Deck`, only one chunk of the deck is held in memory at a
+    time, so this reads decks larger than memory. The arrays of each chunk
+    are reused and overwritten by the next one, so copy them to keep them.
+
+    Files named in ``*INCLUDE`` keywords aren't read, nor are compressed
+    decks, which :class:`Deck` reads in memory.
+
+    Examples
+    --------
+    Find the bounds of the nodes of a deck.
+
+    >>> import numpy as np
+    >>> import lsdyna_mesh_reader
+    >>> from lsdyna_mesh_reader import examples
+    >>> lower = np.full(3, np.inf)
+    >>> for chunk in lsdyna_mesh_reader.iter_nodes(examples.birdball):
+    ...     lower = np.minimum(lower, chunk.coordinates.min(axis=0))
+
+    """
+    reader = _SectionReader(_check_uncompressed(filename), True, chunk_rows)
+    while True:
+        n = reader.next()
+        if not n:
+            return
+        yield NodeChunk(
+            reader.section,
+            reader.nid[:n],
+            reader.coordinates[:n],
+            reader.tc[:n],
+            reader.rc[:n],
+        )
+
+
+def iter_elements(
+    filename: Union[str, Path],
+    chunk_rows: int = 1_000_000,
+    element_keywords: Union[Sequence[str], None] = None,
+    exclude_element_keywords: Union[Sequence[str], None] = None,
+) -> Iterator[ElementChunk]:
+    """Iterate over the elements of a deck a chunk at a time.
+
+    Parameters
+    ----------
+    filename : str | pathlib.Path
+        Path to the deck.
+    chunk_rows : int, default: 1_000_000
+        Most elements in each chunk.
+    element_keywords : sequence[str], optional
+        Element keywords to read, any of ``"*ELEMENT_SHELL"``,
+        ``"*ELEMENT_SOLID"`` and ``"*ELEMENT_TSHELL"``. Defaults to all of
+        them.
+    exclude_element_keywords : sequence[str], optional
+        Element keywords to skip.
+
+    Yields
+    ------
+    ElementChunk
+        Up to ``chunk_rows`` elements of an element section. A section
+        larger than ``chunk_rows`` is split over several chunks with the
+        same ``section``.
+
+    Notes
+    -----
+    Unlike :class:`Deck`, only one chunk of the deck is held in memory at a
+    time, so this reads decks larger than memory. The arrays of each chunk
+    are reused and overwritten by the next one, so copy them to keep them.
+
+    Files named in ``*INCLUDE`` keywords aren't read, nor are compressed
+    decks, which :class:`Deck` reads in memory.
+
+    Examples
+    --------
+    Count the elements of each part of a deck.
+
+    >>> import collections
+    >>> import lsdyna_mesh_reader
+    >>> from lsdyna_mesh_reader import examples
+    >>> counts = collections.Counter()
+    >>> for chunk in lsdyna_mesh_reader.iter_elements(examples.birdball):
+    ...     counts.update(chunk.pid.tolist())
+
+    """
+    read_keywords = set(ELEMENT_KEYWORDS)
+    if element_keywords is not None:
+        read_keywords = set(_check_element_keywords(element_keywords))
+    if exclude_element_keywords is not None:
+        read_keywords -= set(_check_element_keywords(exclude_element_keywords))
+
+    reader = _SectionReader(
+        _check_uncompressed(filename),
+        False,
+        chunk_rows,
+        "*ELEMENT_SHELL" in read_keywords,
+        "*ELEMENT_SOLID" in read_keywords,
+        "*ELEMENT_TSHELL" in read_keywords,
+    )
+    while True:
+        n = reader.next()
+        if not n:
+            return
+        width = reader.num_nodes
+        yield ElementChunk(
+            reader.section,
+            reader.keyword,
+            reader.eid[:n],
+            reader.pid[:n],
+            reader.node_ids[: n * width].reshape(n, width),
+        )
@@ -0,0 +1,144 @@
+#ifndef THREAD_POOL_HEADER_H
+#define THREAD_POOL_HEADER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Resolve a requested number of threads. Anything less than one selects every
+// hardware thread available.
+inline size_t ResolveNumThreads(int num_threads) {
+  if (num_threads > 0) {
+    return static_cast<size_t>(num_threads);
+  }
+  size_t n_hw = std::thread::hardware_concurrency();
+  return n_hw ? n_hw : 1;
+}
+
+// Fixed size pool of worker threads.
+//
+// Tasks must not touch Python objects; they run without the GIL. Tasks must
+// not throw, so submit work through ParallelFor, which catches and rethrows
+// exceptions for its caller.
+class ThreadPool {
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable task_ready;
+  bool stopping = false;
+
+  void WorkerLoop() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        task_ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (stopping && tasks.empty()) {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop();
+      }
+
+      task();
+    }
+  }
+
+public:
+  explicit ThreadPool(size_t num_threads) {
+    workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++) {
+      workers.emplace_back([this] { WorkerLoop(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    task_ready.notify_all();
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t Size() const { return workers.size(); }
+
+  void Submit(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.push(std::move(task));
+    }
+    task_ready.notify_one();
+  }
+};
+
+// Call fn(i) for each i in [0, n) and wait for all of them. The first
+// exception thrown by fn is rethrown once they've finished.
+//
+// The calling thread claims indices along with the workers, so a call never
+// waits on a queued task: threads may share a pool, and pool tasks may call
+// ParallelFor on their own pool, as when one pool loads several decks.
+template <typename F> void ParallelFor(ThreadPool &pool, size_t n, F fn) {
+  // shared with the workers, which may only start after this call returns,
+  // by then without any index left to claim
+  struct Batch {
+    std::function<void(size_t)> fn;
+    size_t n = 0;
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable all_done;
+    size_t n_done = 0;
+    std::exception_ptr error;
+
+    void Run() {
+      for (size_t i = next++; i < n; i = next++) {
+        std::exception_ptr task_error;
+        try {
+          fn(i);
+        } catch (...) {
+          task_error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (task_error && !error) {
+          error = task_error;
+        }
+        if (++n_done == n) {
+          all_done.notify_all();
+        }
+      }
+    }
+  };
+  std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+  batch->fn = [&fn](size_t i) { fn(i); };
+  batch->n = n;
+
+  // the calling thread takes the place of one worker
+  size_t n_helpers = std::min(n, pool.Size()) - (n > 0);
+  for (size_t k = 0; k < n_helpers; k++) {
+    pool.Submit([batch] { batch->Run(); });
+  }
+  batch->Run();
+
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  batch->all_done.wait(lock, [&] { return batch->n_done == n; });
+  if (batch->error) {
+    std::rethrow_exception(batch->error);
+  }
+}
+
+#endif // THREAD_POOL_HEADER_H
@@ -1,15 +1,26 @@
 """Test lsdyna_mesh_reader deck reader."""
 
+from concurrent.futures import CancelledError, ThreadPoolExecutor
 from typing import List
 from pathlib import Path
+import gc
+import gzip
 import os
+import shutil
+import threading
 
 import pytest
 import numpy as np
 import pyvista as pv
 
 import lsdyna_mesh_reader
-from lsdyna_mesh_reader._deck import _Deck
+from lsdyna_mesh_reader._deck import (
+    ElementShellSection,
+    ElementSolidSection,
+    NodeSection,
+    _Deck,
+    _DeckLoader,
+)
 from lsdyna_mesh_reader import examples
 
 NODE_SECTION = """*NODE
@@ -306,3 +317,1291 @@ def test_to_grid_uses_int32(file_path: str) -> None:
     assert np.array_equal(grid.cells, wide.cells)
     assert np.array_equal(grid.offset, wide.offset)
     assert np.array_equal(grid.celltypes, wide.celltypes)
+
+
+def write_large_deck(filename: str, n_nodes: int = 40_000, seed: int = 0) -> None:
+    """Write a deck with sections large enough to be read in parallel."""
+    rng = np.random.default_rng(seed)
+    coord = rng.uniform(-1000, 1000, (n_nodes, 3))
+    tc = rng.integers(0, 8, n_nodes)
+    n_elem = n_nodes
+
+    lines = ["*KEYWORD", "*NODE", "$#   nid               x               y               z"]
+    for i in range(n_nodes):
+        if i % 9973 == 0:
+            lines.append("$ comment within the section")
+        x, y, z = coord[i]
+        tail = "" if i % 3 else f"{tc[i]:8d}{tc[i]:8d}"
+        lines.append(f"{i + 1:8d}{x:16.9E}{y:16.9E}{z:16.9E}{tail}")
+
+    for keyword, n_per in [("*ELEMENT_SHELL", 4), ("*ELEMENT_SOLID", 8)]:
+        lines.append(keyword)
+        conn = rng.integers(1, n_nodes + 1, (n_elem, n_per))
+        pid = rng.integers(1, 50, n_elem)
+        for i in range(n_elem):
+            lines.append(f"{i + 1:8d}{pid[i]:8d}" + "".join(f"{v:8d}" for v in conn[i]))
+
+    lines.append("*END")
+    with open(filename, "w") as fid:
+        fid.write("\n".join(lines) + "\n")
+
+
+@pytest.mark.parametrize("num_threads", [2, 4, 0])
+def test_read_parallel(tmp_path: Path, num_threads: int) -> None:
+    """Reading sections on several threads matches reading them on one."""
+    filename = str(tmp_path / "large.k")
+    write_large_deck(filename)
+
+    serial = lsdyna_mesh_reader.Deck(filename)
+    parallel = lsdyna_mesh_reader.Deck(filename, num_threads=num_threads)
+    assert parallel.num_threads == num_threads
+
+    assert len(parallel.node_sections) == len(serial.node_sections) == 1
+    for attr in ["nid", "coordinates", "tc", "rc"]:
+        assert np.array_equal(
+            getattr(parallel.node_sections[0], attr), getattr(serial.node_sections[0], attr)
+        )
+    assert parallel.node_sections[0].fpos == serial.node_sections[0].fpos
+
+    sections = zip(
+        parallel.element_shell_sections + parallel.element_solid_sections,
+        serial.element_shell_sections + serial.element_solid_sections,
+    )
+    for par_section, ser_section in sections:
+        for attr in ["eid", "pid", "node_ids", "node_id_offsets"]:
+            assert np.array_equal(getattr(par_section, attr), getattr(ser_section, attr))
+
+
+def test_num_threads_setter() -> None:
+    deck = lsdyna_mesh_reader.Deck(examples.birdball)
+    assert deck.num_threads == 1
+    deck.num_threads = 3
+    assert deck.num_threads == 3
+
+
+ELEMENT_SHELL_SECTION_IRREGULAR = """*ELEMENT_SHELL
+       1       2     -37     388     389     378
+       2       2
+       3       2     379     390     391
+4       2       380     391     392     381
+       5       2     381     392     393     393       0       0       0       0
+*END
+"""
+
+
+def test_element_section_irregular_fields(tmp_path: Path) -> None:
+    """Negative, left justified, and missing fields are all decoded."""
+    filename = str(tmp_path / "tmp.k")
+    with open(filename, "w") as fid:
+        fid.write(ELEMENT_SHELL_SECTION_IRREGULAR)
+
+    deck = _Deck(filename)
+    deck.read_line()
+    deck.read_element_shell_section()
+    section = deck.element_shell_sections[0]
+
+    assert np.array_equal(section.eid, range(1, 6))
+    assert np.array_equal(section.pid, [2] * 5)
+    expected = [
+        [-37, 388, 389, 378],
+        [0, 0, 0, 0],  # nodes past the end of the line are zero
+        [379, 390, 391, 0],
+        [380, 391, 392, 381],
+        [381, 392, 393, 393],
+    ]
+    assert np.array_equal(section.node_ids, np.ravel(expected))
+
+
+def test_node_coordinates_correctly_rounded(tmp_path: Path) -> None:
+    """Coordinates match Python's float() bit for bit across formats."""
+    rng = np.random.default_rng(0)
+    n_nodes = 333_334
+    mantissa = rng.uniform(-10, 10, size=(n_nodes, 3))
+    exponent = rng.integers(-30, 30, size=(n_nodes, 3))
+    values = mantissa * 10.0**exponent
+    fixed = rng.uniform(-1e5, 1e5, size=(n_nodes, 3))
+
+    formats = ["{:16.9E}", "{:16.10g}", "{:16.8f}"]
+    fields = []
+    for i in range(n_nodes):
+        fmt = formats[i % 3]
+        row = fixed[i] if fmt == "{:16.8f}" else values[i]
+        fields.append([fmt.format(value) for value in row])
+
+    filename = str(tmp_path / "tmp.k")
+    with open(filename, "w") as fid:
+        fid.write("*NODE\n")
+        for i, row in enumerate(fields):
+            fid.write(f"{i + 1:8d}{''.join(row)}       0       0\n")
+        fid.write("*END\n")
+
+    deck = _Deck(filename)
+    deck.read_line()
+    deck.read_node_section()
+    coord = deck.node_sections[0].coordinates
+
+    expected = np.array([[float(field) for field in row] for row in fields])
+    assert np.array_equal(coord.view(np.uint64), expected.view(np.uint64))
+
+
+def test_node_coordinates_fortran_formats(tmp_path: Path) -> None:
+    """D exponents, implied exponents, and left justified fields."""
+    node_section = """*NODE
+       1         1.5D+03        -2.5d-02           1.5-3
+       2            1.E2            -.25               1
+       31.5             1.234567890123451e-300                 0       0
+       4-2.309401035E+00
+*END
+"""
+    filename = str(tmp_path / "tmp.k")
+    with open(filename, "w") as fid:
+        fid.write(node_section)
+
+    deck = _Deck(filename)
+    deck.read_line()
+    deck.read_node_section()
+    coord = deck.node_sections[0].coordinates
+
+    expected = [
+        [1.5e03, -2.5e-02, 1.5e-3],
+        [1.0e2, -0.25, 1.0],
+        [1.5, 1.23456789012345, 1e-300],
+        [-2.309401035, 0.0, 0.0],
+    ]
+    assert np.array_equal(coord, expected)
+
+
+def test_node_short_cards(tmp_path: Path) -> None:
+    """Fields cut short by the end of a card are read up to it, and missing
+    fields are zero, rather than read from the next card."""
+    node_section = (
+        "*NODE\n"
+        "       1             1.0\n"
+        "       2             2.0             3.0             4.0       1\n"
+        "       3             5.0             6.0             7.0       2       3\n"
+        "       4\n"
+        "       5             8.0             9.0            10.0\n"
+        "       6             1.5"
+    )
+    filename = tmp_path / "tmp.k"
+    filename.write_text(node_section)
+
+    expected_coord = [[1, 0, 0], [2, 3, 4], [5, 6, 7], [0, 0, 0], [8, 9, 10], [1.5, 0, 0]]
+    decks = [
+        lsdyna_mesh_reader.Deck(filename),
+        lsdyna_mesh_reader.Deck.from_buffer(node_section.encode()),
+    ]
+    for deck in decks:
+        section = deck.node_sections[0]
+        assert section.nid.tolist() == [1, 2, 3, 4, 5, 6]
+        assert np.array_equal(section.coordinates, expected_coord)
+        assert section.tc.tolist() == [0, 1, 2, 0, 0, 0]
+        assert section.rc.tolist() == [0, 0, 3, 0, 0, 0]
+
+    chunk = next(lsdyna_mesh_reader.iter_nodes(filename, chunk_rows=10))
+    assert np.array_equal(chunk.coordinates, expected_coord)
+
+
+@pytest.mark.parametrize("file_path", get_example_files())
+def test_keywords(file_path: str) -> None:
+    """The keyword index matches a line by line scan of the file."""
+    with open(file_path, "rb") as fid:
+        data = fid.read()
+
+    expected = []
+    offset = 0
+    for line_number, line in enumerate(data.split(b"\n"), start=1):
+        if line.startswith(b"*"):
+            expected.append((line.split()[0].decode(), offset, line_number))
+        offset += len(line) + 1
+
+    deck = lsdyna_mesh_reader.Deck(file_path, lazy=True)
+    keywords = deck.keywords
+    assert [(kw.name, kw.offset, kw.line) for kw in keywords] == expected
+
+    ends = [kw.offset for kw in keywords[1:]] + [len(data)]
+    assert [kw.offset + kw.length for kw in keywords] == ends
+    for kw in keywords:
+        assert data[kw.offset : kw.offset + len(kw.name)].decode() == kw.name
+
+
+def test_keywords_parallel(tmp_path: Path) -> None:
+    filename = str(tmp_path / "large.k")
+    write_large_deck(filename)
+
+    serial = lsdyna_mesh_reader.Deck(filename, lazy=True).keywords
+    parallel = lsdyna_mesh_reader.Deck(filename, num_threads=4, lazy=True).keywords
+    assert [(kw.name, kw.offset, kw.length, kw.line) for kw in parallel] == [
+        (kw.name, kw.offset, kw.length, kw.line) for kw in serial
+    ]
+
+
+@pytest.mark.parametrize("file_path", get_example_files())
+def test_lazy(file_path: str) -> None:
+    """Sections loaded on demand match the sections read eagerly."""
+    deck = lsdyna_mesh_reader.Deck(file_path)
+    lazy_deck = lsdyna_mesh_reader.Deck(file_path, lazy=True)
+    assert str(lazy_deck) == str(deck)
+
+    # nothing is parsed until a section is accessed
+    assert not lazy_deck._deck.node_sections
+    assert not any(lazy_deck.node_sections._sections)
+
+    for section, lazy_section in zip(deck.node_sections, lazy_deck.node_sections):
+        assert lazy_section.fpos == section.fpos
+        assert np.array_equal(lazy_section.nid, section.nid)
+        assert np.array_equal(lazy_section.coordinates, section.coordinates)
+        assert np.array_equal(lazy_section.tc, section.tc)
+        assert np.array_equal(lazy_section.rc, section.rc)
+
+    for sections, lazy_sections in [
+        (deck.element_solid_sections, lazy_deck.element_solid_sections),
+        (deck.element_shell_sections, lazy_deck.element_shell_sections),
+    ]:
+        for section, lazy_section in zip(sections, lazy_sections):
+            assert np.array_equal(lazy_section.eid, section.eid)
+            assert np.array_equal(lazy_section.pid, section.pid)
+            assert np.array_equal(lazy_section.node_ids, section.node_ids)
+            assert np.array_equal(lazy_section.node_id_offsets, section.node_id_offsets)
+
+    # each section is parsed once and then reused
+    if lazy_deck.node_sections:
+        assert lazy_deck.node_sections[0] is lazy_deck.node_sections[0]
+
+    lazy_deck.to_grid()._check_for_consistency()
+
+
+def test_lazy_single_section() -> None:
+    deck = lsdyna_mesh_reader.Deck(examples.birdball, lazy=True)
+    assert deck.element_shell_sections[-1].eid[-1] == 100
+    assert deck.element_shell_sections._sections[0] is not None
+    assert deck.node_sections._sections == [None]
+    assert deck.element_solid_sections._sections == [None]
+
+
+def _assert_decks_equal(deck: lsdyna_mesh_reader.Deck, other: lsdyna_mesh_reader.Deck) -> None:
+    assert [(kw.name, kw.offset, kw.length, kw.line, kw.filename) for kw in deck.keywords] == [
+        (kw.name, kw.offset, kw.length, kw.line, kw.filename) for kw in other.keywords
+    ]
+
+    assert len(deck.node_sections) == len(other.node_sections)
+    for section, other_section in zip(deck.node_sections, other.node_sections):
+        assert section.fpos == other_section.fpos
+        assert section.filename == other_section.filename
+        assert np.array_equal(section.nid, other_section.nid)
+        assert np.array_equal(section.coordinates, other_section.coordinates)
+        assert np.array_equal(section.tc, other_section.tc)
+        assert np.array_equal(section.rc, other_section.rc)
+
+    for sections, other_sections in [
+        (deck.element_solid_sections, other.element_solid_sections),
+        (deck.element_shell_sections, other.element_shell_sections),
+    ]:
+        assert len(sections) == len(other_sections)
+        for section, other_section in zip(sections, other_sections):
+            assert str(section) == str(other_section)
+            assert section.fpos == other_section.fpos
+            assert section.filename == other_section.filename
+            assert np.array_equal(section.eid, other_section.eid)
+            assert np.array_equal(section.pid, other_section.pid)
+            assert np.array_equal(section.node_ids, other_section.node_ids)
+            assert np.array_equal(section.node_id_offsets, other_section.node_id_offsets)
+
+
+@pytest.mark.parametrize("file_path", get_example_files())
+def test_cache(tmp_path: Path, file_path: str) -> None:
+    filename = str(tmp_path / os.path.basename(file_path))
+    shutil.copy(file_path, filename)
+    cache_path = filename + ".lsdcache"
+
+    deck = lsdyna_mesh_reader.Deck(filename, cache=True)
+    assert not deck._from_cache
+    assert os.path.isfile(cache_path)
+
+    cached = lsdyna_mesh_reader.Deck(filename, cache=True)
+    assert cached._from_cache
+    _assert_decks_equal(cached, deck)
+    cached.to_grid()._check_for_consistency()
+
+    # cached arrays are copy on write and modifying them leaves the cache as is
+    if cached.node_sections:
+        cached.node_sections[0].coordinates[:] = 0
+        reloaded = lsdyna_mesh_reader.Deck(filename, cache=True)
+        assert reloaded._from_cache
+        _assert_decks_equal(reloaded, deck)
+
+
+def test_cache_path(tmp_path: Path) -> None:
+    cache_path = tmp_path / "birdball.cache"
+    deck = lsdyna_mesh_reader.Deck(examples.birdball, cache=cache_path, num_threads=2)
+    assert cache_path.is_file()
+
+    # the cache doesn't depend on the number of threads
+    cached = lsdyna_mesh_reader.Deck(examples.birdball, cache=str(cache_path), lazy=True)
+    assert cached._from_cache
+    _assert_decks_equal(cached, deck)
+
+
+def test_cache_stale(tmp_path: Path) -> None:
+    filename = str(tmp_path / "birdball.k")
+    shutil.copy(examples.birdball, filename)
+    deck = lsdyna_mesh_reader.Deck(filename, cache=True)
+
+    # a new modification time invalidates the cache
+    stat = os.stat(filename)
+    os.utime(filename, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+    assert not lsdyna_mesh_reader.Deck(filename, cache=True)._from_cache
+    assert lsdyna_mesh_reader.Deck(filename, cache=True)._from_cache
+
+    # as do new contents of the same size and modification time
+    stat = os.stat(filename)
+    with open(filename, "r+b") as fid:
+        fid.seek(-5, os.SEEK_END)
+        fid.write(b"*end\n")
+    os.utime(filename, ns=(stat.st_atime_ns, stat.st_mtime_ns))
+    assert not lsdyna_mesh_reader.Deck(filename, cache=True)._from_cache
+
+    # a deck with more nodes is reread rather than loaded from the cache
+    with open(filename, "r+b") as fid:
+        data = fid.read().replace(b"*ELEMENT_SOLID", NODE_SECTION[:-5].encode() + b"*ELEMENT_SOLID")
+        fid.seek(0)
+        fid.write(data)
+    updated = lsdyna_mesh_reader.Deck(filename, cache=True)
+    assert not updated._from_cache
+    assert len(updated.node_sections) == len(deck.node_sections) + 1
+
+
+def test_cache_corrupt(tmp_path: Path) -> None:
+    cache_path = tmp_path / "birdball.cache"
+    deck = lsdyna_mesh_reader.Deck(examples.birdball, cache=cache_path)
+
+    data = cache_path.read_bytes()
+    for corrupt in [b"", data[: len(data) // 2], b"\0" * len(data), data[:8] + b"\xff" + data[9:]]:
+        cache_path.write_bytes(corrupt)
+        reread = lsdyna_mesh_reader.Deck(examples.birdball, cache=cache_path)
+        assert not reread._from_cache
+        _assert_decks_equal(reread, deck)
+
+
+def test_cache_concurrent(tmp_path: Path) -> None:
+    """Threads writing the same cache at once each write a file of their own."""
+    cache_path = tmp_path / "birdball.cache"
+    n_threads = 8
+    barrier = threading.Barrier(n_threads, timeout=60)
+
+    def load(_: int) -> lsdyna_mesh_reader.Deck:
+        barrier.wait()
+        return lsdyna_mesh_reader.Deck(examples.birdball, cache=cache_path)
+
+    with ThreadPoolExecutor(n_threads) as executor:
+        decks = list(executor.map(load, range(n_threads)))
+    assert os.listdir(tmp_path) == [cache_path.name]
+    cached = lsdyna_mesh_reader.Deck(examples.birdball, cache=cache_path)
+    assert cached._from_cache
+    _assert_decks_equal(cached, decks[0])
+
+
+def test_cache_unwritable(tmp_path: Path) -> None:
+    cache_path = tmp_path / "missing" / "birdball.cache"
+    with pytest.warns(UserWarning, match="Unable to write the deck cache"):
+        deck = lsdyna_mesh_reader.Deck(examples.birdball, cache=cache_path)
+    assert len(deck.node_sections) == 1
+
+
+def write_include_deck(path: Path) -> str:
+    """Write a deck including nodes and elements from other files.
+
+    ``nodes.k`` is included twice and ``sub/solid.k`` includes the deck
+    itself, so each must only be read once.
+    """
+    (path / "parts").mkdir()
+    (path / "sub").mkdir()
+    (path / "nodes.k").write_text(NODE_SECTION.replace("*END\n", ""))
+    (path / "parts" / "shell.k").write_text(ELEMENT_SHELL_SECTION.replace("*END\n", ""))
+    (path / "sub" / "common.k").write_text(
+        "*NODE\n      10             5.0             5.0             5.0\n"
+    )
+    (path / "sub" / "solid.k").write_text(
+        "*INCLUDE\n../nodes.k\n*INCLUDE\ncommon.k\n*INCLUDE\n../master.k\n"
+        + ELEMENT_SOLID_SECTION.replace("*END\n", "")
+    )
+
+    filename = str(path / "master.k")
+    with open(filename, "w") as fid:
+        fid.write("*KEYWORD\n*INCLUDE_PATH_RELATIVE\nparts\n")
+        fid.write("*INCLUDE\n$ comment\nnodes.k\n")
+        fid.write("*INCLUDE\nshell.k\n")
+        fid.write("*INCLUDE\nsub/so +\nlid.k\n")  # continued filename
+        fid.write("*END\n")
+    return filename
+
+
+@pytest.mark.parametrize("num_threads", [1, 4])
+def test_include(tmp_path: Path, num_threads: int) -> None:
+    filename = write_include_deck(tmp_path)
+    deck = lsdyna_mesh_reader.Deck(filename, num_threads=num_threads)
+
+    nodes = os.path.realpath(tmp_path / "nodes.k")
+    shell = os.path.realpath(tmp_path / "parts" / "shell.k")
+    solid = os.path.realpath(tmp_path / "sub" / "solid.k")
+    common = os.path.realpath(tmp_path / "sub" / "common.k")
+    assert deck.filenames == [filename, nodes, shell, solid, common]
+
+    # included keywords follow the *INCLUDE that first includes them
+    assert [(kw.name, kw.filename) for kw in deck.keywords] == [
+        ("*KEYWORD", filename),
+        ("*INCLUDE_PATH_RELATIVE", filename),
+        ("*INCLUDE", filename),
+        ("*NODE", nodes),
+        ("*INCLUDE", filename),
+        ("*ELEMENT_SHELL", shell),
+        ("*INCLUDE", filename),
+        ("*INCLUDE", solid),
+        ("*INCLUDE", solid),
+        ("*NODE", common),
+        ("*INCLUDE", solid),
+        ("*ELEMENT_SOLID", solid),
+        ("*END", filename),
+    ]
+
+    assert len(deck.node_sections) == 2
+    assert deck.node_sections[0].filename == nodes
+    assert deck.node_sections[0].fpos == len("*NODE\n")
+    assert np.allclose(deck.node_sections[0].coordinates, NODE_SECTION_COORD_EXPECTED)
+    assert deck.node_sections[1].filename == common
+    assert deck.node_sections[1].nid.tolist() == [10]
+
+    solid_section = deck.element_solid_sections[0]
+    assert solid_section.filename == solid
+    assert solid_section.fpos == len(
+        "*INCLUDE\n../nodes.k\n*INCLUDE\ncommon.k\n*INCLUDE\n../master.k\n*ELEMENT_SOLID\n"
+    )
+    assert solid_section.eid.tolist() == [1, 2, 3]
+    assert deck.element_shell_sections[0].filename == shell
+
+    lazy = lsdyna_mesh_reader.Deck(filename, num_threads=num_threads, lazy=True)
+    _assert_decks_equal(lazy, deck)
+
+
+def test_include_path(tmp_path: Path) -> None:
+    (tmp_path / "lib").mkdir()
+    (tmp_path / "lib" / "nodes.k").write_text(NODE_SECTION.replace("*END\n", ""))
+    filename = tmp_path / "deck.k"
+    filename.write_text(f"*INCLUDE_PATH\n{tmp_path / 'lib'}\n*INCLUDE\nnodes.k\n*END\n")
+
+    deck = lsdyna_mesh_reader.Deck(filename)
+    assert deck.node_sections[0].filename == os.path.realpath(tmp_path / "lib" / "nodes.k")
+    assert np.allclose(deck.node_sections[0].coordinates, NODE_SECTION_COORD_EXPECTED)
+
+
+def test_include_missing(tmp_path: Path) -> None:
+    filename = tmp_path / "deck.k"
+    filename.write_text("*INCLUDE\nmissing.k\n" + NODE_SECTION)
+
+    with pytest.warns(UserWarning, match="Unable to locate the included file missing.k"):
+        deck = lsdyna_mesh_reader.Deck(filename, cache=True)
+    assert len(deck.node_sections) == 1
+
+    # the file may appear later, so the deck isn't cached
+    assert not os.path.isfile(str(filename) + ".lsdcache")
+
+
+def test_include_cache(tmp_path: Path) -> None:
+    filename = write_include_deck(tmp_path)
+    deck = lsdyna_mesh_reader.Deck(filename, cache=True)
+    assert not deck._from_cache
+
+    cached = lsdyna_mesh_reader.Deck(filename, cache=True)
+    assert cached._from_cache
+    assert cached.filenames == deck.filenames
+    _assert_decks_equal(cached, deck)
+
+    # changing an included file invalidates the cache
+    common = tmp_path / "sub" / "common.k"
+    common.write_text(common.read_text().replace("5.0", "6.0"))
+    stat = os.stat(common)
+    os.utime(common, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+    updated = lsdyna_mesh_reader.Deck(filename, cache=True)
+    assert not updated._from_cache
+    assert np.allclose(updated.node_sections[1].coordinates, 6.0)
+
+
+def test_overwrite_node_section_include(tmp_path: Path) -> None:
+    filename = write_include_deck(tmp_path)
+    deck = lsdyna_mesh_reader.Deck(filename)
+
+    # the first node section is in nodes.k, which is what gets copied
+    new_filename = str(tmp_path / "nodes_overwrite.k")
+    new_nodes = NODE_SECTION_COORD_EXPECTED + 1
+    deck.overwrite_node_section(new_filename, new_nodes)
+
+    deck_new = lsdyna_mesh_reader.Deck(new_filename)
+    assert np.allclose(deck_new.node_sections[0].coordinates, new_nodes)
+
+
+@pytest.mark.parametrize("num_threads", [1, 2])
+def test_overwrite_node_sections(tmp_path: Path, num_threads: int) -> None:
+    long_cards = [
+        _long_card(i + 10, *coord, 0, 0) for i, coord in enumerate(NODE_SECTION_COORD_EXPECTED)
+    ]
+    filename = tmp_path / "two.k"
+    filename.write_text(
+        NODE_SECTION.replace("*END\n", "$ comment\n")
+        + "\n".join(["*NODE +", *long_cards, "*END\n"])
+    )
+    deck = lsdyna_mesh_reader.Deck(filename, num_threads=num_threads)
+
+    new_filename = tmp_path / "two_overwrite.k"
+    new_nodes = np.random.random((10, 3)) * 2000 - 1000
+    deck.overwrite_node_sections(new_filename, new_nodes)
+
+    deck_new = lsdyna_mesh_reader.Deck(new_filename)
+    coordinates = [section.coordinates for section in deck_new.node_sections]
+    assert np.allclose(np.vstack(coordinates), new_nodes)
+    for section, new_section in zip(deck.node_sections, deck_new.node_sections):
+        assert np.array_equal(new_section.nid, section.nid)
+        assert np.array_equal(new_section.tc, section.tc)
+        assert np.array_equal(new_section.rc, section.rc)
+
+    with pytest.raises(ValueError, match="must match the number of nodes"):
+        deck.overwrite_node_sections(new_filename, new_nodes[:-1])
+
+
+def test_overwrite_node_sections_include(tmp_path: Path) -> None:
+    deck = lsdyna_mesh_reader.Deck(write_include_deck(tmp_path))
+    new_nodes = np.zeros((sum(len(section) for section in deck.node_sections), 3))
+    with pytest.raises(ValueError, match="must be in the same file"):
+        deck.overwrite_node_sections(tmp_path / "overwrite.k", new_nodes)
+
+
+@pytest.mark.parametrize("long", [False, True])
+def test_overwrite_node_sections_precision(tmp_path: Path, long: bool) -> None:
+    """Written coordinates read back to within half a unit of their last digit."""
+    rng = np.random.default_rng(0)
+    exponents = np.repeat(np.arange(-300, 301), 5)
+    new_nodes = rng.uniform(1, 10, (exponents.size, 3)) * 10.0 ** exponents[:, None]
+    new_nodes *= rng.choice([-1, 1], new_nodes.shape)
+    new_nodes[:3] = [
+        [0.0, -0.0, 5e-324],
+        [1e-99, 9.9999999999e99, 1.7976931348623157e308],
+        [1, 2, 3],
+    ]
+
+    if long:
+        cards = [_long_card(i + 1, 0.0, 0.0, 0.0, 0, 0) for i in range(exponents.size)]
+        keyword, digits = "*NODE +", 14
+    else:
+        cards = [f"{i + 1:8d}{0.0:16.9E}{0.0:16.9E}{0.0:16.9E}" for i in range(exponents.size)]
+        keyword, digits = "*NODE", 10
+    filename = tmp_path / "nodes.k"
+    filename.write_text("\n".join([keyword, *cards, "*END\n"]))
+    deck = lsdyna_mesh_reader.Deck(filename)
+
+    new_filename = tmp_path / "nodes_overwrite.k"
+    deck.overwrite_node_sections(new_filename, new_nodes)
+    coordinates = lsdyna_mesh_reader.Deck(new_filename).node_sections[0].coordinates
+
+    # three digit exponents take the place of the last significant digit
+    magnitude = np.abs(new_nodes)
+    exponent = np.floor(np.log10(magnitude, where=magnitude > 0, out=np.zeros_like(magnitude)))
+    digits = np.where(np.abs(exponent) >= 100, digits - 1, digits)
+    tolerance = 0.5 * 10.0 ** (exponent - digits + 1) + 4 * magnitude * np.finfo(float).eps
+    assert (np.abs(coordinates - new_nodes) <= tolerance).all()
+
+
+@pytest.mark.parametrize("as_iterator", [False, True])
+def test_write_node_variants(tmp_path: Path, as_iterator: bool) -> None:
+    filename = tmp_path / "deck.k"
+    filename.write_text(
+        NODE_SECTION.replace("*END\n", "")
+        + ELEMENT_SHELL_SECTION.replace("*END\n", "")
+        + NODE_SECTION.replace("\n       ", "\n      1")
+    )
+    deck = lsdyna_mesh_reader.Deck(filename, num_threads=2)
+
+    nodes = np.random.random((3, 10, 3))
+    filenames = [tmp_path / f"variant_{i}.k" for i in range(nodes.shape[0])]
+    deck.write_node_variants(filenames, iter(nodes) if as_iterator else nodes)
+
+    # each variant matches the deck overwritten with its coordinates
+    for variant_filename, variant_nodes in zip(filenames, nodes):
+        expected = tmp_path / "expected.k"
+        deck.overwrite_node_sections(expected, variant_nodes)
+        assert variant_filename.read_bytes() == expected.read_bytes()
+
+    with pytest.raises(ValueError, match="for each filename"):
+        deck.write_node_variants(filenames[:2], nodes)
+    with pytest.raises(ValueError, match="must match the number of nodes"):
+        deck.write_node_variants(filenames, nodes[:, 1:])
+
+    # the deck itself, here through a link, can't be overwritten
+    contents = filename.read_bytes()
+    link = tmp_path / "link.k"
+    os.link(filename, link)
+    with pytest.raises(ValueError, match="over a file of the deck"):
+        deck.write_node_variants([filenames[0], link, filenames[2]], nodes)
+    assert filename.read_bytes() == contents
+
+
+def _long_card(*fields: float) -> str:
+    return "".join(f"{field:>20}" for field in fields)
+
+
+def test_long_format(tmp_path: Path) -> None:
+    node_cards = [
+        _long_card(i + 1, *coord, 0, 0) for i, coord in enumerate(NODE_SECTION_COORD_EXPECTED)
+    ]
+    solid_cards = [
+        _long_card(i + 1, 1, *elem) for i, elem in enumerate(ELEMENT_SOLID_SECTION_ELEMS)
+    ]
+    filename = tmp_path / "long.k"
+    filename.write_text(
+        "\n".join(
+            ["*KEYWORD LONG=Y", "*NODE", *node_cards, "*ELEMENT_SOLID", *solid_cards]
+            + ELEMENT_SHELL_SECTION.replace("*ELEMENT_SHELL", "*ELEMENT_SHELL -").splitlines()
+        )
+    )
+
+    deck = lsdyna_mesh_reader.Deck(filename)
+    assert np.allclose(deck.node_sections[0].coordinates, NODE_SECTION_COORD_EXPECTED)
+    assert np.allclose(deck.node_sections[0].nid, range(1, 6))
+    solid_section = deck.element_solid_sections[0]
+    assert np.allclose(solid_section.node_ids, np.ravel(ELEMENT_SOLID_SECTION_ELEMS))
+    shell_section = deck.element_shell_sections[0]
+    assert np.allclose(shell_section.node_ids, np.ravel(ELEMENT_SHELL_SECTION_ELEMS))
+
+    lazy = lsdyna_mesh_reader.Deck(filename, lazy=True)
+    _assert_decks_equal(lazy, deck)
+
+
+def test_keyword_format_suffix(tmp_path: Path) -> None:
+    filename = tmp_path / "suffix.k"
+    filename.write_text(
+        "*NODE +\n"
+        + _long_card(123456789, 1.0, 2.0, 3.0, 1, 2)
+        + "\n*ELEMENT_SHELL %\n"
+        + "".join(f"{field:>10}" for field in [1234567890, 1, 11, 12, 13, 14])
+        + "\n*END\n"
+    )
+
+    deck = lsdyna_mesh_reader.Deck(filename)
+    node_section = deck.node_sections[0]
+    assert node_section.nid.tolist() == [123456789]
+    assert np.allclose(node_section.coordinates, [[1.0, 2.0, 3.0]])
+    assert node_section.tc.tolist() == [1]
+    assert node_section.rc.tolist() == [2]
+
+    shell_section = deck.element_shell_sections[0]
+    assert shell_section.eid.tolist() == [1234567890]
+    assert shell_section.node_ids.tolist() == [11, 12, 13, 14]
+
+
+def test_free_format(tmp_path: Path) -> None:
+    filename = tmp_path / "free.k"
+    node_cards = NODE_SECTION.splitlines()
+    node_cards[2] = "2, -2.039600611, 2.039600611E+00,-2.039600611,0,3"
+    shell_cards = ELEMENT_SHELL_SECTION.splitlines()
+    shell_cards[1] = " 1, 2, 377, 388 ,389, 378"
+    filename.write_text("\n".join(node_cards[:-1] + shell_cards))
+
+    deck = lsdyna_mesh_reader.Deck(filename)
+    node_section = deck.node_sections[0]
+    assert np.allclose(node_section.coordinates, NODE_SECTION_COORD_EXPECTED)
+    assert np.allclose(node_section.tc, [0, 0, 1, 2, 0])
+    assert np.allclose(node_section.rc, [0, 3, 4, 0, 0])
+
+    shell_section = deck.element_shell_sections[0]
+    assert np.allclose(shell_section.eid, range(1, 6))
+    assert np.allclose(shell_section.node_ids, np.ravel(ELEMENT_SHELL_SECTION_ELEMS))
+
+
+def test_to_grid_node_sections(tmp_path: Path) -> None:
+    """Points come from every node section."""
+    node_lines = NODE_SECTION.splitlines()[1:-1]
+    filename = tmp_path / "split.k"
+    filename.write_text(
+        "\n".join(
+            ["*NODE", *node_lines[:2], "*NODE", *node_lines[2:], "*ELEMENT_SHELL"]
+            + [f"{1:8d}{1:8d}" + "".join(f"{nid:8d}" for nid in [5, 1, 2, 3])]
+            + [f"{2:8d}{1:8d}" + "".join(f"{nid:8d}" for nid in [3, 4, 5, 5])]
+        )
+    )
+
+    grid = lsdyna_mesh_reader.Deck(filename).to_grid()
+    assert np.allclose(grid.points, NODE_SECTION_COORD_EXPECTED)
+    assert grid.point_data["Node ID"].tolist() == [1, 2, 3, 4, 5]
+    assert grid.cell_connectivity.tolist() == [4, 0, 1, 2, 2, 3, 4]
+    assert grid.celltypes.tolist() == [pv.CellType.QUAD, pv.CellType.TRIANGLE]
+
+
+def test_to_grid_missing_node(tmp_path: Path) -> None:
+    filename = tmp_path / "missing.k"
+    filename.write_text(NODE_SECTION.replace("*END", ELEMENT_SHELL_SECTION))
+
+    deck = lsdyna_mesh_reader.Deck(filename)
+    with pytest.raises(RuntimeError, match="node ID 377"):
+        deck.to_grid()
+
+
+@pytest.mark.parametrize("offset", [0, 10_000_000])
+def test_node_index(tmp_path: Path, offset: int) -> None:
+    """Dense and sparse IDs, the latter prefixed as if by a part number."""
+    nid = np.array([3, 1, 7, 2, 9]) * (offset // 1_000_000 + 1) + offset
+    lines = ["*NODE"] + [f"{i:8d}{float(i):16.1f}" for i in nid[:2]]
+    lines += ["*NODE"] + [f"{i:8d}{float(i):16.1f}" for i in nid[2:]]
+    filename = tmp_path / "nodes.k"
+    filename.write_text("\n".join(lines) + "\n*END\n")
+
+    deck = lsdyna_mesh_reader.Deck(filename)
+    assert deck.node_index(nid).tolist() == list(range(5))
+    assert deck.node_index(nid[::-1].reshape(5, 1)).shape == (5, 1)
+    assert deck.node_index([nid.max() + 1, -1]).tolist() == [-1, -1]
+    # IDs far enough from the indexed ones to overflow their difference
+    assert deck.node_index([-(2**31), 2**31 - 1]).tolist() == [-1, -1]
+    # IDs beyond int32 aren't wrapped onto the indexed ones
+    assert deck.node_index(np.array([2**32 + nid[0], nid[0]])).tolist() == [-1, 0]
+
+
+def test_element_index(tmp_path: Path) -> None:
+    filename = tmp_path / "elements.k"
+    solid_section = ELEMENT_SOLID_SECTION.replace("       1       1", "     101       1")
+    solid_section = solid_section.replace("       2       1", "     102       1")
+    solid_section = solid_section.replace("       3       1", "     103       1")
+    filename.write_text(
+        ELEMENT_SHELL_SECTION.replace("*END\n", "") + solid_section.replace("*END\n", "")
+    )
+
+    deck = lsdyna_mesh_reader.Deck(filename)
+    section, row = deck.element_index([5, 102, 1, 6])
+    assert section.tolist() == [0, 1, 0, -1]
+    assert row.tolist() == [4, 1, 0, -1]
+    section, row = deck.element_index(np.array([2**32 + 5, -(2**32) + 5]))
+    assert section.tolist() == row.tolist() == [-1, -1]
+
+
+@pytest.mark.parametrize("long_format", [False, True])
+def test_write_deck(tmp_path: Path, long_format: bool) -> None:
+    deck = lsdyna_mesh_reader.Deck(examples.birdball)
+    filename = tmp_path / "written.k"
+    lsdyna_mesh_reader.write_deck(
+        filename,
+        deck.node_sections,
+        shell_sections=deck.element_shell_sections,
+        solid_sections=deck.element_solid_sections,
+        long_format=long_format,
+        num_threads=2,
+    )
+
+    written = lsdyna_mesh_reader.Deck(filename)
+    assert [kw.name for kw in written.keywords] == [
+        "*KEYWORD",
+        "*NODE",
+        "*ELEMENT_SHELL",
+        "*ELEMENT_SOLID",
+        "*END",
+    ]
+    for section, expected in zip(written.node_sections, deck.node_sections):
+        assert np.array_equal(section.nid, expected.nid)
+        assert np.allclose(section.coordinates, expected.coordinates, rtol=1e-9)
+        assert np.array_equal(section.tc, expected.tc)
+        assert np.array_equal(section.rc, expected.rc)
+    for sections, expected_sections in [
+        (written.element_shell_sections, deck.element_shell_sections),
+        (written.element_solid_sections, deck.element_solid_sections),
+    ]:
+        for section, expected in zip(sections, expected_sections):
+            assert np.array_equal(section.eid, expected.eid)
+            assert np.array_equal(section.pid, expected.pid)
+            assert np.array_equal(section.node_ids, expected.node_ids)
+
+
+def test_write_deck_from_arrays(tmp_path: Path) -> None:
+    nid = np.array([1, 2, 3, 4, 123_456_789], dtype=np.int32)
+    coordinates = np.random.random((5, 3))
+    nodes = NodeSection(nid, coordinates)
+    assert np.array_equal(nodes.tc, np.zeros(5))
+
+    # a triangle and a quad, and a tetrahedron written as a thick shell
+    shells = ElementShellSection(
+        np.array([1, 2], dtype=np.int32),
+        np.array([1, 1], dtype=np.int32),
+        np.array([1, 2, 3, 1, 2, 3, 4], dtype=np.int32),
+        np.array([0, 3, 7], dtype=np.int32),
+    )
+    tshells = ElementSolidSection(
+        np.array([3], dtype=np.int32),
+        np.array([2], dtype=np.int32),
+        np.array([1, 2, 3, 4], dtype=np.int32),
+        np.array([0, 4], dtype=np.int32),
+    )
+
+    # the largest node ID only fits in long format
+    filename = tmp_path / "arrays.k"
+    with pytest.raises(ValueError, match="long format"):
+        lsdyna_mesh_reader.write_deck(filename, [nodes], shell_sections=[shells])
+    lsdyna_mesh_reader.write_deck(
+        filename, [nodes], shell_sections=[shells], tshell_sections=[tshells], long_format=True
+    )
+
+    deck = lsdyna_mesh_reader.Deck(filename)
+    assert np.array_equal(deck.node_sections[0].nid, nid)
+    assert np.allclose(deck.node_sections[0].coordinates, coordinates, rtol=1e-12)
+    assert deck.element_shell_sections[0].node_ids.tolist() == [1, 2, 3, 3, 1, 2, 3, 4]
+    assert deck.element_solid_sections[0].node_ids.tolist() == [1, 2, 3, 4, 4, 4, 4, 4]
+
+    with pytest.raises(ValueError, match="node_id_offsets"):
+        ElementShellSection(shells.eid, shells.pid, shells.node_ids, np.array([0, 3], np.int32))
+    with pytest.raises(ValueError, match="coordinates of shape"):
+        NodeSection(nid, coordinates[:4])
+
+
+@pytest.mark.parametrize("renumber", [False, True])
+def test_extract_parts(tmp_path: Path, renumber: bool) -> None:
+    deck = lsdyna_mesh_reader.Deck(examples.birdball)
+    filename = tmp_path / "parts.k"
+    nodes, shells, solids = deck.extract_parts([2, 3], renumber=renumber, filename=filename)
+    assert len(nodes) == 1 and len(shells) == 1 and len(solids) == 1
+
+    # every shell is part 2 and some solids are part 3
+    shell = deck.element_shell_sections[0]
+    solid = deck.element_solid_sections[0]
+    mask = solid.pid == 3
+    solid_node_ids = solid.node_ids[np.repeat(mask, np.diff(solid.node_id_offsets))]
+    assert np.array_equal(solids[0].pid, solid.pid[mask])
+
+    # the referenced nodes in deck order
+    original = deck.node_sections[0]
+    index = np.unique(deck.node_index(np.concatenate([shell.node_ids, solid_node_ids])))
+    original_ids = original.nid[index]
+    assert np.array_equal(nodes[0].coordinates, original.coordinates[index])
+
+    if renumber:
+        assert nodes[0].nid.tolist() == list(range(1, index.size + 1))
+        assert solids[0].eid.tolist() == list(range(len(shell) + 1, len(shell) + mask.sum() + 1))
+        assert np.array_equal(original_ids[shells[0].node_ids - 1], shell.node_ids)
+        assert np.array_equal(original_ids[solids[0].node_ids - 1], solid_node_ids)
+    else:
+        assert np.array_equal(nodes[0].nid, original_ids)
+        assert np.array_equal(solids[0].eid, solid.eid[mask])
+        assert np.array_equal(solids[0].node_ids, solid_node_ids)
+
+    written = lsdyna_mesh_reader.Deck(filename)
+    assert np.array_equal(written.node_sections[0].nid, nodes[0].nid)
+    assert np.array_equal(written.element_solid_sections[0].node_ids, solids[0].node_ids)
+
+    nodes, shells, solids = deck.extract_parts([99])
+    assert len(nodes[0]) == 0 and not shells and not solids
+    with pytest.raises(ValueError, match="out of the range of int32"):
+        deck.extract_parts(np.array([2**32 + 2]))
+
+
+@pytest.mark.parametrize("exclude", [False, True])
+@pytest.mark.parametrize("num_threads", [1, 2])
+def test_read_filter_pid(tmp_path: Path, exclude: bool, num_threads: int) -> None:
+    filename = tmp_path / "parts.k"
+    free_card = "      10,       3,1,2,3,4\n"
+    filename.write_text(
+        NODE_SECTION.replace("*END\n", "")
+        + ELEMENT_SHELL_SECTION.replace("*END\n", free_card + "*END\n")
+    )
+    full = lsdyna_mesh_reader.Deck(filename)
+    pid = np.unique(full.element_shell_sections[0].pid)[:1]
+
+    if exclude:
+        deck = lsdyna_mesh_reader.Deck(filename, exclude_pid=pid, num_threads=num_threads)
+    else:
+        deck = lsdyna_mesh_reader.Deck(filename, pid=pid, num_threads=num_threads)
+    expected = full.element_shell_sections[0]
+    mask = np.isin(expected.pid, pid) != exclude
+    section = deck.element_shell_sections[0]
+    assert np.array_equal(section.eid, expected.eid[mask])
+    assert np.array_equal(section.pid, expected.pid[mask])
+    assert np.array_equal(section.node_ids, expected.node_ids.reshape(-1, 4)[mask].ravel())
+    assert section.node_id_offsets.tolist() == list(range(0, 4 * mask.sum() + 1, 4))
+
+    with pytest.raises(ValueError, match="can't be cached"):
+        lsdyna_mesh_reader.Deck(filename, pid=pid, cache=True)
+    with pytest.raises(ValueError, match="not both"):
+        lsdyna_mesh_reader.Deck(filename, pid=pid, exclude_pid=pid)
+    with pytest.raises(ValueError, match="out of the range of int32"):
+        lsdyna_mesh_reader.Deck(filename, pid=pid.astype(np.int64) + 2**32)
+
+
+def test_read_filter_keywords() -> None:
+    deck = lsdyna_mesh_reader.Deck(examples.birdball, element_keywords=["*element_solid"])
+    assert len(deck.element_solid_sections) == 1
+    assert not deck.element_shell_sections
+    assert len(deck.node_sections) == 1
+
+    deck = lsdyna_mesh_reader.Deck(
+        examples.birdball, exclude_element_keywords=["*ELEMENT_SOLID"], lazy=True
+    )
+    assert len(deck.element_shell_sections) == 1
+    assert not deck.element_solid_sections
+
+    deck = lsdyna_mesh_reader.Deck(examples.birdball, nodes_only=True)
+    assert len(deck.node_sections) == 1
+    assert not deck.element_shell_sections and not deck.element_solid_sections
+
+    with pytest.raises(ValueError, match="Unknown element keyword"):
+        lsdyna_mesh_reader.Deck(examples.birdball, element_keywords=["*ELEMENT_BEAM"])
+
+
+def test_compact_sections(tmp_path: Path) -> None:
+    """Consecutive IDs, uniform offsets, and zero constraints read back."""
+    filename = tmp_path / "compact.k"
+    lines = ["*NODE"]
+    lines += [f"{nid:8d}{nid:16.1f}{0.0:16.1f}{0.0:16.1f}" for nid in range(11, 19)]
+    lines += ["*ELEMENT_SHELL"]
+    lines += [f"{eid:8d}{1:8d}" + f"{eid - 100:8d}" * 4 for eid in range(101, 104)]
+    lines += ["*ELEMENT_SOLID"]
+    lines += [f"{eid:8d}{1:8d}" + "".join(f"{nid:8d}" for nid in range(11, 19)) for eid in [7, 9]]
+    filename.write_text("\n".join(lines + ["*END"]))
+
+    deck = lsdyna_mesh_reader.Deck(filename)
+    node_section = deck.node_sections[0]
+    assert node_section.nid.tolist() == list(range(11, 19))
+    assert node_section.tc.tolist() == [0] * 8
+    assert node_section.rc.tolist() == [0] * 8
+    shells = deck.element_shell_sections[0]
+    assert shells.eid.tolist() == [101, 102, 103]
+    assert shells.node_id_offsets.tolist() == [0, 4, 8, 12]
+    solids = deck.element_solid_sections[0]
+    assert solids.eid.tolist() == [7, 9]
+    assert solids.node_id_offsets.tolist() == [0, 8, 16]
+
+    # arrays are materialized once
+    assert np.shares_memory(node_section.nid, node_section.nid)
+    assert np.shares_memory(shells.eid, shells.eid)
+    assert deck.to_grid().point_data["Node ID"].tolist() == list(range(11, 19))
+
+    # IDs, constraints, and offsets are read only whether they're stored or
+    # not, and may be used to build new sections
+    arrays = [node_section.nid, node_section.tc, shells.eid, shells.node_id_offsets]
+    arrays += [solids.eid, solids.node_id_offsets]
+    for array in arrays:
+        assert not array.flags.writeable
+        with pytest.raises(ValueError, match="read-only"):
+            array[0] = 1
+    assert node_section.coordinates.flags.writeable
+    copy = ElementSolidSection(solids.eid, solids.pid, solids.node_ids, solids.node_id_offsets)
+    assert not copy.eid.flags.writeable
+    assert copy.eid.tolist() == [7, 9]
+
+
+def test_float32(tmp_path: Path) -> None:
+    deck = lsdyna_mesh_reader.Deck(examples.birdball)
+    deck32 = lsdyna_mesh_reader.Deck(examples.birdball, float32=True)
+    coord = deck32.node_sections[0].coordinates
+    assert coord.dtype == np.float32
+    assert np.array_equal(coord, deck.node_sections[0].coordinates.astype(np.float32))
+    assert np.allclose(deck32.to_grid().points, deck.to_grid().points)
+
+    # the writer takes single precision sections
+    filename = tmp_path / "float32.k"
+    deck32.extract_parts(2, filename=filename)
+    assert np.allclose(
+        lsdyna_mesh_reader.Deck(filename).node_sections[0].coordinates,
+        deck.extract_parts(2)[0][0].coordinates,
+    )
+
+    with pytest.raises(ValueError, match="can't be cached"):
+        lsdyna_mesh_reader.Deck(examples.birdball, float32=True, cache=True)
+
+
+def test_arrays_outlive_deck() -> None:
+    """Section arrays are views of the deck's memory and keep it alive."""
+    deck = lsdyna_mesh_reader.Deck(examples.birdball)
+    expected = deck.node_sections[0].coordinates.copy()
+    coordinates = deck.node_sections[0].coordinates
+    node_ids = deck.element_shell_sections[0].node_ids
+    del deck
+    gc.collect()
+    assert np.array_equal(coordinates, expected)
+    assert node_ids.min() >= 1
+
+
+def test_load_async() -> None:
+    future = lsdyna_mesh_reader.Deck.load_async(examples.birdball, num_threads=2)
+    deck = future.result()
+    assert isinstance(deck, lsdyna_mesh_reader.Deck)
+    parsed, total = future.progress()
+    assert parsed == total > 0
+    assert not future.cancel() and not future.cancelled()
+    expected = lsdyna_mesh_reader.Deck(examples.birdball)
+    assert np.array_equal(deck.node_sections[0].coordinates, expected.node_sections[0].coordinates)
+
+    # a load still waiting for the executor never starts
+    with ThreadPoolExecutor(1) as executor:
+        started = threading.Event()
+        executor.submit(started.wait)
+        future = lsdyna_mesh_reader.Deck.load_async(examples.birdball, executor=executor)
+        assert future.cancel() and future.cancelled()
+        started.set()
+    with pytest.raises(CancelledError):
+        future.result()
+
+
+def _section_arrays(deck: lsdyna_mesh_reader.Deck) -> List[np.ndarray]:
+    arrays: List[np.ndarray] = []
+    for node_section in deck.node_sections:
+        arrays += [node_section.nid, node_section.coordinates, node_section.tc, node_section.rc]
+    for section in list(deck.element_shell_sections) + list(deck.element_solid_sections):
+        arrays += [section.eid, section.pid, section.node_ids, section.node_id_offsets]
+    return arrays
+
+
+@pytest.mark.parametrize("lazy", [False, True])
+def test_concurrent_access(lazy: bool) -> None:
+    """Many threads load the example decks, and query one deck, at once."""
+    file_paths = get_example_files()
+    expected = {path: _section_arrays(lsdyna_mesh_reader.Deck(path)) for path in file_paths}
+    n_threads = 16
+
+    def load(path: str) -> List[np.ndarray]:
+        return _section_arrays(lsdyna_mesh_reader.Deck(path, num_threads=2, lazy=lazy))
+
+    with ThreadPoolExecutor(n_threads) as executor:
+        paths = file_paths * 4
+        for path, arrays in zip(paths, executor.map(load, paths)):
+            assert len(arrays) == len(expected[path])
+            assert all(np.array_equal(a, b) for a, b in zip(arrays, expected[path]))
+
+    # every thread starts querying the same deck at once, so the arrays
+    # created on first access, the sections, and the ID indices race
+    deck = lsdyna_mesh_reader.Deck(examples.birdball, num_threads=2, lazy=lazy)
+    serial = lsdyna_mesh_reader.Deck(examples.birdball)
+    nid = serial.node_sections[0].nid[::-1]
+    eid = serial.element_shell_sections[0].eid
+    node_index = serial.node_index(nid)
+    element_index = serial.element_index(eid)
+    n_cells = serial.to_grid().n_cells
+    barrier = threading.Barrier(n_threads, timeout=60)
+
+    def query(_: int) -> List[np.ndarray]:
+        barrier.wait()
+        arrays = _section_arrays(deck)
+        assert np.array_equal(deck.node_index(nid), node_index)
+        assert all(np.array_equal(a, b) for a, b in zip(deck.element_index(eid), element_index))
+        assert deck.to_grid().n_cells == n_cells
+        return arrays
+
+    with ThreadPoolExecutor(n_threads) as executor:
+        results = list(executor.map(query, range(n_threads)))
+    for arrays in results:
+        assert all(np.array_equal(a, b) for a, b in zip(arrays, expected[examples.birdball]))
+        # each array was created once and is shared by every thread
+        assert all(np.shares_memory(a, b) for a, b in zip(arrays, results[0]) if a.size)
+
+
+def test_load_many(tmp_path: Path) -> None:
+    file_paths = get_example_files()
+    decks = lsdyna_mesh_reader.Deck.load_many(file_paths, num_threads=2)
+    assert len(decks) == len(file_paths)
+    for file_path, deck in zip(file_paths, decks):
+        expected = _section_arrays(lsdyna_mesh_reader.Deck(file_path))
+        arrays = _section_arrays(deck)
+        assert len(arrays) == len(expected)
+        assert all(np.array_equal(a, b) for a, b in zip(arrays, expected))
+
+    # decks are yielded as they finish, and ones that needn't be parsed first
+    copies = [str(shutil.copy(file_path, tmp_path)) for file_path in file_paths]
+    cached = file_paths.index(examples.birdball)
+    lsdyna_mesh_reader.Deck(copies[cached], cache=True)
+    loaded = list(lsdyna_mesh_reader.Deck.load_many_as_completed(copies, 3, cache=True))
+    assert loaded[0][0] == cached
+    assert sorted(i for i, _ in loaded) == list(range(len(copies)))
+
+    decks = lsdyna_mesh_reader.Deck.load_many([examples.birdball] * 3, pid=[2])
+    assert [len(deck.element_shell_sections[0]) for deck in decks] == [100] * 3
+
+    # stopping early cancels the decks still loading
+    loading = []
+
+    def deck_loader(readers: List[_Deck], num_threads: int) -> _DeckLoader:
+        loading.extend(readers)
+        return _DeckLoader(readers, num_threads)
+
+    lsdyna_mesh_reader.deck._DeckLoader = deck_loader
+    try:
+        iterator = lsdyna_mesh_reader.Deck.load_many_as_completed(file_paths * 4)
+    finally:
+        lsdyna_mesh_reader.deck._DeckLoader = _DeckLoader
+    _, first = next(iterator)
+    iterator.close()
+    assert len(loading) == len(file_paths) * 4
+    assert all(reader.cancelled != (reader is first._deck) for reader in loading)
+
+    with pytest.raises(FileNotFoundError):
+        lsdyna_mesh_reader.Deck.load_many([examples.birdball, str(tmp_path / "missing.k")])
+
+
+@pytest.mark.parametrize("lazy", [False, True])
+def test_from_buffer(tmp_path: Path, lazy: bool) -> None:
+    for file_path in get_example_files():
+        with open(file_path, "rb") as f:
+            data = f.read()
+        expected = _section_arrays(lsdyna_mesh_reader.Deck(file_path))
+        for buffer in [data, memoryview(bytearray(data)), np.frombuffer(data, np.uint8)]:
+            deck = lsdyna_mesh_reader.Deck.from_buffer(buffer, name="model.k", lazy=lazy)
+            arrays = _section_arrays(deck)
+            assert len(arrays) == len(expected)
+            assert all(np.array_equal(a, b) for a, b in zip(arrays, expected))
+        assert deck.filenames == ["model.k"]
+
+    # the deck keeps the buffer alive
+    with open(examples.birdball, "rb") as f:
+        deck = lsdyna_mesh_reader.Deck.from_buffer(bytearray(f.read()), pid=[2])
+    gc.collect()
+    assert len(deck.element_shell_sections[0]) == 100
+
+    nodes = deck.node_sections[0].coordinates + 1
+    deck.overwrite_node_section(tmp_path / "new.k", nodes)
+    new_deck = lsdyna_mesh_reader.Deck(tmp_path / "new.k")
+    assert np.allclose(new_deck.node_sections[0].coordinates, nodes)
+
+    with pytest.raises(ValueError, match="can't be cached"):
+        lsdyna_mesh_reader.Deck.from_buffer(b"*KEYWORD\n", cache=True)
+
+
+def test_compressed(tmp_path: Path) -> None:
+    for file_path in get_example_files():
+        expected = _section_arrays(lsdyna_mesh_reader.Deck(file_path))
+        gz_path = tmp_path / (os.path.basename(file_path) + ".gz")
+        with open(file_path, "rb") as src, gzip.open(gz_path, "wb") as dst:
+            shutil.copyfileobj(src, dst)
+        for lazy in [False, True]:
+            deck = lsdyna_mesh_reader.Deck(gz_path, num_threads=2, lazy=lazy)
+            arrays = _section_arrays(deck)
+            assert len(arrays) == len(expected)
+            assert all(np.array_equal(a, b) for a, b in zip(arrays, expected))
+
+    # compression can be given for a file without the suffix
+    gz_path = tmp_path / "birdball.k.gz"
+    shutil.copy(gz_path, tmp_path / "birdball.dat")
+    deck = lsdyna_mesh_reader.Deck(tmp_path / "birdball.dat", compression="gzip")
+    assert len(deck.element_shell_sections[0]) == 100
+
+    # room for the deck is reserved from the size in the gzip trailer
+    size = lsdyna_mesh_reader.deck._decompressed_size(str(gz_path), "gzip")
+    assert size == os.path.getsize(examples.birdball)
+
+    decks = lsdyna_mesh_reader.Deck.load_many([gz_path] * 3, pid=[2])
+    assert [len(deck.element_shell_sections[0]) for deck in decks] == [100] * 3
+    assert lsdyna_mesh_reader.Deck.load_async(gz_path).result().filenames == [str(gz_path)]
+
+    with pytest.raises(ValueError, match="can't be cached"):
+        lsdyna_mesh_reader.Deck(gz_path, cache=True)
+    with pytest.raises(ValueError, match="compressed deck"):
+        next(lsdyna_mesh_reader.iter_nodes(gz_path))
+    with pytest.raises(ValueError, match="compressed deck"):
+        next(lsdyna_mesh_reader.iter_elements(gz_path))
+
+    truncated = tmp_path / "truncated.k.gz"
+    truncated.write_bytes(gz_path.read_bytes()[:-100])
+    with pytest.raises(EOFError):
+        lsdyna_mesh_reader.Deck(truncated)
+    with pytest.raises(EOFError):
+        lsdyna_mesh_reader.Deck.load_many([gz_path, truncated, gz_path])
+    with pytest.raises(EOFError):
+        lsdyna_mesh_reader.Deck.load_many([truncated], lazy=True)
+
+
+def test_compressed_zstd(tmp_path: Path) -> None:
+    try:
+        from compression import zstd
+    except ImportError:
+        zstd = pytest.importorskip("zstandard")
+
+    zst_path = tmp_path / "birdball.k.zst"
+    with open(examples.birdball, "rb") as f:
+        zst_path.write_bytes(zstd.compress(f.read()))
+    size = lsdyna_mesh_reader.deck._decompressed_size(str(zst_path), "zstd")
+    assert size == os.path.getsize(examples.birdball)
+    deck = lsdyna_mesh_reader.Deck(zst_path)
+    expected = _section_arrays(lsdyna_mesh_reader.Deck(examples.birdball))
+    assert all(np.array_equal(a, b) for a, b in zip(_section_arrays(deck), expected))
+
+
+@pytest.mark.parametrize("file_path", get_example_files())
+def test_iter_sections(file_path: str) -> None:
+    """Chunks of each section join up to the sections read by a deck."""
+    deck = lsdyna_mesh_reader.Deck(file_path)
+
+    chunks = {}
+    for chunk in lsdyna_mesh_reader.iter_nodes(file_path, chunk_rows=7):
+        assert len(chunk.nid) <= 7
+        chunks.setdefault(chunk.section, []).append([np.copy(a) for a in chunk[1:]])
+    assert len(chunks) == len(deck.node_sections)
+    for section, node_section in zip(chunks.values(), deck.node_sections):
+        nid, coordinates, tc, rc = (np.concatenate(arrays) for arrays in zip(*section))
+        assert np.array_equal(nid, node_section.nid)
+        assert np.array_equal(coordinates, node_section.coordinates)
+        assert np.array_equal(tc, node_section.tc)
+        assert np.array_equal(rc, node_section.rc)
+
+    for keyword, sections in [
+        ("*ELEMENT_SHELL", deck.element_shell_sections),
+        ("*ELEMENT_SOLID", deck.element_solid_sections),
+    ]:
+        others = [k for k in lsdyna_mesh_reader.deck.ELEMENT_KEYWORDS if k != keyword]
+        if keyword == "*ELEMENT_SOLID":
+            others.remove("*ELEMENT_TSHELL")
+        chunks = {}
+        for chunk in lsdyna_mesh_reader.iter_elements(
+            file_path, chunk_rows=7, exclude_element_keywords=others
+        ):
+            assert chunk.node_ids.shape == (len(chunk.eid), 4 if keyword == "*ELEMENT_SHELL" else 8)
+            chunks.setdefault(chunk.section, []).append(
+                [np.copy(chunk.eid), np.copy(chunk.pid), np.copy(chunk.node_ids)]
+            )
+        assert len(chunks) == len(sections)
+        for section, element_section in zip(chunks.values(), sections):
+            eid, pid, node_ids = (np.concatenate(arrays) for arrays in zip(*section))
+            assert np.array_equal(eid, element_section.eid)
+            assert np.array_equal(pid, element_section.pid)
+            assert np.array_equal(node_ids.ravel(), element_section.node_ids)
+
+    with pytest.raises(ValueError, match="Unknown element keyword"):
+        next(lsdyna_mesh_reader.iter_elements(file_path, element_keywords=["*NODE"]))
+
+
+@pytest.mark.parametrize("io_backend", ["mmap", "mmap_populate", "pread"])
+def test_io_backend(tmp_path: Path, io_backend: str) -> None:
+    """Every I/O backend reads the same deck, however small its blocks."""
+    for file_path in get_example_files():
+        expected = _section_arrays(lsdyna_mesh_reader.Deck(file_path))
+        for num_threads, lazy in [(1, False), (2, False), (1, True)]:
+            deck = lsdyna_mesh_reader.Deck(
+                file_path, num_threads, lazy, io_backend=io_backend, block_size=4096
+            )
+            arrays = _section_arrays(deck)
+            assert len(arrays) == len(expected)
+            assert all(np.array_equal(a, b) for a, b in zip(arrays, expected))
+
+    filename = write_include_deck(tmp_path)
+    deck = lsdyna_mesh_reader.Deck(filename, num_threads=2, io_backend=io_backend, block_size=7)
+    _assert_decks_equal(deck, lsdyna_mesh_reader.Deck(filename))
+
+    # the file is read again after its blocks are freed
+    deck = lsdyna_mesh_reader.Deck(examples.birdball, io_backend=io_backend, block_size=4096)
+    expected = lsdyna_mesh_reader.Deck(examples.birdball)
+    nodes = expected.node_sections[0].coordinates + 1
+    deck.write_node_variants([tmp_path / "variant.k"], [nodes])
+    expected.write_node_variants([tmp_path / "expected.k"], [nodes])
+    assert (tmp_path / "variant.k").read_bytes() == (tmp_path / "expected.k").read_bytes()
+
+    # the cache is written and loaded whichever backend reads the deck
+    shutil.copy(examples.birdball, tmp_path / "birdball.k")
+    for _ in range(2):
+        deck = lsdyna_mesh_reader.Deck(tmp_path / "birdball.k", cache=True, io_backend=io_backend)
+        assert len(deck.element_shell_sections[0]) == 100
+    decks = lsdyna_mesh_reader.Deck.load_many([examples.birdball] * 3, io_backend=io_backend)
+    assert [len(deck.element_shell_sections[0]) for deck in decks] == [100] * 3
+
+
+def test_io_backend_invalid() -> None:
+    with pytest.raises(ValueError, match="Unknown I/O backend"):
+        lsdyna_mesh_reader.Deck(examples.birdball, io_backend="read")
+    with pytest.raises(ValueError, match="block size must be positive"):
+        lsdyna_mesh_reader.Deck(examples.birdball, io_backend="pread", block_size=0)